@@ -0,0 +1,35 @@
+// analytic_solution.h
+// Header file for the closed-form reference solution of the model problem
+// T = 1 on top, 0 on the other sides of the unit square:
+//   T(x, y) = sum over odd n of 4/(n pi) sin(n pi x) sinh(n pi y) / sinh(n pi)
+
+#ifndef ANALYTIC_SOLUTION_H
+#define ANALYTIC_SOLUTION_H
+
+#include "fem_matrix.h"
+
+// Discrete error norms of a - b
+typedef struct {
+    double l2;          // Root mean square over the nodes
+    double linf;        // Maximum absolute difference
+} ErrorNorms;
+
+// Evaluates the series on a tensor grid: x values xs[i] (i < nxs),
+// y values ys[j] (j < nys), result T[i*nys + j] (create_fem_system numbering)
+// Boundary nodes get the discrete Dirichlet values (get_boundary_type)
+// Each grid line is truncated once the tail bound drops below trunc_tol,
+// with at most max_terms odd terms; returns the largest term count used
+int fourier_reference(const double *xs, int nxs, const double *ys, int nys,
+                      int max_terms, double trunc_tol, double *T);
+
+// Node coordinates of create_fem_system: xs[i] = i/(ny-1), ys[j] = j/(nx-1)
+void fem_grid_coordinates(int nx, int ny, double *xs, double *ys);
+
+// RMS and maximum norms of a - b
+ErrorNorms error_norms(const double *a, const double *b, int n);
+
+// Estimate of ||A^{-1}||_2 for create_fem_system matrices: inverse of the
+// smallest eigenvalue of the interior 5-point stencil
+double fem_inverse_norm_estimate(FEMSystem *sys);
+
+#endif // ANALYTIC_SOLUTION_H
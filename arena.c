@@ -0,0 +1,79 @@
+// arena.c
+// One aligned region per object instead of one malloc per array
+
+#ifdef __linux__
+#define _GNU_SOURCE     // MADV_HUGEPAGE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+static size_t round_up(size_t bytes, size_t align) {
+    return (bytes + align - 1) / align * align;
+}
+
+size_t arena_size(size_t count, size_t elem) {
+    return round_up(count * elem, ARENA_ALIGN);
+}
+
+// Huge-page sized region: map one extra huge page, then trim the unaligned
+// head and the tail so the region starts on a 2 MB boundary
+static char* map_huge(size_t size) {
+    size_t span = size + ARENA_HUGE_PAGE;
+    char *raw = (char*)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    char *base = (char*)round_up((uintptr_t)raw, ARENA_HUGE_PAGE);
+    size_t head = (size_t)(base - raw);
+    if (head > 0) munmap(raw, head);
+    if (span - head > size) munmap(base + size, span - head - size);
+#ifdef MADV_HUGEPAGE
+    madvise(base, size, MADV_HUGEPAGE);
+#endif
+    return base;
+}
+
+int arena_init(Arena *arena, size_t size) {
+    arena->used = 0;
+    if (size >= ARENA_HUGE_PAGE) {
+        // Anonymous mappings are already zero
+        arena->size = round_up(size, ARENA_HUGE_PAGE);
+        arena->base = map_huge(arena->size);
+        arena->mapped = 1;
+    } else {
+        arena->size = round_up(size > 0 ? size : 1, ARENA_ALIGN);
+        arena->base = (char*)aligned_alloc(ARENA_ALIGN, arena->size);
+        arena->mapped = 0;
+        if (arena->base) memset(arena->base, 0, arena->size);
+    }
+    if (!arena->base) {
+        fprintf(stderr, "arena_init: cannot allocate %zu bytes\n", size);
+        arena->size = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void* arena_alloc(Arena *arena, size_t count, size_t elem) {
+    size_t bytes = arena_size(count, elem);
+    if (bytes == 0 || arena->used + bytes > arena->size) return NULL;
+    void *ptr = arena->base + arena->used;
+    arena->used += bytes;
+    return ptr;
+}
+
+void arena_release(Arena *arena) {
+    if (arena->base) {
+        if (arena->mapped) {
+            munmap(arena->base, arena->size);
+        } else {
+            free(arena->base);
+        }
+    }
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
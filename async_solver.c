@@ -0,0 +1,311 @@
+// async_solver.c
+// Asynchronous solve service: bounded lock-free MPMC queues (one for small,
+// one for large systems) served by pthread workers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "async_solver.h"
+
+// Queue slots per size class (power of two)
+#define QUEUE_CAPACITY 1024
+
+// Polls of a job before solve_wait sleeps
+#define WAIT_SPINS 1000
+
+// Bounded MPMC queue (Vyukov): each cell's sequence number says whether it
+// is free for the producer at position pos (seq == pos) or holds the item
+// for the consumer at pos (seq == pos + 1). Producers and consumers only
+// contend on their own position counter
+typedef struct {
+    atomic_size_t sequence;
+    SolveJob *job;
+} QueueCell;
+
+typedef struct {
+    QueueCell *cells;
+    size_t mask;
+    _Alignas(64) atomic_size_t enqueue_pos;
+    _Alignas(64) atomic_size_t dequeue_pos;
+} JobQueue;
+
+struct SolveJob {
+    SolveService *service;
+    FEMSystem *sys;
+    SolverOptions opts;
+    SolverStats stats;
+    double solve_time;
+    int result;
+    atomic_int finished;
+};
+
+struct SolveService {
+    int num_workers;
+    int large_threshold;
+    int large_team;
+    pthread_t *workers;
+    JobQueue small, large;
+    atomic_int cores_used;  // Workers busy with small jobs + team sizes of large jobs
+    int shutdown;
+    pthread_mutex_t lock;   // Only for sleeping workers / waiters
+    pthread_cond_t work;    // Signalled on submit and when cores free up
+    pthread_cond_t done;    // Broadcast when a job finishes
+};
+
+static void queue_init(JobQueue *q) {
+    q->cells = (QueueCell*)malloc(QUEUE_CAPACITY * sizeof(QueueCell));
+    q->mask = QUEUE_CAPACITY - 1;
+    for (size_t i = 0; i < QUEUE_CAPACITY; i++) {
+        atomic_init(&q->cells[i].sequence, i);
+        q->cells[i].job = NULL;
+    }
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+}
+
+// Returns 0 if the queue is full
+static int queue_push(JobQueue *q, SolveJob *job) {
+    size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        QueueCell *cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->job = job;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Returns NULL if the queue is empty
+static SolveJob* queue_pop(JobQueue *q) {
+    size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        QueueCell *cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                SolveJob *job = cell->job;
+                atomic_store_explicit(&cell->sequence, pos + q->mask + 1, memory_order_release);
+                return job;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static int queue_empty(JobQueue *q) {
+    return atomic_load_explicit(&q->enqueue_pos, memory_order_acquire) ==
+           atomic_load_explicit(&q->dequeue_pos, memory_order_acquire);
+}
+
+// Claims need cores if at least fit (>= need) of the workers are free
+static int try_reserve(SolveService *svc, int need, int fit) {
+    int used = atomic_load(&svc->cores_used);
+    while (used + fit <= svc->num_workers) {
+        if (atomic_compare_exchange_weak(&svc->cores_used, &used, used + need)) return 1;
+    }
+    return 0;
+}
+
+static void release_cores(SolveService *svc, int count) {
+    atomic_fetch_sub(&svc->cores_used, count);
+    pthread_mutex_lock(&svc->lock);
+    pthread_cond_broadcast(&svc->work);
+    pthread_mutex_unlock(&svc->lock);
+}
+
+// Free cores a small job needs to start: while a large job waits, small
+// ones must leave room for its team, so running jobs drain until it fits
+// instead of a stream of small jobs starving it
+static int small_fit(SolveService *svc) {
+    return queue_empty(&svc->large) ? 1 : svc->large_team;
+}
+
+// Something this worker could start now (checked under svc->lock)
+static int work_available(SolveService *svc) {
+    int free_cores = svc->num_workers - atomic_load(&svc->cores_used);
+    return (!queue_empty(&svc->small) && free_cores >= small_fit(svc)) ||
+           (!queue_empty(&svc->large) && free_cores >= svc->large_team);
+}
+
+// Runs one job; the worker's workspace is reused across jobs
+static void run_job(SolveJob *job, int large, int team, SolverWorkspace **ws) {
+    SolverOptions opts = job->opts;
+    int n = job->sys->n;
+    if (!opts.workspace) {
+        if (!*ws || (*ws)->n < n) {
+            if (*ws) solver_workspace_free(*ws);
+            *ws = solver_workspace_create(n);
+        }
+        if (!*ws) {
+            // Out of memory: fail this job, the worker carries on
+            job->result = -1;
+            job->solve_time = 0.0;
+            solver_stats_reset(&job->stats);
+            return;
+        }
+        opts.workspace = *ws;
+    }
+    if (large) {
+        opts.num_threads = team;
+        job->result = bicgstab_parallel_ex(job->sys, &opts, &job->stats, &job->solve_time);
+    } else {
+        job->result = bicgstab_serial_ex(job->sys, &opts, &job->stats, &job->solve_time);
+    }
+}
+
+static void* worker_main(void *arg) {
+    SolveService *svc = (SolveService*)arg;
+    SolverWorkspace *ws = NULL;
+
+    for (;;) {
+        // Large jobs first (they need several free cores at once), then small
+        SolveJob *job = NULL;
+        int cores = 0, large = 0;
+        if (!queue_empty(&svc->large) && try_reserve(svc, svc->large_team, svc->large_team)) {
+            job = queue_pop(&svc->large);
+            cores = svc->large_team;
+            large = 1;
+            if (!job) {
+                release_cores(svc, cores);
+                cores = 0;
+                large = 0;
+            }
+        }
+        if (!job && !queue_empty(&svc->small) && try_reserve(svc, 1, small_fit(svc))) {
+            job = queue_pop(&svc->small);
+            cores = 1;
+            if (!job) {
+                release_cores(svc, cores);
+                cores = 0;
+            }
+        }
+
+        if (!job) {
+            pthread_mutex_lock(&svc->lock);
+            while (!work_available(svc) &&
+                   !(svc->shutdown && queue_empty(&svc->small) && queue_empty(&svc->large))) {
+                pthread_cond_wait(&svc->work, &svc->lock);
+            }
+            int stop = svc->shutdown && queue_empty(&svc->small) && queue_empty(&svc->large);
+            pthread_mutex_unlock(&svc->lock);
+            if (stop) break;
+            continue;
+        }
+
+        run_job(job, large, cores, &ws);
+        release_cores(svc, cores);
+
+        atomic_store_explicit(&job->finished, 1, memory_order_release);
+        pthread_mutex_lock(&svc->lock);
+        pthread_cond_broadcast(&svc->done);
+        pthread_mutex_unlock(&svc->lock);
+    }
+
+    if (ws) solver_workspace_free(ws);
+    return NULL;
+}
+
+SolveService* solve_service_create(int num_workers, int large_threshold, int large_team) {
+    // Queue position counters sit on their own cache lines
+    SolveService *svc = (SolveService*)aligned_alloc(64, (sizeof(SolveService) + 63) / 64 * 64);
+    svc->num_workers = num_workers > 0 ? num_workers : 1;
+    svc->large_threshold = large_threshold;
+    svc->large_team = large_team < 1 ? 1 : (large_team > svc->num_workers ? svc->num_workers : large_team);
+    queue_init(&svc->small);
+    queue_init(&svc->large);
+    atomic_init(&svc->cores_used, 0);
+    svc->shutdown = 0;
+    pthread_mutex_init(&svc->lock, NULL);
+    pthread_cond_init(&svc->work, NULL);
+    pthread_cond_init(&svc->done, NULL);
+
+    svc->workers = (pthread_t*)malloc(svc->num_workers * sizeof(pthread_t));
+    for (int w = 0; w < svc->num_workers; w++) {
+        pthread_create(&svc->workers[w], NULL, worker_main, svc);
+    }
+    return svc;
+}
+
+SolveJob* solve_submit(SolveService *svc, FEMSystem *sys, const SolverOptions *opts) {
+    SolveJob *job = (SolveJob*)malloc(sizeof(SolveJob));
+    job->service = svc;
+    job->sys = sys;
+    job->opts = *opts;
+    solver_stats_reset(&job->stats);
+    job->solve_time = 0.0;
+    job->result = 0;
+    atomic_init(&job->finished, 0);
+
+    JobQueue *q = sys->n >= svc->large_threshold ? &svc->large : &svc->small;
+    while (!queue_push(q, job)) sched_yield();
+
+    // Wake a sleeping worker (the lock orders this after its emptiness check)
+    pthread_mutex_lock(&svc->lock);
+    pthread_cond_signal(&svc->work);
+    pthread_mutex_unlock(&svc->lock);
+    return job;
+}
+
+int solve_poll(SolveJob *job) {
+    return atomic_load_explicit(&job->finished, memory_order_acquire);
+}
+
+int solve_wait(SolveJob *job) {
+    for (int spin = 0; spin < WAIT_SPINS && !solve_poll(job); spin++) sched_yield();
+    if (!solve_poll(job)) {
+        SolveService *svc = job->service;
+        pthread_mutex_lock(&svc->lock);
+        while (!solve_poll(job)) pthread_cond_wait(&svc->done, &svc->lock);
+        pthread_mutex_unlock(&svc->lock);
+    }
+    return job->result;
+}
+
+const SolverStats* solve_job_stats(const SolveJob *job) {
+    return &job->stats;
+}
+
+double solve_job_time(const SolveJob *job) {
+    return job->solve_time;
+}
+
+void solve_job_free(SolveJob *job) {
+    free(job);
+}
+
+void solve_service_free(SolveService *svc) {
+    if (!svc) return;
+    pthread_mutex_lock(&svc->lock);
+    svc->shutdown = 1;
+    pthread_cond_broadcast(&svc->work);
+    pthread_mutex_unlock(&svc->lock);
+    for (int w = 0; w < svc->num_workers; w++) {
+        pthread_join(svc->workers[w], NULL);
+    }
+    pthread_mutex_destroy(&svc->lock);
+    pthread_cond_destroy(&svc->work);
+    pthread_cond_destroy(&svc->done);
+    free(svc->small.cells);
+    free(svc->large.cells);
+    free(svc->workers);
+    free(svc);
+}
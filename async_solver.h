@@ -0,0 +1,46 @@
+// async_solver.h
+// Asynchronous solve service: independent solves are submitted to a
+// lock-free MPMC job queue and picked up by a fixed set of worker threads
+//
+// Scheduling: small systems (n < large_threshold) run on a single worker
+// with the serial solver, so many of them proceed side by side; large
+// systems get an OpenMP team of large_team threads. The number of large
+// jobs in flight is capped so the teams and the single-thread jobs together
+// stay within the worker count, and while a large job waits no small one
+// starts unless the large team would still fit
+
+#ifndef ASYNC_SOLVER_H
+#define ASYNC_SOLVER_H
+
+#include "bicgstab.h"
+
+typedef struct SolveService SolveService;
+typedef struct SolveJob SolveJob;
+
+// Starts num_workers worker threads
+// large_threshold: systems with at least this many unknowns count as large
+// large_team: OpenMP team size for large systems (clamped to num_workers)
+SolveService* solve_service_create(int num_workers, int large_threshold, int large_team);
+
+// Queues a solve of sys with a copy of opts (sys->x is the initial guess)
+// Blocks only while the queue is full. The job handle must be freed with
+// solve_job_free after completion; sys must stay alive until then
+SolveJob* solve_submit(SolveService *service, FEMSystem *sys, const SolverOptions *opts);
+
+// 1 if the job has finished
+int solve_poll(SolveJob *job);
+
+// Waits for the job; returns the solver result (iterations, or -1)
+int solve_wait(SolveJob *job);
+
+// Results of a finished job
+const SolverStats* solve_job_stats(const SolveJob *job);
+double solve_job_time(const SolveJob *job);
+
+// Frees a finished job handle
+void solve_job_free(SolveJob *job);
+
+// Finishes all queued jobs, then stops and joins the workers
+void solve_service_free(SolveService *service);
+
+#endif // ASYNC_SOLVER_H
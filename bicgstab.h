@@ -0,0 +1,198 @@
+// bicgstab.h
+// Header file for the BICGSTAB solvers
+// Defines solver options, per-kernel statistics and the solver entry points
+
+#ifndef BICGSTAB_H
+#define BICGSTAB_H
+
+#include "fem_matrix.h"
+#include "preconditioner.h"
+#include "linear_operator.h"
+#include "thread_pool.h"
+#include "spmv.h"
+
+// BICGSTAB work vectors, reusable across solves of the same (or smaller) size
+// All vectors share one aligned arena, each on its own cache lines
+typedef struct {
+    int n;
+    double *r, *r0, *p, *v, *s, *t;
+    double *p_hat, *s_hat;  // Preconditioned directions M^{-1} p, M^{-1} s
+    Arena arena;
+} SolverWorkspace;
+
+// Stopping criteria; each is compared against opts->tol
+typedef enum {
+    STOP_RELATIVE_B = 0,    // ||r|| / ||b|| (default)
+    STOP_RELATIVE_R0,       // ||r|| / ||r_0|| (relative to the initial residual)
+    STOP_ABSOLUTE,          // ||r||
+    STOP_BACKWARD_ERROR,    // ||r|| / (||A|| ||x|| + ||b||)
+    STOP_ENERGY_ESTIMATE    // Delayed estimate of ||x* - x||_A / ||x - x_0||_A (a bound
+                            // for PCG on SPD A; only a heuristic for BiCGSTAB, whose
+                            // updates are not A-orthogonal)
+} StopCriterion;
+
+// Iterations of delay in the energy-norm error estimate
+#define STOP_ESTIMATE_DELAY 10
+
+// Energy estimate under confirm_converged: the true ||r|| may exceed the
+// recursive one that passed stop_check by at most this factor
+#define STOP_CONFIRM_DRIFT 10.0
+
+// Running state of the stopping test during one solve
+typedef struct {
+    double bnorm;           // ||b||
+    double r0norm;          // ||b - A x_0||
+    double anorm;           // ||A|| estimate (backward error only)
+    double xnorm;           // ||x|| at the current check (backward error only)
+    double energy_total;    // Sum of update energies ~ ||x - x_0||_A^2
+    double energy_window[STOP_ESTIMATE_DELAY];  // Last update energies
+    int energy_count;       // Updates recorded
+    double value;           // Criterion value at the last check
+    double checked_norm;    // ||r|| given to the last stop_check
+} StopState;
+
+// Solver settings (fill with solver_default_options, then override fields)
+typedef struct {
+    int max_iter;           // Maximum number of iterations
+    double tol;             // Relative tolerance on ||b - Ax|| / ||b||
+    int num_threads;        // OpenMP threads (parallel solver only, 0 = keep current)
+    int verbose;            // 1 = print convergence messages
+    
+    // Residual replacement: recompute r = b - A*x to remove rounding drift
+    // between the recursively updated residual and the true residual
+    int replace_interval;   // Replace every k iterations (0 = off)
+    double replace_drift;   // Replace once ||r|| dropped by this factor since the
+                            // last replacement (0 = off)
+    int confirm_converged;  // 1 = check true residual before declaring convergence
+    
+    SolverWorkspace *workspace; // Preallocated work vectors (NULL = allocate per solve)
+    Preconditioner *precond;    // Right preconditioner (NULL = none)
+    LinearOperator *op;         // Operator used instead of sys->A (NULL = CSR)
+    ThreadPool *pool;           // Pool for bicgstab_pool_ex (NULL = temporary pool)
+    
+    StopCriterion stop_criterion;   // Which quantity is compared with tol
+    int fused_norms;        // 1 = compute ||s||, ||r|| inside the s and r updates
+    int check_interval;     // Without fused norms, k > 1: ||r|| comes with rho (tested one
+                            // reduction late), ||s|| is only tested every k iterations
+    int deterministic;      // 1 = fixed-order reductions, bitwise identical for any thread count
+    SpmvKernel spmv_kernel; // CSR SpMV variant (serial/parallel solvers, SPMV_AUTO = measure)
+    int prefetch_distance;  // Entries ahead for SPMV_PREFETCH (0 = default, or tuned by AUTO)
+    ValuePrecision value_precision; // Matrix values for the CSR SpMV (serial/parallel solvers;
+                                    // kept only if within LOWPREC_SAFETY * tol, see lowprec.h)
+    
+    // Error-based stopping: also stop once the algebraic error bound
+    // ||A^{-1}|| * ||r|| / sqrt(n) (RMS) is below error_target
+    double error_target;        // Target RMS algebraic error (0 = off)
+    double inv_norm_estimate;   // Estimate of ||A^{-1}||_2 used by error_target
+} SolverOptions;
+
+// Per-kernel statistics collected during one solve
+typedef struct {
+    int iterations;         // Iterations performed
+    int spmv_count;         // Sparse matrix-vector products
+    double spmv_time;
+    int dot_count;          // Dot products / norms
+    double dot_time;
+    int axpy_count;         // Vector updates (axpy, axpby, copies)
+    double axpy_time;
+    int precond_count;      // Preconditioner applications
+    double precond_time;
+    int replace_count;      // Residual replacements (fused r = b - A*x)
+    double replace_time;
+    double recursive_residual;  // Last recursive ||r|| / ||b||
+    double true_residual;       // Last true ||b - Ax|| / ||b|| (if computed)
+    double stop_value;          // Stopping criterion value at exit
+} SolverStats;
+
+// Time one kernel call and count it, e.g. STATS_TIME(st, dot, rho = dot(r0, r, n));
+#define STATS_TIME(st, kernel, call) do {                 \
+        double t_kernel_ = wall_time();                   \
+        call;                                             \
+        (st)->kernel##_time += wall_time() - t_kernel_;   \
+        (st)->kernel##_count++;                           \
+    } while (0)
+
+// Common signature of the *_ex solvers, so drivers can take either one
+typedef int (*SolverFn)(FEMSystem *sys, const SolverOptions *opts,
+                        SolverStats *stats, double *solve_time);
+
+// Fill options with defaults (max_iter = 10000, tol = 1e-8, replacement on)
+void solver_default_options(SolverOptions *opts);
+
+// Allocate / free work vectors for systems of up to n unknowns (create:
+// NULL if out of memory; the solvers then return -1)
+SolverWorkspace* solver_workspace_create(int n);
+void solver_workspace_free(SolverWorkspace *ws);
+
+// Zero all counters and timers
+void solver_stats_reset(SolverStats *stats);
+
+// Print per-kernel statistics table
+void print_solver_stats(const char *label, const SolverStats *stats);
+
+// Stopping test setup (anorm only needed for STOP_BACKWARD_ERROR)
+void stop_state_init(StopState *stop, double bnorm, double r0norm, double anorm);
+
+// Convergence test for the selected criterion given the current ||r||
+// (also honours opts->error_target)
+int stop_check(const SolverOptions *opts, StopState *stop, double r_norm, int n);
+
+// Confirms a passed stop_check with the true ||b - Ax|| (confirm_converged).
+// The energy estimate does not depend on ||r||, so for it the true residual
+// must instead stay within STOP_CONFIRM_DRIFT of the recursive one
+int stop_confirm(const SolverOptions *opts, StopState *stop, double true_norm, int n);
+
+// Records the A-norm energy (x_{k+1} - x_k)^T (r_k - r_{k+1}) of one update
+// (STOP_ENERGY_ESTIMATE: the sum over the last STOP_ESTIMATE_DELAY updates
+// estimates the squared A-norm error of the iterate that many steps back)
+void stop_record_energy(StopState *stop, double energy);
+
+// ||A||_2 estimate for operators without a stored matrix (power iteration)
+double operator_norm_estimate(LinearOperator *op, double *work1, double *work2);
+
+// 1 if x holds a nonzero initial guess
+int initial_guess_nonzero(const double *x, int n);
+
+// SpMV kernel a CSR solve plans with: plain under an operator, and
+// SPMV_AUTO without its timing probe (SPMV_AUTO_FIXED) for deterministic
+// solves, so neither the kernel nor its summation order depends on timing
+SpmvKernel solver_spmv_kernel(const SolverOptions *opts);
+
+// Wall-clock time in seconds (monotonic clock, for kernel timing)
+double wall_time(void);
+
+// Serial BICGSTAB
+// Returns: number of iterations, or -1 if failed
+int bicgstab_serial(FEMSystem *sys, int max_iter, double tol, double *solve_time);
+int bicgstab_serial_ex(FEMSystem *sys, const SolverOptions *opts,
+                       SolverStats *stats, double *solve_time);
+
+// OpenMP parallel BICGSTAB
+// Returns: number of iterations, or -1 if failed
+int bicgstab_parallel(FEMSystem *sys, int max_iter, double tol, int num_threads, double *solve_time);
+int bicgstab_parallel_ex(FEMSystem *sys, const SolverOptions *opts,
+                         SolverStats *stats, double *solve_time);
+
+// Thread-pool BICGSTAB (bicgstab_pool.c): the whole solve runs as one task
+// on a persistent spin-barrier pool with row blocks per thread.
+// fused_norms / check_interval / deterministic do not apply (norms are always
+// fused; reductions are in thread order, reproducible for a fixed pool size)
+int bicgstab_pool_ex(FEMSystem *sys, const SolverOptions *opts,
+                     SolverStats *stats, double *solve_time);
+
+// Task-graph BICGSTAB (bicgstab_tasks.c): chunked kernels as OpenMP tasks
+// with per-chunk depend clauses instead of global barriers; x updates run in
+// the background. Norms are always fused; partial sums are combined in chunk
+// order, so results do not depend on the thread count
+int bicgstab_tasks_ex(FEMSystem *sys, const SolverOptions *opts,
+                      SolverStats *stats, double *solve_time);
+
+// Interleaved-layout BICGSTAB (bicgstab_interleaved.c): r, r0, p, v, s, t
+// stored as blocks of 8 entries of each vector (AoSoA), so fused updates read
+// one address stream. Own work vectors (opts->workspace is not used), norms
+// always fused. Preconditioned, operator and deterministic solves fall back
+// to bicgstab_parallel_ex
+int bicgstab_interleaved_ex(FEMSystem *sys, const SolverOptions *opts,
+                            SolverStats *stats, double *solve_time);
+
+#endif // BICGSTAB_H
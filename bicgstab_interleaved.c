@@ -0,0 +1,374 @@
+// bicgstab_interleaved.c
+// BICGSTAB with interleaved (AoSoA) work vectors: r, r0, p, v, s, t are
+// stored block by block, each block holding IL_WIDTH consecutive entries of
+// every vector (one cache line per vector). A kernel that reads p[i], r[i]
+// and v[i] together then walks one address stream instead of three, which
+// keeps the hardware prefetchers and the TLB on a single region once the
+// vectors no longer fit in the last-level cache
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <omp.h>
+#include "bicgstab.h"
+
+// Entries of one vector per block (8 doubles = one 64-byte line)
+#define IL_SHIFT 3
+#define IL_WIDTH (1 << IL_SHIFT)
+
+// Vector slots inside a block, ordered so the pairs read together by the
+// dot products (r0.r, s.t) share a 128-byte line pair (adjacent-line prefetch)
+enum { F_R0, F_R, F_V, F_P, F_S, F_T, IL_FIELDS };
+
+// Doubles per block
+#define IL_STRIDE (IL_FIELDS * IL_WIDTH)
+
+// Offset of entry i of the vector in slot f (shift and mask: i is never negative)
+#define IL_INDEX(f, i) (((size_t)(unsigned)(i) >> IL_SHIFT) * IL_STRIDE + (f) * IL_WIDTH + \
+                        ((unsigned)(i) & (IL_WIDTH - 1)))
+#define IL_AT(w, f, i) ((w)[IL_INDEX(f, i)])
+
+// Start of slot f in block k
+#define IL_BLOCK(w, f, k) ((w) + (size_t)(k) * IL_STRIDE + (f) * IL_WIDTH)
+
+// Padding entries of the last block stay zero, so the dot products and
+// vector updates run over whole blocks; only kernels that touch x, b or
+// rows of A stop at n. Slots never overlap, so the per-block pointers are
+// restrict-qualified
+
+// Interleaved dot product of slots fa and fb
+static double il_dot(const double *w, int fa, int fb, int nb) {
+    double sum = 0.0;
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for (int k = 0; k < nb; k++) {
+        const double *restrict a = IL_BLOCK(w, fa, k), *restrict b = IL_BLOCK(w, fb, k);
+        for (int l = 0; l < IL_WIDTH; l++) {
+            sum += a[l] * b[l];
+        }
+    }
+    return sum;
+}
+
+// p = r (restart) or p = r + beta*(p - omega*v)
+static void il_update_direction(double *w, int nb, int restart, double beta, double omega) {
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < nb; k++) {
+        double *restrict p = IL_BLOCK(w, F_P, k);
+        const double *restrict r = IL_BLOCK(w, F_R, k), *restrict v = IL_BLOCK(w, F_V, k);
+        if (restart) {
+            for (int l = 0; l < IL_WIDTH; l++) p[l] = r[l];
+        } else {
+            for (int l = 0; l < IL_WIDTH; l++) p[l] = r[l] + beta * (p[l] - omega * v[l]);
+        }
+    }
+}
+
+// s = r - alpha*v, returns ||s||^2
+static double il_update_s(double *w, int nb, double alpha) {
+    double norm2 = 0.0;
+    #pragma omp parallel for reduction(+:norm2) schedule(static)
+    for (int k = 0; k < nb; k++) {
+        double *restrict s = IL_BLOCK(w, F_S, k);
+        const double *restrict r = IL_BLOCK(w, F_R, k), *restrict v = IL_BLOCK(w, F_V, k);
+        for (int l = 0; l < IL_WIDTH; l++) {
+            s[l] = r[l] - alpha * v[l];
+            norm2 += s[l] * s[l];
+        }
+    }
+    return norm2;
+}
+
+// x = x + alpha*p and r = s - omega*t together (both read the same block),
+// returns ||r||^2 and the next rho = r0.r (r0 sits in the same block); with
+// energy != NULL also the update's A-norm energy dx^T (A dx), where
+// A dx = alpha*v + omega*t
+static double il_update_x_r(double *w, double *x, int n, double alpha, double omega,
+                            double *rho_next, double *energy) {
+    int nb = (n + IL_WIDTH - 1) / IL_WIDTH;
+    double norm2 = 0.0, rho = 0.0, en = 0.0;
+    #pragma omp parallel for reduction(+:norm2, rho, en) schedule(static)
+    for (int k = 0; k < nb; k++) {
+        double *restrict r = IL_BLOCK(w, F_R, k);
+        const double *restrict r0 = IL_BLOCK(w, F_R0, k);
+        const double *restrict p = IL_BLOCK(w, F_P, k), *restrict v = IL_BLOCK(w, F_V, k);
+        const double *restrict s = IL_BLOCK(w, F_S, k), *restrict t = IL_BLOCK(w, F_T, k);
+        double *restrict xk = x + k * IL_WIDTH;
+        int len = n - k * IL_WIDTH < IL_WIDTH ? n - k * IL_WIDTH : IL_WIDTH;
+        for (int l = 0; l < len; l++) {
+            double dx = alpha * p[l] + omega * s[l];
+            xk[l] += dx;
+            en += dx * (alpha * v[l] + omega * t[l]);
+        }
+        for (int l = 0; l < IL_WIDTH; l++) {
+            r[l] = s[l] - omega * t[l];
+            norm2 += r[l] * r[l];
+            rho += r0[l] * r[l];
+        }
+    }
+    *rho_next = rho;
+    if (energy) *energy = en;
+    return norm2;
+}
+
+// x = x + alpha*p (early exit on ||s||)
+static void il_update_x_p(const double *w, double *x, int n, double alpha) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        x[i] += alpha * IL_AT(w, F_P, i);
+    }
+}
+
+// Column indices translated to offsets into the interleaved storage (slot 0),
+// so the SpMV gathers with one load per entry and no index arithmetic
+static void il_translate_columns(CSRMatrix *A, int *col_il) {
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < A->nnz; j++) {
+        col_il[j] = (int)IL_INDEX(0, A->col_idx[j]);
+    }
+}
+
+// Slot fy = A * slot fx (col_il from il_translate_columns), with the dot
+// products y.(slot fd) and y.y taken while the block is in cache
+static void il_matvec_dot(CSRMatrix *A, const int *col_il, double *w, int fx, int fy, int fd,
+                          double *yd_out, double *yy_out) {
+    int n = A->n;
+    int nb = (n + IL_WIDTH - 1) / IL_WIDTH;
+    const double *xf = w + fx * IL_WIDTH;
+    double yd = 0.0, yy = 0.0;
+    #pragma omp parallel for reduction(+:yd, yy) schedule(static)
+    for (int k = 0; k < nb; k++) {
+        double *restrict y = IL_BLOCK(w, fy, k);
+        const double *restrict d = IL_BLOCK(w, fd, k);
+        int i0 = k * IL_WIDTH;
+        int i1 = i0 + IL_WIDTH < n ? i0 + IL_WIDTH : n;
+        for (int i = i0; i < i1; i++) {
+            double sum = 0.0;
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+                sum += A->values[j] * xf[col_il[j]];
+            }
+            y[i - i0] = sum;
+            yd += sum * d[i - i0];
+            yy += sum * sum;
+        }
+    }
+    *yd_out = yd;
+    *yy_out = yy;
+}
+
+// r = b - A*x into slot F_R, returns ||r||^2
+static double il_residual(CSRMatrix *A, const double *x, const double *b, double *w) {
+    int n = A->n;
+    int nb = (n + IL_WIDTH - 1) / IL_WIDTH;
+    double norm2 = 0.0;
+    #pragma omp parallel for reduction(+:norm2) schedule(static)
+    for (int k = 0; k < nb; k++) {
+        double *r = IL_BLOCK(w, F_R, k);
+        int i0 = k * IL_WIDTH;
+        int i1 = i0 + IL_WIDTH < n ? i0 + IL_WIDTH : n;
+        for (int i = i0; i < i1; i++) {
+            double sum = b[i];
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+                sum -= A->values[j] * x[A->col_idx[j]];
+            }
+            r[i - i0] = sum;
+            norm2 += sum * sum;
+        }
+    }
+    return norm2;
+}
+
+static double norm_parallel(const double *x, int n) {
+    double sum = 0.0;
+    #pragma omp parallel for reduction(+:sum)
+    for (int i = 0; i < n; i++) {
+        sum += x[i] * x[i];
+    }
+    return sqrt(sum);
+}
+
+// Residual replacement into slot F_R; returns ||b - Ax|| / ||b||
+static double il_replace_residual(CSRMatrix *A, const double *x, const double *b, double *w,
+                                  double bnorm, SolverStats *st) {
+    double norm2;
+    STATS_TIME(st, replace, norm2 = il_residual(A, x, b, w));
+    st->true_residual = sqrt(norm2) / bnorm;
+    return st->true_residual;
+}
+
+// Interleaved-layout BICGSTAB
+// Unpreconditioned CSR solves only; with a preconditioner, an operator or
+// deterministic reductions the call is passed on to bicgstab_parallel_ex
+// Norms are always fused into the vector updates
+int bicgstab_interleaved_ex(FEMSystem *sys, const SolverOptions *opts,
+                            SolverStats *stats, double *solve_time) {
+    if (opts->precond || opts->op || opts->deterministic) {
+        return bicgstab_parallel_ex(sys, opts, stats, solve_time);
+    }
+
+    int n = sys->n;
+    CSRMatrix *A = &sys->A;
+    double *b = sys->b;
+    double *x = sys->x;
+    int max_iter = opts->max_iter;
+
+    SolverStats local_stats;
+    SolverStats *st = stats ? stats : &local_stats;
+    solver_stats_reset(st);
+
+    int num_threads = opts->num_threads > 0 ? opts->num_threads : omp_get_max_threads();
+    omp_set_num_threads(num_threads);
+
+    // All six work vectors in one zeroed arena, block by block, followed by
+    // the translated column indices
+    int nb = (n + IL_WIDTH - 1) / IL_WIDTH;
+    Arena arena;
+    if (arena_init(&arena, arena_size((size_t)nb * IL_STRIDE, sizeof(double)) +
+                           arena_size(A->nnz, sizeof(int))) != 0) {
+        *solve_time = 0.0;
+        return -1;
+    }
+    double *w = (double*)arena_alloc(&arena, (size_t)nb * IL_STRIDE, sizeof(double));
+    int *col_il = (int*)arena_alloc(&arena, A->nnz, sizeof(int));
+
+    double start = omp_get_wtime();
+    il_translate_columns(A, col_il);
+
+    double bnorm;
+    STATS_TIME(st, dot, bnorm = norm_parallel(b, n));
+    if (bnorm == 0.0) bnorm = 1.0;
+
+    double r_norm;
+    STATS_TIME(st, spmv, r_norm = sqrt(il_residual(A, x, b, w)));
+    double r_norm_ref = r_norm;
+
+    StopState stop;
+    double anorm = opts->stop_criterion == STOP_BACKWARD_ERROR ? csr_norm_inf(A) : 0.0;
+    stop_state_init(&stop, bnorm, r_norm, anorm);
+    int check_true = opts->confirm_converged;
+
+    // Shadow residual: r0 = r for a warm start, constant otherwise (as in
+    // the other solvers); padding entries stay zero
+    int warm = initial_guess_nonzero(x, n);
+    #pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        IL_AT(w, F_R0, i) = warm ? IL_AT(w, F_R, i) : 1.0;
+    }
+
+    double rho = 1.0, alpha = 1.0, omega = 1.0;
+    double rho_prev, beta = 0.0;
+    double rho_next = 0.0;  // r0.r from the last r update
+    int have_rho = 0;       // 0 = recompute r0.r (start, after a replacement)
+    int restart = 1;
+    int converged = 0;
+
+    int iter;
+    for (iter = 0; iter < max_iter; iter++) {
+        rho_prev = rho;
+        if (have_rho) {
+            rho = rho_next;
+        } else {
+            STATS_TIME(st, dot, rho = il_dot(w, F_R0, F_R, nb));
+        }
+        have_rho = 0;
+
+        if (fabs(rho) < 1e-30) {
+            printf("BICGSTAB (interleaved): rho breakdown at iteration %d\n", iter);
+            break;
+        }
+
+        if (!restart) beta = (rho / rho_prev) * (alpha / omega);
+        STATS_TIME(st, axpy, il_update_direction(w, nb, restart, beta, omega));
+        restart = 0;
+
+        // v = A*p with r0.v in the same pass
+        double r0v, vv;
+        STATS_TIME(st, spmv, il_matvec_dot(A, col_il, w, F_P, F_V, F_R0, &r0v, &vv));
+        alpha = rho / r0v;
+
+        // s = r - alpha*v
+        double s_norm;
+        STATS_TIME(st, axpy, s_norm = sqrt(il_update_s(w, nb, alpha)));
+
+        st->recursive_residual = s_norm / bnorm;
+        if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = norm_parallel(x, n));
+        }
+        if (stop_check(opts, &stop, s_norm, n)) {
+            STATS_TIME(st, axpy, il_update_x_p(w, x, n, alpha));
+            double res = s_norm / bnorm;
+            if (check_true) res = il_replace_residual(A, x, b, w, bnorm, st);
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("BICGSTAB (interleaved, %d threads) converged at iteration %d (residual: %.2e)\n",
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
+        }
+
+        // t = A*s with t.s and t.t in the same pass
+        double ts, tt;
+        STATS_TIME(st, spmv, il_matvec_dot(A, col_il, w, F_S, F_T, F_S, &ts, &tt));
+        omega = ts / tt;
+
+        // x = x + alpha*p + omega*s, r = s - omega*t and the next r0.r in one pass
+        double energy;
+        int want_energy = opts->stop_criterion == STOP_ENERGY_ESTIMATE;
+        STATS_TIME(st, axpy, r_norm = sqrt(il_update_x_r(w, x, n, alpha, omega, &rho_next,
+                                                         want_energy ? &energy : NULL)));
+        if (want_energy) stop_record_energy(&stop, energy);
+        have_rho = 1;
+
+        st->recursive_residual = r_norm / bnorm;
+        if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = norm_parallel(x, n));
+        }
+        if (stop_check(opts, &stop, r_norm, n)) {
+            double res = r_norm / bnorm;
+            if (check_true) res = il_replace_residual(A, x, b, w, bnorm, st);
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("BICGSTAB (interleaved, %d threads) converged at iteration %d (residual: %.2e)\n",
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            have_rho = 0;
+            continue;
+        }
+
+        if ((opts->replace_interval > 0 && (iter+1) % opts->replace_interval == 0) ||
+            (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+            r_norm_ref = il_replace_residual(A, x, b, w, bnorm, st) * bnorm;
+            have_rho = 0;
+        }
+
+        if (fabs(omega) < 1e-30) {
+            printf("BICGSTAB (interleaved): omega breakdown at iteration %d\n", iter);
+            break;
+        }
+    }
+
+    *solve_time = omp_get_wtime() - start;
+    st->iterations = iter;
+    st->stop_value = stop.value;
+
+    arena_release(&arena);
+
+    if (!converged && iter >= max_iter) {
+        printf("BICGSTAB (interleaved) did not converge within %d iterations\n", max_iter);
+        return -1;
+    }
+
+    return iter;
+}
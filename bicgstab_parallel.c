@@ -7,160 +7,295 @@
 #include <math.h>
 #include <string.h>
 #include <omp.h>
-#include "fem_matrix.h"
+#include "bicgstab.h"
+#include "parallel_kernels.h"
+#include "blas1.h"
 
-// Parallel vector dot product
-static double dot_product_parallel(double *a, double *b, int n) {
-    double sum = 0.0;
-    // OpenMP reduction: each thread computes partial sum, then combines
-    #pragma omp parallel for reduction(+:sum)
-    for (int i = 0; i < n; i++) {
-        sum += a[i] * b[i];
-    }
-    return sum;
-}
-
-// Parallel vector copy
-static void vector_copy_parallel(double *src, double *dst, int n) {
-    #pragma omp parallel for
-    for (int i = 0; i < n; i++) {
-        dst[i] = src[i];
-    }
-}
-
-// Parallel y = a*x + y
-static void vector_axpy_parallel(double a, double *x, double *y, int n) {
-    #pragma omp parallel for
-    for (int i = 0; i < n; i++) {
-        y[i] += a * x[i];
-    }
-}
-
-// Parallel z = a*x + b*y
-static void vector_axpby_parallel(double a, double *x, double b, double *y, double *z, int n) {
-    #pragma omp parallel for
-    for (int i = 0; i < n; i++) {
-        z[i] = a * x[i] + b * y[i];
+// Parallel fused solution update with energy
+// x = x + alpha*p_hat + omega*s_hat in one pass, returning the update's
+// A-norm energy dx^T (A dx) with A dx = alpha*v + omega*t = r_old - r_new
+static double update_solution_energy_parallel(double *x, double *p_hat, double *s_hat,
+                                     double *v, double *t, double alpha, double omega,
+                                     int n, ReduceBuffer *red) {
+    if (red) {
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < red->nblocks; k++) {
+            double part = 0.0;
+            for (int i = k * REDUCE_BLOCK; i < block_end(k, n); i++) {
+                double dx = alpha * p_hat[i] + omega * s_hat[i];
+                x[i] += dx;
+                part += dx * (alpha * v[i] + omega * t[i]);
+            }
+            red->partials[k] = part;
+        }
+        return tree_sum(red->partials, red->nblocks);
     }
-}
-
-// Parallel vector norm
-static double vector_norm_parallel(double *x, int n) {
-    return sqrt(dot_product_parallel(x, x, n));
-}
-
-// Parallel matrix-vector multiplication for CSR format
-static void matvec_csr_parallel(CSRMatrix *A, double *x, double *y) {
-    int n = A->n;
-    // Each row is independent, so we can parallelize over rows
-    #pragma omp parallel for
+    
+    double energy = 0.0;
+    #pragma omp parallel for reduction(+:energy)
     for (int i = 0; i < n; i++) {
-        double sum = 0.0;
-        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
-            sum += A->values[j] * x[A->col_idx[j]];
-        }
-        y[i] = sum;
+        double dx = alpha * p_hat[i] + omega * s_hat[i];
+        x[i] += dx;
+        energy += dx * (alpha * v[i] + omega * t[i]);
     }
+    return energy;
 }
 
 // Parallel BICGSTAB solver
-// num_threads: number of OpenMP threads to use
-int bicgstab_parallel(FEMSystem *sys, int max_iter, double tol, int num_threads, double *solve_time) {
+// Starts from the guess in sys->x; opts->num_threads selects the OpenMP team size
+// Returns: number of iterations, or -1 if failed
+int bicgstab_parallel_ex(FEMSystem *sys, const SolverOptions *opts,
+                         SolverStats *stats, double *solve_time) {
     int n = sys->n;
     CSRMatrix *A = &sys->A;
     double *b = sys->b;
     double *x = sys->x;
+    int max_iter = opts->max_iter;
+    
+    SolverStats local_stats;
+    SolverStats *st = stats ? stats : &local_stats;
+    solver_stats_reset(st);
     
     // Set number of threads
+    int num_threads = opts->num_threads > 0 ? opts->num_threads : omp_get_max_threads();
     omp_set_num_threads(num_threads);
     
-    // Allocate working vectors
-    double *r = (double*)malloc(n * sizeof(double));
-    double *r0 = (double*)malloc(n * sizeof(double));
-    double *p = (double*)malloc(n * sizeof(double));
-    double *v = (double*)malloc(n * sizeof(double));
-    double *s = (double*)malloc(n * sizeof(double));
-    double *t = (double*)malloc(n * sizeof(double));
+    // Working vectors: caller's workspace if given, otherwise allocate
+    SolverWorkspace *ws = opts->workspace;
+    int own_ws = (ws == NULL || ws->n < n);
+    if (own_ws) ws = solver_workspace_create(n);
+    if (!ws) {
+        *solve_time = 0.0;
+        return -1;
+    }
+    double *r = ws->r;      // residual
+    double *r0 = ws->r0;    // shadow residual
+    double *p = ws->p;      // search direction
+    double *v = ws->v;      // A*p
+    double *s = ws->s;      // intermediate residual
+    double *t = ws->t;      // A*s
+    
+    // Right preconditioning: solve A M^{-1} y = b, x = M^{-1} y
+    // Without a preconditioner p_hat / s_hat are just p / s
+    Preconditioner *pc = opts->precond;
+    double *p_hat = pc ? ws->p_hat : p;     // M^{-1} p
+    double *s_hat = pc ? ws->s_hat : s;     // M^{-1} s
+    
+    // Fixed-order reduction buffer when results must not depend on the thread count
+    ReduceBuffer *red = opts->deterministic ? reduce_buffer_create(n) : NULL;
+    
+    // Vectors beyond the cache are written with streaming stores
+    int stream = blas1_stream(n);
+    
+    // SpMV kernel for this matrix (SPMV_AUTO measures its column locality),
+    // on narrowed values if asked for and accurate enough for tol
+    SpmvPlan plan;
+    spmv_plan_init(&plan, A, solver_spmv_kernel(opts), opts->prefetch_distance);
+    spmv_plan_set_values(&plan, A, opts->op ? VALUES_FP64 : opts->value_precision, opts->tol);
     
     // Start timing (use omp_get_wtime for better precision)
     double start = omp_get_wtime();
     
-    // Initial guess: x = 0
-    // Initial residual: r = b - A*x = b
-    vector_copy_parallel(b, r, n);
+    double bnorm;
+    STATS_TIME(st, dot, bnorm = vector_norm_parallel(b, n, red));
+    if (bnorm == 0.0) bnorm = 1.0;
+    
+    // Initial residual: r = b - A*x (x may hold a nonzero initial guess)
+    double r_norm;
+    STATS_TIME(st, spmv, r_norm = sqrt(compute_residual_parallel(opts, A, x, b, r, t, red)));
+    double r_norm_ref = r_norm;     // ||r|| at the last replacement
+    
+    // Stopping test state (||A|| only needed for the backward error)
+    StopState stop;
+    double anorm = 0.0;
+    if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+        anorm = opts->op ? operator_norm_estimate(opts->op, v, t) : csr_norm_inf(A);
+    }
+    stop_state_init(&stop, bnorm, r_norm, anorm);
+    int check_true = opts->confirm_converged;
     
     // FIX: Use a constant r0 to avoid breakdown when boundary conditions
-    // cause r to change its support (non-zero pattern)
+    // cause r to change its support (non-zero pattern). A warm start's
+    // residual already has support everywhere, and r0 = r is the better
+    // shadow vector there (the constant one is nearly orthogonal to it)
+    int warm = initial_guess_nonzero(x, n);
     #pragma omp parallel for
     for (int i = 0; i < n; i++) {
-        r0[i] = 1.0;  // Uniform vector has support everywhere
+        r0[i] = warm ? r[i] : 1.0;
     }
     
-    vector_copy_parallel(r, p, n);
-    
     double rho = 1.0, alpha = 1.0, omega = 1.0;
     double rho_prev, beta;
+    int restart = 1;    // 1 = take p = r (first iteration or after a replacement)
+    int converged = 0;
     
-    double bnorm = vector_norm_parallel(b, n);
-    if (bnorm == 0.0) bnorm = 1.0;
+    // Without fused norms and check_interval > 1, ||r|| comes with rho: the
+    // r of one iteration is tested at the start of the next, so the stop
+    // test and the drift replacement still see every iterate (x is not
+    // touched in between, so nothing needs rolling back). The separate
+    // ||s|| pass for the half-step exit is made every check_interval
+    // iterations only; skipping it costs no iterations since ||r|| <= ||s||.
+    int lagged = !opts->fused_norms && opts->check_interval > 1;
+    int pending = 0;    // 1 = r updated but not yet tested (lagged only)
     
     int iter;
-    for (iter = 0; iter < max_iter; iter++) {
+    for (iter = 0; iter < max_iter + lagged; iter++) {
         rho_prev = rho;
-        rho = dot_product_parallel(r0, r, n);
+        if (!lagged) {
+            STATS_TIME(st, dot, rho = dot_product_parallel(r0, r, n, red));
+        } else {
+            double rr;
+            STATS_TIME(st, dot, dot_product_pair_parallel(r0, r, r, r, &rho, &rr, n, red));
+            if (pending) {
+                // Test and drift replacement of the previous iteration's r
+                pending = 0;
+                r_norm = sqrt(rr);
+                st->recursive_residual = r_norm / bnorm;
+                if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+                    STATS_TIME(st, dot, stop.xnorm = vector_norm_parallel(x, n, red));
+                }
+                int replaced = 0;
+                if (stop_check(opts, &stop, r_norm, n)) {
+                    double res = r_norm / bnorm;
+                    if (check_true) {
+                        res = replace_residual(opts, A, x, b, r, t, bnorm, st, red);
+                    }
+                    if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                        if (opts->verbose) {
+                            printf("BICGSTAB (parallel, %d threads) converged at iteration %d (residual: %.2e)\n", 
+                                   num_threads, iter, res);
+                        }
+                        converged = 1;
+                        break;
+                    }
+                    r_norm_ref = res * bnorm;
+                    restart = replaced = 1;
+                } else if ((opts->replace_interval > 0 && iter % opts->replace_interval == 0) ||
+                           (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+                    r_norm_ref = replace_residual(opts, A, x, b, r, t, bnorm, st, red) * bnorm;
+                    replaced = 1;
+                }
+                if (replaced) STATS_TIME(st, dot, rho = dot_product_parallel(r0, r, n, red));
+            }
+            if (iter == max_iter) break;
+        }
         
         if (fabs(rho) < 1e-30) {
             printf("BICGSTAB (parallel): rho breakdown at iteration %d\n", iter);
             break;
         }
         
-        if (iter == 0) {
-            vector_copy_parallel(r, p, n);
+        if (restart) {
+            STATS_TIME(st, axpy, vector_copy_parallel(r, p, n, stream));
+            restart = 0;
         } else {
             beta = (rho / rho_prev) * (alpha / omega);
-            // p = r + beta*(p - omega*v)
-            #pragma omp parallel for
-            for (int i = 0; i < n; i++) {
-                p[i] = r[i] + beta * (p[i] - omega * v[i]);
-            }
+            STATS_TIME(st, axpy, update_direction_parallel(p, r, v, beta, omega, n));
         }
         
-        // v = A*p
-        matvec_csr_parallel(A, p, v);
+        // v = A*M^{-1}*p with r0.v fused into the SpMV
+        if (pc) STATS_TIME(st, precond, precond_apply(pc, p, p_hat, 1));
+        double r0v;
+        STATS_TIME(st, spmv, r0v = apply_matrix_dot_parallel(opts, A, &plan, p_hat, v, r0, red));
+        alpha = rho / r0v;
         
-        alpha = rho / dot_product_parallel(r0, v, n);
+        // The half-step test needs a separate ||s|| pass unless fused, so
+        // with lagged tests it is only made every check_interval iterations
+        int check_now = !lagged || (iter + 1) % opts->check_interval == 0;
         
-        // s = r - alpha*v
-        vector_axpby_parallel(1.0, r, -alpha, v, s, n);
+        // s = r - alpha*v (with ||s|| folded into the update when fused)
+        double s_norm = 0.0;
+        if (opts->fused_norms) {
+            STATS_TIME(st, axpy, s_norm = sqrt(vector_axpby_norm_parallel(1.0, r, -alpha, v, s, n, stream, red)));
+        } else {
+            STATS_TIME(st, axpy, vector_axpby_parallel(1.0, r, -alpha, v, s, n, stream));
+            if (check_now) STATS_TIME(st, dot, s_norm = vector_norm_parallel(s, n, red));
+        }
         
         // Check convergence
-        double s_norm = vector_norm_parallel(s, n);
-        if (s_norm / bnorm < tol) {
-            vector_axpy_parallel(alpha, p, x, n);
-            printf("BICGSTAB (parallel, %d threads) converged at iteration %d (residual: %.2e)\n", 
-                   num_threads, iter+1, s_norm/bnorm);
-            break;
+        if (check_now) st->recursive_residual = s_norm / bnorm;
+        if (check_now && opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = vector_norm_parallel(x, n, red));
+        }
+        if (check_now && stop_check(opts, &stop, s_norm, n)) {
+            // x = x + alpha*p_hat
+            STATS_TIME(st, axpy, vector_axpy_parallel(alpha, p_hat, x, n));
+            
+            // Confirm with the true residual; on drift continue from it
+            double res = s_norm / bnorm;
+            if (check_true) {
+                res = replace_residual(opts, A, x, b, r, t, bnorm, st, red);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("BICGSTAB (parallel, %d threads) converged at iteration %d (residual: %.2e)\n", 
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
         }
         
-        // t = A*s
-        matvec_csr_parallel(A, s, t);
-        
-        omega = dot_product_parallel(t, s, n) / dot_product_parallel(t, t, n);
+        // t = A*M^{-1}*s with t.s and t.t fused into the SpMV
+        if (pc) STATS_TIME(st, precond, precond_apply(pc, s, s_hat, 1));
+        double ts, tt;
+        STATS_TIME(st, spmv, apply_matrix_dot2_parallel(opts, A, &plan, s_hat, t, s, &ts, &tt, red));
+        omega = ts / tt;
         
-        // x = x + alpha*p + omega*s
-        vector_axpy_parallel(alpha, p, x, n);
-        vector_axpy_parallel(omega, s, x, n);
+        // x = x + alpha*p_hat + omega*s_hat
+        if (opts->stop_criterion == STOP_ENERGY_ESTIMATE) {
+            double energy;
+            STATS_TIME(st, axpy, energy = update_solution_energy_parallel(x, p_hat, s_hat, v, t,
+                                                                   alpha, omega, n, red));
+            stop_record_energy(&stop, energy);
+        } else {
+            STATS_TIME(st, axpy, vector_axpy_parallel(alpha, p_hat, x, n));
+            STATS_TIME(st, axpy, vector_axpy_parallel(omega, s_hat, x, n));
+        }
         
         // r = s - omega*t
-        vector_axpby_parallel(1.0, s, -omega, t, r, n);
+        if (opts->fused_norms) {
+            STATS_TIME(st, axpy, r_norm = sqrt(vector_axpby_norm_parallel(1.0, s, -omega, t, r, n, stream, red)));
+        } else {
+            STATS_TIME(st, axpy, vector_axpby_parallel(1.0, s, -omega, t, r, n, stream));
+            if (!lagged) STATS_TIME(st, dot, r_norm = vector_norm_parallel(r, n, red));
+        }
         
         // Check convergence
-        double r_norm = vector_norm_parallel(r, n);
-        if (r_norm / bnorm < tol) {
-            printf("BICGSTAB (parallel, %d threads) converged at iteration %d (residual: %.2e)\n", 
-                   num_threads, iter+1, r_norm/bnorm);
-            iter++;
-            break;
+        if (!lagged) st->recursive_residual = r_norm / bnorm;
+        if (!lagged && opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = vector_norm_parallel(x, n, red));
+        }
+        if (!lagged && stop_check(opts, &stop, r_norm, n)) {
+            double res = r_norm / bnorm;
+            if (check_true) {
+                res = replace_residual(opts, A, x, b, r, t, bnorm, st, red);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("BICGSTAB (parallel, %d threads) converged at iteration %d (residual: %.2e)\n", 
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
+        }
+        
+        // Periodic or drift-triggered residual replacement (lagged: at the
+        // test of this r at the start of the next iteration)
+        if (lagged) {
+            pending = 1;
+        } else if ((opts->replace_interval > 0 && (iter+1) % opts->replace_interval == 0) ||
+                   (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+            r_norm_ref = replace_residual(opts, A, x, b, r, t, bnorm, st, red) * bnorm;
         }
         
         if (fabs(omega) < 1e-30) {
@@ -172,19 +307,28 @@ int bicgstab_parallel(FEMSystem *sys, int max_iter, double tol, int num_threads,
     // End timing
     double end = omp_get_wtime();
     *solve_time = end - start;
+    st->iterations = iter;
+    st->stop_value = stop.value;
     
-    // Free working vectors
-    free(r);
-    free(r0);
-    free(p);
-    free(v);
-    free(s);
-    free(t);
+    // Free working vectors (unless they belong to the caller)
+    spmv_plan_free(&plan);
+    if (own_ws) solver_workspace_free(ws);
+    reduce_buffer_free(red);
     
-    if (iter >= max_iter) {
+    if (!converged && iter >= max_iter) {
         printf("BICGSTAB (parallel) did not converge within %d iterations\n", max_iter);
         return -1;
     }
     
     return iter;
+}
+
+// Original interface: default options with the given limits
+int bicgstab_parallel(FEMSystem *sys, int max_iter, double tol, int num_threads, double *solve_time) {
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.max_iter = max_iter;
+    opts.tol = tol;
+    opts.num_threads = num_threads;
+    return bicgstab_parallel_ex(sys, &opts, NULL, solve_time);
 }
\ No newline at end of file
@@ -0,0 +1,347 @@
+// bicgstab_pool.c
+// BICGSTAB on the persistent spin-barrier thread pool (thread_pool.h)
+// The whole solve is one pool task: each thread owns a fixed block of rows,
+// and every scalar (rho, alpha, omega, norms) is computed redundantly on all
+// threads from the same reduced values, so control flow needs no broadcast.
+// Per iteration there are five synchronization points: the reductions
+// (r0.v), (||s||), (t.s, t.t), (||r||, r0.r) and the barrier before A*p
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include "bicgstab.h"
+#include "blas1.h"
+
+// Shared state of one pooled solve
+typedef struct {
+    const SolverOptions *opts;
+    CSRMatrix *A;
+    Preconditioner *pc;
+    LinearOperator *op;
+    int n;
+    double *b, *x;
+    double *r, *r0, *p, *v, *s, *t, *p_hat, *s_hat;
+    int warm;               // x holds a nonzero initial guess
+    double anorm;           // ||A|| estimate (backward error only)
+
+    // Results (written by thread 0)
+    SolverStats *st;
+    int iterations;
+    int converged;
+    double stop_value;
+} PoolSolve;
+
+// Times a kernel on thread 0 only (the other threads just run it)
+#define POOL_TIME(tid, st, kernel, call) do {           \
+        if ((tid) == 0) STATS_TIME(st, kernel, call);   \
+        else { call; }                                  \
+    } while (0)
+
+// y = A*x on the pool: CSR rows per thread, or the operator on thread 0
+// Returns the block's r0 . y (and t.s / t.t through pair when s != NULL)
+static void pool_apply(PoolSolve *ps, int tid, int lo, int hi, const double *x, double *y,
+                       const double *s, double *sums) {
+    if (ps->op) {
+        if (tid == 0) ps->op->apply(ps->op, x, y, 0);
+        thread_pool_barrier(ps->opts->pool, tid);
+        double a = 0.0, c = 0.0;
+        for (int i = lo; i < hi; i++) {
+            a += (s ? s[i] : ps->r0[i]) * y[i];
+            c += y[i] * y[i];
+        }
+        sums[0] = a;
+        if (s) sums[1] = c;
+    } else if (s) {
+        matvec_csr_dot2(ps->A, x, y, s, lo, hi, &sums[0], &sums[1]);
+    } else {
+        sums[0] = matvec_csr_dot(ps->A, x, y, ps->r0, lo, hi);
+    }
+}
+
+// z = M^{-1} r on thread 0 (preconditioners are not split by rows);
+// ends with a barrier so z is complete everywhere
+static void pool_precond(PoolSolve *ps, int tid, const double *r, double *z) {
+    thread_pool_barrier(ps->opts->pool, tid);
+    if (tid == 0) STATS_TIME(ps->st, precond, precond_apply(ps->pc, r, z, 0));
+    thread_pool_barrier(ps->opts->pool, tid);
+}
+
+// r = b - A*x on this block; sums = {||r||^2, r0.r, ||x||^2} over all threads
+// init = 1 also sets the shadow residual r0
+static void pool_residual(PoolSolve *ps, int tid, int lo, int hi, int init, double *sums) {
+    ThreadPool *pool = ps->opts->pool;
+    CSRMatrix *A = ps->A;
+    double *r = ps->r, *r0 = ps->r0, *x = ps->x, *b = ps->b;
+
+    // x must be complete before any row reads it
+    thread_pool_barrier(pool, tid);
+    if (ps->op) {
+        if (tid == 0) ps->op->apply(ps->op, x, ps->t, 0);
+        thread_pool_barrier(pool, tid);
+    }
+
+    double rr = 0.0, r0r = 0.0, xx = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum;
+        if (ps->op) {
+            sum = b[i] - ps->t[i];
+        } else {
+            sum = b[i];
+            for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+                sum -= A->values[j] * x[A->col_idx[j]];
+            }
+        }
+        r[i] = sum;
+        if (init) r0[i] = ps->warm ? sum : 1.0;
+        rr += sum * sum;
+        r0r += r0[i] * sum;
+        xx += x[i] * x[i];
+    }
+    sums[0] = rr;
+    sums[1] = r0r;
+    sums[2] = xx;
+    thread_pool_allreduce(pool, tid, sums, 3);
+}
+
+// Replacement on the pool; returns ||b - Ax|| / ||b|| and the new r0.r
+static double pool_replace(PoolSolve *ps, int tid, int lo, int hi, double bnorm,
+                           double *rho, double *xnorm) {
+    double sums[3];
+    POOL_TIME(tid, ps->st, replace, pool_residual(ps, tid, lo, hi, 0, sums));
+    *rho = sums[1];
+    *xnorm = sqrt(sums[2]);
+    double res = sqrt(sums[0]) / bnorm;
+    if (tid == 0) ps->st->true_residual = res;
+    return res;
+}
+
+static void bicgstab_pool_task(void *ctx, int tid, int num_threads) {
+    PoolSolve *ps = (PoolSolve*)ctx;
+    const SolverOptions *opts = ps->opts;
+    ThreadPool *pool = opts->pool;
+    SolverStats *st = ps->st;
+    int n = ps->n;
+    double *b = ps->b, *x = ps->x;
+    double *r = ps->r, *p = ps->p, *v = ps->v, *s = ps->s, *t = ps->t;
+    double *p_hat = ps->p_hat, *s_hat = ps->s_hat;
+
+    int lo, hi;
+    thread_pool_range(n, tid, num_threads, &lo, &hi);
+
+    double sums[POOL_MAX_REDUCE];
+    sums[0] = blas1_dot(b + lo, b + lo, hi - lo);
+    POOL_TIME(tid, st, dot, thread_pool_allreduce(pool, tid, sums, 1));
+    double bnorm = sqrt(sums[0]);
+    if (bnorm == 0.0) bnorm = 1.0;
+
+    // Initial residual and shadow residual (r0 = r for a warm start)
+    POOL_TIME(tid, st, spmv, pool_residual(ps, tid, lo, hi, 1, sums));
+    double r_norm = sqrt(sums[0]);
+    double rho = sums[1];
+    double r_norm_ref = r_norm;
+
+    // Every thread keeps an identical copy of the stopping state
+    StopState stop;
+    stop_state_init(&stop, bnorm, r_norm, ps->anorm);
+    stop.xnorm = sqrt(sums[2]);
+    int check_true = opts->confirm_converged;
+    int energy_est = opts->stop_criterion == STOP_ENERGY_ESTIMATE;
+
+    double alpha = 1.0, omega = 1.0, rho_prev = 1.0;
+    int restart = 1;
+    int converged = 0;
+
+    int iter;
+    for (iter = 0; iter < opts->max_iter; iter++) {
+        if (fabs(rho) < 1e-30) {
+            if (tid == 0) printf("BICGSTAB (pool): rho breakdown at iteration %d\n", iter);
+            break;
+        }
+
+        // p = r (restart) or p = r + beta*(p - omega*v)
+        double beta = restart ? 0.0 : (rho / rho_prev) * (alpha / omega);
+        POOL_TIME(tid, st, axpy, {
+            if (restart) {
+                blas1_copy(r + lo, p + lo, hi - lo, 0);
+            } else {
+                blas1_direction(p + lo, r + lo, v + lo, beta, omega, hi - lo);
+            }
+        });
+        restart = 0;
+
+        // v = A*M^{-1}*p with r0.v fused into the row loop
+        if (ps->pc) {
+            pool_precond(ps, tid, p, p_hat);
+        } else {
+            thread_pool_barrier(pool, tid);
+        }
+        POOL_TIME(tid, st, spmv, pool_apply(ps, tid, lo, hi, p_hat, v, NULL, sums));
+        POOL_TIME(tid, st, dot, thread_pool_allreduce(pool, tid, sums, 1));
+        alpha = rho / sums[0];
+
+        // s = r - alpha*v with ||s||^2
+        POOL_TIME(tid, st, axpy,
+                  sums[0] = blas1_axpby_norm(1.0, r + lo, -alpha, v + lo, s + lo, hi - lo, 0));
+        POOL_TIME(tid, st, dot, thread_pool_allreduce(pool, tid, sums, 1));
+        double s_norm = sqrt(sums[0]);
+        if (tid == 0) st->recursive_residual = s_norm / bnorm;
+
+        if (stop_check(opts, &stop, s_norm, n)) {
+            blas1_axpy(alpha, p_hat + lo, x + lo, hi - lo);
+
+            // Confirm with the true residual; on drift continue from it
+            double res = s_norm / bnorm;
+            if (check_true) {
+                res = pool_replace(ps, tid, lo, hi, bnorm, &rho, &stop.xnorm);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (tid == 0 && opts->verbose) {
+                    printf("BICGSTAB (pool, %d threads) converged at iteration %d (residual: %.2e)\n",
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
+        }
+
+        // t = A*M^{-1}*s with t.s and t.t fused into the row loop
+        // (the ||s|| reduction already made s complete on all threads)
+        if (ps->pc) pool_precond(ps, tid, s, s_hat);
+        POOL_TIME(tid, st, spmv, pool_apply(ps, tid, lo, hi, s_hat, t, s, sums));
+        POOL_TIME(tid, st, dot, thread_pool_allreduce(pool, tid, sums, 2));
+        omega = sums[0] / sums[1];
+
+        // x += alpha*p_hat + omega*s_hat and r = s - omega*t in one pass,
+        // reducing ||r||^2, r0.r (next rho), ||x||^2 and the update energy
+        double rr = 0.0, r0r = 0.0, xx = 0.0, energy = 0.0;
+        POOL_TIME(tid, st, axpy, {
+            for (int i = lo; i < hi; i++) {
+                double dx = alpha * p_hat[i] + omega * s_hat[i];
+                x[i] += dx;
+                r[i] = s[i] - omega * t[i];
+                if (energy_est) energy += dx * (alpha * v[i] + omega * t[i]);
+                rr += r[i] * r[i];
+                r0r += ps->r0[i] * r[i];
+                xx += x[i] * x[i];
+            }
+        });
+        sums[0] = rr;
+        sums[1] = r0r;
+        sums[2] = xx;
+        sums[3] = energy;
+        POOL_TIME(tid, st, dot, thread_pool_allreduce(pool, tid, sums, 4));
+        rho_prev = rho;
+        rho = sums[1];
+        r_norm = sqrt(sums[0]);
+        stop.xnorm = sqrt(sums[2]);
+        if (energy_est) stop_record_energy(&stop, sums[3]);
+        if (tid == 0) st->recursive_residual = r_norm / bnorm;
+
+        if (stop_check(opts, &stop, r_norm, n)) {
+            double res = r_norm / bnorm;
+            if (check_true) {
+                res = pool_replace(ps, tid, lo, hi, bnorm, &rho, &stop.xnorm);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (tid == 0 && opts->verbose) {
+                    printf("BICGSTAB (pool, %d threads) converged at iteration %d (residual: %.2e)\n",
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
+        }
+
+        // Periodic or drift-triggered residual replacement
+        if ((opts->replace_interval > 0 && (iter+1) % opts->replace_interval == 0) ||
+            (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+            r_norm_ref = pool_replace(ps, tid, lo, hi, bnorm, &rho, &stop.xnorm) * bnorm;
+        }
+
+        if (fabs(omega) < 1e-30) {
+            if (tid == 0) printf("BICGSTAB (pool): omega breakdown at iteration %d\n", iter);
+            break;
+        }
+    }
+
+    if (tid == 0) {
+        ps->iterations = iter;
+        ps->converged = converged;
+        ps->stop_value = stop.value;
+    }
+}
+
+// Pooled BICGSTAB solver
+// Runs on opts->pool, or on a temporary pool of opts->num_threads threads
+// Returns: number of iterations, or -1 if failed
+int bicgstab_pool_ex(FEMSystem *sys, const SolverOptions *opts,
+                     SolverStats *stats, double *solve_time) {
+    int n = sys->n;
+    SolverStats local_stats;
+    SolverStats *st = stats ? stats : &local_stats;
+    solver_stats_reset(st);
+
+    // A temporary pool pays the thread start-up; pass opts->pool to reuse one
+    SolverOptions pool_opts = *opts;
+    ThreadPool *own_pool = NULL;
+    if (!pool_opts.pool) {
+        own_pool = thread_pool_create(opts->num_threads > 0 ? opts->num_threads : 1, 0);
+        pool_opts.pool = own_pool;
+    }
+
+    SolverWorkspace *ws = opts->workspace;
+    int own_ws = (ws == NULL || ws->n < n);
+    if (own_ws) ws = solver_workspace_create(n);
+    if (!ws) {
+        thread_pool_free(own_pool);
+        *solve_time = 0.0;
+        return -1;
+    }
+
+    PoolSolve ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.opts = &pool_opts;
+    ps.A = &sys->A;
+    ps.pc = opts->precond;
+    ps.op = opts->op;
+    ps.n = n;
+    ps.b = sys->b;
+    ps.x = sys->x;
+    ps.r = ws->r;
+    ps.r0 = ws->r0;
+    ps.p = ws->p;
+    ps.v = ws->v;
+    ps.s = ws->s;
+    ps.t = ws->t;
+    ps.p_hat = ps.pc ? ws->p_hat : ws->p;
+    ps.s_hat = ps.pc ? ws->s_hat : ws->s;
+    ps.st = st;
+
+    double start = wall_time();
+    ps.warm = initial_guess_nonzero(sys->x, n);
+    if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+        ps.anorm = opts->op ? operator_norm_estimate(opts->op, ws->v, ws->t) : csr_norm_inf(&sys->A);
+    }
+    thread_pool_run(pool_opts.pool, bicgstab_pool_task, &ps);
+    *solve_time = wall_time() - start;
+    st->iterations = ps.iterations;
+    st->stop_value = ps.stop_value;
+
+    if (own_ws) solver_workspace_free(ws);
+    thread_pool_free(own_pool);
+
+    if (!ps.converged && ps.iterations >= opts->max_iter) {
+        printf("BICGSTAB (pool) did not converge within %d iterations\n", opts->max_iter);
+        return -1;
+    }
+    return ps.iterations;
+}
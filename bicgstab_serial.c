@@ -7,137 +7,337 @@
 #include <math.h>
 #include <string.h>
 #include <time.h>
-#include "fem_matrix.h"
+#include "bicgstab.h"
+#include "blas1.h"
 
-// Vector operations
-static double dot_product(double *a, double *b, int n) {
-    double sum = 0.0;
-    for (int i = 0; i < n; i++) {
-        sum += a[i] * b[i];
+// Vector kernels come from blas1.c; these are the solver-specific ones
+static double vector_norm(const double *x, int n) {
+    return sqrt(blas1_dot(x, x, n));
+}
+
+// y = A*x with the solver's operator (opts->op if given, else the CSR matrix),
+// returning w.y from the same pass (operators without apply_dots reduce after)
+static double apply_matrix_dot(const SolverOptions *opts, CSRMatrix *A, const SpmvPlan *plan,
+                               double *x, double *y, const double *w) {
+    LinearOperator *op = opts->op;
+    if (!op) return spmv_csr_dot(plan, A, x, y, w, 0, A->n);
+    if (op->apply_dots) {
+        double dots[2];
+        op->apply_dots(op, x, y, w, dots, 0);
+        return dots[0];
     }
-    return sum;
+    op->apply(op, x, y, 0);
+    return blas1_dot(w, y, op->n);
 }
 
-static void vector_copy(double *src, double *dst, int n) {
-    for (int i = 0; i < n; i++) {
-        dst[i] = src[i];
+// y = A*x with w.y and y.y from the same pass
+static void apply_matrix_dot2(const SolverOptions *opts, CSRMatrix *A, const SpmvPlan *plan,
+                              double *x, double *y, const double *w, double *wy, double *yy) {
+    LinearOperator *op = opts->op;
+    if (!op) {
+        spmv_csr_dot2(plan, A, x, y, w, 0, A->n, wy, yy);
+        return;
+    }
+    double dots[2];
+    if (op->apply_dots) {
+        op->apply_dots(op, x, y, w, dots, 0);
+    } else {
+        op->apply(op, x, y, 0);
+        blas1_dot2(w, y, y, y, op->n, &dots[0], &dots[1]);
     }
+    *wy = dots[0];
+    *yy = dots[1];
 }
 
-static void vector_axpy(double a, double *x, double *y, int n) {
-    // y = a*x + y
+// r = b - A*x, returns ||r||^2
+// CSR uses the fused kernel; other operators need tmp for A*x
+static double compute_residual(const SolverOptions *opts, CSRMatrix *A, double *x,
+                               double *b, double *r, double *tmp) {
+    if (!opts->op) {
+        return residual_csr(A, x, b, r);
+    }
+    int n = opts->op->n;
+    opts->op->apply(opts->op, x, tmp, 0);
+    double norm2 = 0.0;
     for (int i = 0; i < n; i++) {
-        y[i] += a * x[i];
+        r[i] = b[i] - tmp[i];
+        norm2 += r[i] * r[i];
     }
+    return norm2;
 }
 
-static void vector_axpby(double a, double *x, double b, double *y, double *z, int n) {
-    // z = a*x + b*y
+// x = x + alpha*p_hat + omega*s_hat in one pass, returning the update's
+// A-norm energy dx^T (A dx) with A dx = alpha*v + omega*t = r_old - r_new
+static double update_solution_energy(double *x, double *p_hat, double *s_hat,
+                                     double *v, double *t, double alpha, double omega, int n) {
+    double energy = 0.0;
     for (int i = 0; i < n; i++) {
-        z[i] = a * x[i] + b * y[i];
+        double dx = alpha * p_hat[i] + omega * s_hat[i];
+        x[i] += dx;
+        energy += dx * (alpha * v[i] + omega * t[i]);
     }
+    return energy;
 }
 
-static double vector_norm(double *x, int n) {
-    return sqrt(dot_product(x, x, n));
+// Residual replacement: r = b - A*x (fused SpMV + AXPY)
+// Returns the true relative residual ||b - Ax|| / ||b||
+static double replace_residual(const SolverOptions *opts, CSRMatrix *A, double *x,
+                               double *b, double *r, double *tmp,
+                               double bnorm, SolverStats *st) {
+    double norm2;
+    STATS_TIME(st, replace, norm2 = compute_residual(opts, A, x, b, r, tmp));
+    st->true_residual = sqrt(norm2) / bnorm;
+    return st->true_residual;
 }
 
 // BICGSTAB solver
-// Solves Ax = b using BICGSTAB method
+// Solves Ax = b using BICGSTAB method, starting from the guess in sys->x
 // Returns: number of iterations, or -1 if failed
-int bicgstab_serial(FEMSystem *sys, int max_iter, double tol, double *solve_time) {
+int bicgstab_serial_ex(FEMSystem *sys, const SolverOptions *opts,
+                       SolverStats *stats, double *solve_time) {
     int n = sys->n;
     CSRMatrix *A = &sys->A;
     double *b = sys->b;
     double *x = sys->x;
+    int max_iter = opts->max_iter;
+    
+    SolverStats local_stats;
+    SolverStats *st = stats ? stats : &local_stats;
+    solver_stats_reset(st);
+    
+    // Working vectors: caller's workspace if given, otherwise allocate
+    SolverWorkspace *ws = opts->workspace;
+    int own_ws = (ws == NULL || ws->n < n);
+    if (own_ws) ws = solver_workspace_create(n);
+    if (!ws) {
+        *solve_time = 0.0;
+        return -1;
+    }
+    double *r = ws->r;      // residual
+    double *r0 = ws->r0;    // shadow residual
+    double *p = ws->p;      // search direction
+    double *v = ws->v;      // A*p
+    double *s = ws->s;      // intermediate residual
+    double *t = ws->t;      // A*s
     
-    // Allocate working vectors
-    double *r = (double*)malloc(n * sizeof(double));      // residual
-    double *r0 = (double*)malloc(n * sizeof(double));     // shadow residual
-    double *p = (double*)malloc(n * sizeof(double));      // search direction
-    double *v = (double*)malloc(n * sizeof(double));      // A*p
-    double *s = (double*)malloc(n * sizeof(double));      // intermediate residual
-    double *t = (double*)malloc(n * sizeof(double));      // A*s
+    // Right preconditioning: solve A M^{-1} y = b, x = M^{-1} y
+    // Without a preconditioner p_hat / s_hat are just p / s
+    Preconditioner *pc = opts->precond;
+    double *p_hat = pc ? ws->p_hat : p;     // M^{-1} p
+    double *s_hat = pc ? ws->s_hat : s;     // M^{-1} s
+    
+    // Vectors beyond the cache are written with streaming stores
+    int stream = blas1_stream(n);
+    
+    // SpMV kernel for this matrix (SPMV_AUTO measures its column locality),
+    // on narrowed values if asked for and accurate enough for tol
+    SpmvPlan plan;
+    spmv_plan_init(&plan, A, solver_spmv_kernel(opts), opts->prefetch_distance);
+    spmv_plan_set_values(&plan, A, opts->op ? VALUES_FP64 : opts->value_precision, opts->tol);
     
     // Start timing
     clock_t start = clock();
     
-    // Initial guess: x = 0 (already initialized)
-    // Initial residual: r = b - A*x = b
-    vector_copy(b, r, n);
+    double bnorm;
+    STATS_TIME(st, dot, bnorm = vector_norm(b, n));
+    if (bnorm == 0.0) bnorm = 1.0;
+    
+    // Initial residual: r = b - A*x (x may hold a nonzero initial guess)
+    double r_norm;
+    STATS_TIME(st, spmv, r_norm = sqrt(compute_residual(opts, A, x, b, r, t)));
+    double r_norm_ref = r_norm;     // ||r|| at the last replacement
+    
+    // Stopping test state (||A|| only needed for the backward error)
+    StopState stop;
+    double anorm = 0.0;
+    if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+        anorm = opts->op ? operator_norm_estimate(opts->op, v, t) : csr_norm_inf(A);
+    }
+    stop_state_init(&stop, bnorm, r_norm, anorm);
+    int check_true = opts->confirm_converged;
     
     // CRITICAL FIX: Use constant r0 instead of r0 = r
     // This prevents breakdown when boundary conditions cause
     // the residual's non-zero pattern to shift
+    // A warm start's residual already has support everywhere, and there
+    // r0 = r is the better choice (the constant vector is nearly orthogonal)
+    int warm = initial_guess_nonzero(x, n);
     for (int i = 0; i < n; i++) {
-        r0[i] = 1.0;  // Constant vector with support everywhere
+        r0[i] = warm ? r[i] : 1.0;
     }
     
-    vector_copy(r, p, n);
-    
     double rho = 1.0, alpha = 1.0, omega = 1.0;
     double rho_prev, beta;
+    int restart = 1;    // 1 = take p = r (first iteration or after a replacement)
+    int converged = 0;
     
-    double bnorm = vector_norm(b, n);
-    if (bnorm == 0.0) bnorm = 1.0;
+    // Without fused norms and check_interval > 1, ||r|| comes with rho: the
+    // r of one iteration is tested at the start of the next, so the stop
+    // test and the drift replacement still see every iterate (x is not
+    // touched in between, so nothing needs rolling back). The separate
+    // ||s|| pass for the half-step exit is made every check_interval
+    // iterations only; skipping it costs no iterations since ||r|| <= ||s||.
+    int lagged = !opts->fused_norms && opts->check_interval > 1;
+    int pending = 0;    // 1 = r updated but not yet tested (lagged only)
     
     int iter;
-    for (iter = 0; iter < max_iter; iter++) {
+    for (iter = 0; iter < max_iter + lagged; iter++) {
         rho_prev = rho;
-        rho = dot_product(r0, r, n);
+        if (!lagged) {
+            STATS_TIME(st, dot, rho = blas1_dot(r0, r, n));
+        } else {
+            double rr;
+            STATS_TIME(st, dot, blas1_dot2(r0, r, r, r, n, &rho, &rr));
+            if (pending) {
+                // Test and drift replacement of the previous iteration's r
+                pending = 0;
+                r_norm = sqrt(rr);
+                st->recursive_residual = r_norm / bnorm;
+                if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+                    STATS_TIME(st, dot, stop.xnorm = vector_norm(x, n));
+                }
+                int replaced = 0;
+                if (stop_check(opts, &stop, r_norm, n)) {
+                    double res = r_norm / bnorm;
+                    if (check_true) {
+                        res = replace_residual(opts, A, x, b, r, t, bnorm, st);
+                    }
+                    if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                        if (opts->verbose) {
+                            printf("BICGSTAB converged at iteration %d (residual: %.2e)\n", 
+                                   iter, res);
+                        }
+                        converged = 1;
+                        break;
+                    }
+                    r_norm_ref = res * bnorm;
+                    restart = replaced = 1;
+                } else if ((opts->replace_interval > 0 && iter % opts->replace_interval == 0) ||
+                           (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+                    r_norm_ref = replace_residual(opts, A, x, b, r, t, bnorm, st) * bnorm;
+                    replaced = 1;
+                }
+                if (replaced) STATS_TIME(st, dot, rho = blas1_dot(r0, r, n));
+            }
+            if (iter == max_iter) break;
+        }
         
         if (fabs(rho) < 1e-30) {
             printf("BICGSTAB: rho breakdown at iteration %d\n", iter);
             break;
         }
         
-        if (iter == 0) {
-            vector_copy(r, p, n);
+        if (restart) {
+            STATS_TIME(st, axpy, blas1_copy(r, p, n, stream));
+            restart = 0;
         } else {
             beta = (rho / rho_prev) * (alpha / omega);
-            // p = r + beta*(p - omega*v)
-            for (int i = 0; i < n; i++) {
-                p[i] = r[i] + beta * (p[i] - omega * v[i]);
-            }
+            STATS_TIME(st, axpy, blas1_direction(p, r, v, beta, omega, n));
         }
         
-        // v = A*p
-        matvec_csr(A, p, v);
+        // v = A*M^{-1}*p with r0.v fused into the SpMV
+        if (pc) STATS_TIME(st, precond, precond_apply(pc, p, p_hat, 0));
+        double r0v;
+        STATS_TIME(st, spmv, r0v = apply_matrix_dot(opts, A, &plan, p_hat, v, r0));
+        alpha = rho / r0v;
         
-        alpha = rho / dot_product(r0, v, n);
+        // The half-step test needs a separate ||s|| pass unless fused, so
+        // with lagged tests it is only made every check_interval iterations
+        int check_now = !lagged || (iter + 1) % opts->check_interval == 0;
         
-        // s = r - alpha*v
-        vector_axpby(1.0, r, -alpha, v, s, n);
+        // s = r - alpha*v (with ||s|| folded into the update when fused)
+        double s_norm = 0.0;
+        if (opts->fused_norms) {
+            STATS_TIME(st, axpy, s_norm = sqrt(blas1_axpby_norm(1.0, r, -alpha, v, s, n, stream)));
+        } else {
+            STATS_TIME(st, axpy, blas1_axpby(1.0, r, -alpha, v, s, n, stream));
+            if (check_now) STATS_TIME(st, dot, s_norm = vector_norm(s, n));
+        }
         
         // Check convergence
-        double s_norm = vector_norm(s, n);
-        if (s_norm / bnorm < tol) {
-            // x = x + alpha*p
-            vector_axpy(alpha, p, x, n);
-            printf("BICGSTAB converged at iteration %d (residual: %.2e)\n", 
-                   iter+1, s_norm/bnorm);
-            break;
+        if (check_now) st->recursive_residual = s_norm / bnorm;
+        if (check_now && opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = vector_norm(x, n));
+        }
+        if (check_now && stop_check(opts, &stop, s_norm, n)) {
+            // x = x + alpha*p_hat
+            STATS_TIME(st, axpy, blas1_axpy(alpha, p_hat, x, n));
+            
+            // Confirm with the true residual; on drift continue from it
+            double res = s_norm / bnorm;
+            if (check_true) {
+                res = replace_residual(opts, A, x, b, r, t, bnorm, st);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("BICGSTAB converged at iteration %d (residual: %.2e)\n", 
+                           iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
         }
         
-        // t = A*s
-        matvec_csr(A, s, t);
-        
-        omega = dot_product(t, s, n) / dot_product(t, t, n);
+        // t = A*M^{-1}*s with t.s and t.t fused into the SpMV
+        if (pc) STATS_TIME(st, precond, precond_apply(pc, s, s_hat, 0));
+        double ts, tt;
+        STATS_TIME(st, spmv, apply_matrix_dot2(opts, A, &plan, s_hat, t, s, &ts, &tt));
+        omega = ts / tt;
         
-        // x = x + alpha*p + omega*s
-        vector_axpy(alpha, p, x, n);
-        vector_axpy(omega, s, x, n);
+        // x = x + alpha*p_hat + omega*s_hat
+        if (opts->stop_criterion == STOP_ENERGY_ESTIMATE) {
+            double energy;
+            STATS_TIME(st, axpy, energy = update_solution_energy(x, p_hat, s_hat, v, t,
+                                                                   alpha, omega, n));
+            stop_record_energy(&stop, energy);
+        } else {
+            STATS_TIME(st, axpy, blas1_axpy(alpha, p_hat, x, n));
+            STATS_TIME(st, axpy, blas1_axpy(omega, s_hat, x, n));
+        }
         
         // r = s - omega*t
-        vector_axpby(1.0, s, -omega, t, r, n);
+        if (opts->fused_norms) {
+            STATS_TIME(st, axpy, r_norm = sqrt(blas1_axpby_norm(1.0, s, -omega, t, r, n, stream)));
+        } else {
+            STATS_TIME(st, axpy, blas1_axpby(1.0, s, -omega, t, r, n, stream));
+            if (!lagged) STATS_TIME(st, dot, r_norm = vector_norm(r, n));
+        }
         
         // Check convergence
-        double r_norm = vector_norm(r, n);
-        if (r_norm / bnorm < tol) {
-            printf("BICGSTAB converged at iteration %d (residual: %.2e)\n", 
-                   iter+1, r_norm/bnorm);
-            iter++;
-            break;
+        if (!lagged) st->recursive_residual = r_norm / bnorm;
+        if (!lagged && opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = vector_norm(x, n));
+        }
+        if (!lagged && stop_check(opts, &stop, r_norm, n)) {
+            double res = r_norm / bnorm;
+            if (check_true) {
+                res = replace_residual(opts, A, x, b, r, t, bnorm, st);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("BICGSTAB converged at iteration %d (residual: %.2e)\n", 
+                           iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
+        }
+        
+        // Periodic or drift-triggered residual replacement (lagged: at the
+        // test of this r at the start of the next iteration)
+        if (lagged) {
+            pending = 1;
+        } else if ((opts->replace_interval > 0 && (iter+1) % opts->replace_interval == 0) ||
+                   (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+            r_norm_ref = replace_residual(opts, A, x, b, r, t, bnorm, st) * bnorm;
         }
         
         if (fabs(omega) < 1e-30) {
@@ -149,19 +349,26 @@ int bicgstab_serial(FEMSystem *sys, int max_iter, double tol, double *solve_time
     // End timing
     clock_t end = clock();
     *solve_time = ((double)(end - start)) / CLOCKS_PER_SEC;
+    st->iterations = iter;
+    st->stop_value = stop.value;
     
-    // Free working vectors
-    free(r);
-    free(r0);
-    free(p);
-    free(v);
-    free(s);
-    free(t);
+    // Free working vectors (unless they belong to the caller)
+    spmv_plan_free(&plan);
+    if (own_ws) solver_workspace_free(ws);
     
-    if (iter >= max_iter) {
+    if (!converged && iter >= max_iter) {
         printf("BICGSTAB did not converge within %d iterations\n", max_iter);
         return -1;
     }
     
     return iter;
+}
+
+// Original interface: default options with the given limits
+int bicgstab_serial(FEMSystem *sys, int max_iter, double tol, double *solve_time) {
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.max_iter = max_iter;
+    opts.tol = tol;
+    return bicgstab_serial_ex(sys, &opts, NULL, solve_time);
 }
\ No newline at end of file
@@ -0,0 +1,478 @@
+// bicgstab_tasks.c
+// Task-graph BICGSTAB: vectors are split into fixed chunks and every kernel
+// is a set of OpenMP tasks with depend clauses on per-chunk tokens, so the
+// runtime starts a kernel on a chunk as soon as the chunks it reads are
+// ready instead of waiting at a global barrier. The SpMV on chunk k only
+// depends on the chunks its rows reference, and the x updates (which never
+// feed back into the recurrence) run in the background while the next
+// kernels proceed. The generating thread only waits, with taskwait depend,
+// for the partial sums it needs to compute the next scalar
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <omp.h>
+#include "bicgstab.h"
+#include "blas1.h"
+
+// Chunking: at most TASK_MAX_CHUNKS chunks of at least TASK_MIN_CHUNK entries
+// (independent of the thread count, so the chunk-ordered partial sums give
+// the same result for any team size)
+#define TASK_MIN_CHUNK 1024
+#define TASK_MAX_CHUNKS 64
+
+// Chunk layout, dependence tokens and partial sums of one solve
+// Tokens are never read or written; only their addresses are used in depend
+typedef struct {
+    int n;
+    int nchunks;
+    int chunk;
+    int *first, *last;      // Input chunks read by the SpMV rows of chunk k
+    char *tok_r, *tok_r0, *tok_p, *tok_phat, *tok_v, *tok_s, *tok_shat, *tok_t, *tok_x;
+    double *part_a, *part_b, *part_c, *part_d;  // Per-chunk partial sums
+} TaskGraph;
+
+static TaskGraph* task_graph_create(int n, CSRMatrix *A, int use_csr, int separate_hat) {
+    TaskGraph *g = (TaskGraph*)malloc(sizeof(TaskGraph));
+    g->n = n;
+    g->chunk = (n + TASK_MAX_CHUNKS - 1) / TASK_MAX_CHUNKS;
+    if (g->chunk < TASK_MIN_CHUNK) g->chunk = TASK_MIN_CHUNK;
+    g->nchunks = (n + g->chunk - 1) / g->chunk;
+    if (g->nchunks < 1) g->nchunks = 1;
+    int nc = g->nchunks;
+
+    // Column range of each row chunk (the whole vector for matrix-free operators)
+    g->first = (int*)malloc(nc * sizeof(int));
+    g->last = (int*)malloc(nc * sizeof(int));
+    for (int k = 0; k < nc; k++) {
+        g->first[k] = 0;
+        g->last[k] = nc - 1;
+        if (!use_csr) continue;
+        int lo = k * g->chunk, hi = lo + g->chunk < n ? lo + g->chunk : n;
+        int cmin = n, cmax = 0;
+        for (int j = A->row_ptr[lo]; j < A->row_ptr[hi]; j++) {
+            if (A->col_idx[j] < cmin) cmin = A->col_idx[j];
+            if (A->col_idx[j] > cmax) cmax = A->col_idx[j];
+        }
+        if (cmin <= cmax) {
+            g->first[k] = cmin / g->chunk;
+            g->last[k] = cmax / g->chunk;
+        }
+    }
+
+    // Without a preconditioner p_hat / s_hat alias p / s and share their tokens
+    g->tok_r = (char*)calloc(9 * nc, 1);
+    g->tok_r0 = g->tok_r + nc;
+    g->tok_p = g->tok_r + 2 * nc;
+    g->tok_phat = separate_hat ? g->tok_r + 3 * nc : g->tok_p;
+    g->tok_v = g->tok_r + 4 * nc;
+    g->tok_s = g->tok_r + 5 * nc;
+    g->tok_shat = separate_hat ? g->tok_r + 6 * nc : g->tok_s;
+    g->tok_t = g->tok_r + 7 * nc;
+    g->tok_x = g->tok_r + 8 * nc;
+
+    g->part_a = (double*)calloc(4 * nc, sizeof(double));
+    g->part_b = g->part_a + nc;
+    g->part_c = g->part_a + 2 * nc;
+    g->part_d = g->part_a + 3 * nc;
+    return g;
+}
+
+static void task_graph_free(TaskGraph *g) {
+    free(g->first);
+    free(g->last);
+    free(g->tok_r);
+    free(g->part_a);
+    free(g);
+}
+
+static void chunk_range(const TaskGraph *g, int k, int *lo, int *hi) {
+    *lo = k * g->chunk;
+    *hi = *lo + g->chunk < g->n ? *lo + g->chunk : g->n;
+}
+
+// Partial sums combined in chunk order
+static double sum_partials(const double *part, int nchunks) {
+    double sum = 0.0;
+    for (int k = 0; k < nchunks; k++) sum += part[k];
+    return sum;
+}
+
+// Waits for the tasks producing every chunk of the vector behind tok
+static void wait_chunks(TaskGraph *g, char *tok) {
+    (void)tok;
+    #pragma omp taskwait depend(iterator(c = 0 : g->nchunks), in: tok[c])
+}
+
+// part_a = ||b||^2 per chunk (b is never written, so no dependences)
+static void tasks_norm2(TaskGraph *g, const double *b) {
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            g->part_a[k] = blas1_dot(b + lo, b + lo, hi - lo);
+        }
+    }
+}
+
+// r = b - A*x per chunk with ||r||^2, r0.r and ||x||^2 in part_a/b/c
+// init = 1 also sets r0 (= r for a warm start, else 1)
+// Matrix-free operators apply once into tmp first
+static void tasks_residual(TaskGraph *g, const SolverOptions *opts, CSRMatrix *A,
+                           const double *x, const double *b, double *r, double *r0,
+                           double *tmp, int init, int warm) {
+    LinearOperator *op = opts->op;
+    if (op) {
+        #pragma omp task depend(iterator(c = 0 : g->nchunks), in: g->tok_x[c]) \
+                         depend(iterator(c = 0 : g->nchunks), out: g->tok_t[c])
+        op->apply(op, x, tmp, 0);
+    }
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(iterator(c = g->first[k] : g->last[k] + 1), in: g->tok_x[c]) \
+                         depend(in: g->tok_t[k]) depend(out: g->tok_r[k], g->tok_r0[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            double rr = 0.0, r0r = 0.0, xx = 0.0;
+            for (int i = lo; i < hi; i++) {
+                double sum;
+                if (op) {
+                    sum = b[i] - tmp[i];
+                } else {
+                    sum = b[i];
+                    for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+                        sum -= A->values[j] * x[A->col_idx[j]];
+                    }
+                }
+                r[i] = sum;
+                if (init) r0[i] = warm ? sum : 1.0;
+                rr += sum * sum;
+                r0r += r0[i] * sum;
+                xx += x[i] * x[i];
+            }
+            g->part_a[k] = rr;
+            g->part_b[k] = r0r;
+            g->part_c[k] = xx;
+        }
+    }
+}
+
+// p = r (restart) or p = r + beta*(p - omega*v) per chunk
+static void tasks_update_direction(TaskGraph *g, double *p, const double *r, const double *v,
+                                   double beta, double omega, int restart) {
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(in: g->tok_r[k], g->tok_v[k]) depend(inout: g->tok_p[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            if (restart) {
+                blas1_copy(r + lo, p + lo, hi - lo, 0);
+            } else {
+                blas1_direction(p + lo, r + lo, v + lo, beta, omega, hi - lo);
+            }
+        }
+    }
+}
+
+// z = M^{-1} r as one task (the preconditioners are not split by chunks)
+static void tasks_precond(TaskGraph *g, Preconditioner *pc, const double *r, double *z,
+                          char *tok_in, char *tok_out) {
+    (void)tok_in;
+    (void)tok_out;
+    #pragma omp task depend(iterator(c = 0 : g->nchunks), in: tok_in[c]) \
+                     depend(iterator(c = 0 : g->nchunks), out: tok_out[c])
+    pc->apply(pc, r, z, 0);
+}
+
+// y = A*x per chunk, with partner.y in part_a and (pair = 1) y.y in part_b
+// Chunk k waits only for the input chunks its rows reference
+static void tasks_spmv(TaskGraph *g, const SolverOptions *opts, CSRMatrix *A,
+                       const double *x, double *y, const double *partner,
+                       char *tok_in, char *tok_out, char *tok_partner, int pair) {
+    (void)tok_in;
+    (void)tok_out;
+    (void)tok_partner;
+    LinearOperator *op = opts->op;
+    if (op) {
+        #pragma omp task depend(iterator(c = 0 : g->nchunks), in: tok_in[c]) \
+                         depend(iterator(c = 0 : g->nchunks), out: tok_out[c])
+        op->apply(op, x, y, 0);
+    }
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(iterator(c = g->first[k] : g->last[k] + 1), in: tok_in[c]) \
+                         depend(in: tok_partner[k]) depend(inout: tok_out[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            double dot, yy;
+            if (op) {
+                blas1_dot2(partner + lo, y + lo, y + lo, y + lo, hi - lo, &dot, &yy);
+            } else if (pair) {
+                matvec_csr_dot2(A, x, y, partner, lo, hi, &dot, &yy);
+            } else {
+                dot = matvec_csr_dot(A, x, y, partner, lo, hi);
+            }
+            g->part_a[k] = dot;
+            if (pair) g->part_b[k] = yy;
+        }
+    }
+}
+
+// s = r - alpha*v with ||s||^2 in part_a, and x += alpha*p_hat in the
+// background (nothing waits on x until convergence or a replacement)
+static void tasks_update_s(TaskGraph *g, double *s, const double *r, const double *v,
+                           double *x, const double *p_hat, double alpha) {
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(in: g->tok_r[k], g->tok_v[k]) depend(out: g->tok_s[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            g->part_a[k] = blas1_axpby_norm(1.0, r + lo, -alpha, v + lo, s + lo, hi - lo, 0);
+        }
+    }
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(in: g->tok_phat[k]) depend(inout: g->tok_x[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            blas1_axpy(alpha, p_hat + lo, x + lo, hi - lo);
+        }
+    }
+}
+
+// r = s - omega*t with ||r||^2, r0.r in part_a/b, and x += omega*s_hat with
+// ||x||^2 and the update energy (energy = 1) in part_c/d
+static void tasks_update_r(TaskGraph *g, double *r, const double *r0, const double *s,
+                           const double *t, double *x, const double *s_hat,
+                           const double *p_hat, const double *v,
+                           double alpha, double omega, int energy) {
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(in: g->tok_s[k], g->tok_t[k]) depend(out: g->tok_r[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            double rr = 0.0, r0r = 0.0;
+            for (int i = lo; i < hi; i++) {
+                r[i] = s[i] - omega * t[i];
+                rr += r[i] * r[i];
+                r0r += r0[i] * r[i];
+            }
+            g->part_a[k] = rr;
+            g->part_b[k] = r0r;
+        }
+    }
+    for (int k = 0; k < g->nchunks; k++) {
+        #pragma omp task depend(in: g->tok_shat[k], g->tok_phat[k], g->tok_v[k], g->tok_t[k]) \
+                         depend(inout: g->tok_x[k])
+        {
+            int lo, hi;
+            chunk_range(g, k, &lo, &hi);
+            double xx = 0.0, en = 0.0;
+            for (int i = lo; i < hi; i++) {
+                x[i] += omega * s_hat[i];
+                xx += x[i] * x[i];
+                if (energy) {
+                    en += (alpha * p_hat[i] + omega * s_hat[i]) * (alpha * v[i] + omega * t[i]);
+                }
+            }
+            g->part_c[k] = xx;
+            g->part_d[k] = en;
+        }
+    }
+}
+
+// Task-graph BICGSTAB solver
+// Runs in one parallel region; one thread generates the task graph
+// Kernel counts are recorded, but kernel times are not separable when the
+// kernels overlap, so only the total time is meaningful
+// Returns: number of iterations, or -1 if failed
+int bicgstab_tasks_ex(FEMSystem *sys, const SolverOptions *opts,
+                      SolverStats *stats, double *solve_time) {
+    int n = sys->n;
+    CSRMatrix *A = &sys->A;
+    double *b = sys->b;
+    double *x = sys->x;
+
+    SolverStats local_stats;
+    SolverStats *st = stats ? stats : &local_stats;
+    solver_stats_reset(st);
+
+    int num_threads = opts->num_threads > 0 ? opts->num_threads : omp_get_max_threads();
+    omp_set_num_threads(num_threads);
+
+    SolverWorkspace *ws = opts->workspace;
+    int own_ws = (ws == NULL || ws->n < n);
+    if (own_ws) ws = solver_workspace_create(n);
+    if (!ws) {
+        *solve_time = 0.0;
+        return -1;
+    }
+    double *r = ws->r, *r0 = ws->r0, *p = ws->p, *v = ws->v, *s = ws->s, *t = ws->t;
+    Preconditioner *pc = opts->precond;
+    double *p_hat = pc ? ws->p_hat : p;
+    double *s_hat = pc ? ws->s_hat : s;
+
+    TaskGraph *g = task_graph_create(n, A, opts->op == NULL, pc != NULL);
+    int nc = g->nchunks;
+    int warm = initial_guess_nonzero(x, n);
+    int check_true = opts->confirm_converged;
+    int energy_est = opts->stop_criterion == STOP_ENERGY_ESTIMATE;
+    double anorm = 0.0;
+    if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+        anorm = opts->op ? operator_norm_estimate(opts->op, v, t) : csr_norm_inf(A);
+    }
+
+    int iter = 0, converged = 0;
+    double stop_value = 0.0;
+    double start = omp_get_wtime();
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        tasks_norm2(g, b);
+        #pragma omp taskwait
+        double bnorm = sqrt(sum_partials(g->part_a, nc));
+        if (bnorm == 0.0) bnorm = 1.0;
+        st->dot_count++;
+
+        tasks_residual(g, opts, A, x, b, r, r0, t, 1, warm);
+        wait_chunks(g, g->tok_r);
+        st->spmv_count++;
+        double r_norm = sqrt(sum_partials(g->part_a, nc));
+        double rho = sum_partials(g->part_b, nc);
+        double r_norm_ref = r_norm;
+
+        StopState stop;
+        stop_state_init(&stop, bnorm, r_norm, anorm);
+        stop.xnorm = sqrt(sum_partials(g->part_c, nc));
+
+        double alpha = 1.0, omega = 1.0, rho_prev = 1.0;
+        int restart = 1;
+
+        for (iter = 0; iter < opts->max_iter; iter++) {
+            if (fabs(rho) < 1e-30) {
+                printf("BICGSTAB (tasks): rho breakdown at iteration %d\n", iter);
+                break;
+            }
+
+            double beta = restart ? 0.0 : (rho / rho_prev) * (alpha / omega);
+            tasks_update_direction(g, p, r, v, beta, omega, restart);
+            st->axpy_count++;
+            restart = 0;
+
+            // v = A*M^{-1}*p, r0.v
+            if (pc) {
+                tasks_precond(g, pc, p, p_hat, g->tok_p, g->tok_phat);
+                st->precond_count++;
+            }
+            tasks_spmv(g, opts, A, p_hat, v, r0, g->tok_phat, g->tok_v, g->tok_r0, 0);
+            st->spmv_count++;
+            wait_chunks(g, g->tok_v);
+            st->dot_count++;
+            alpha = rho / sum_partials(g->part_a, nc);
+
+            // s = r - alpha*v; x += alpha*p_hat continues in the background
+            tasks_update_s(g, s, r, v, x, p_hat, alpha);
+            st->axpy_count += 2;
+            wait_chunks(g, g->tok_s);
+            st->dot_count++;
+            double s_norm = sqrt(sum_partials(g->part_a, nc));
+            st->recursive_residual = s_norm / bnorm;
+
+            int done = stop_check(opts, &stop, s_norm, n);
+            if (!done) {
+                // t = A*M^{-1}*s, t.s and t.t
+                if (pc) {
+                    tasks_precond(g, pc, s, s_hat, g->tok_s, g->tok_shat);
+                    st->precond_count++;
+                }
+                tasks_spmv(g, opts, A, s_hat, t, s, g->tok_shat, g->tok_t, g->tok_s, 1);
+                st->spmv_count++;
+                wait_chunks(g, g->tok_t);
+                st->dot_count++;
+                omega = sum_partials(g->part_a, nc) / sum_partials(g->part_b, nc);
+
+                // r = s - omega*t; x += omega*s_hat in the background
+                tasks_update_r(g, r, r0, s, t, x, s_hat, p_hat, v, alpha, omega, energy_est);
+                st->axpy_count += 2;
+                wait_chunks(g, g->tok_r);
+                st->dot_count++;
+                rho_prev = rho;
+                rho = sum_partials(g->part_b, nc);
+                r_norm = sqrt(sum_partials(g->part_a, nc));
+                st->recursive_residual = r_norm / bnorm;
+
+                // x-dependent criteria need the background update finished
+                if (energy_est || opts->stop_criterion == STOP_BACKWARD_ERROR) {
+                    wait_chunks(g, g->tok_x);
+                    stop.xnorm = sqrt(sum_partials(g->part_c, nc));
+                    if (energy_est) stop_record_energy(&stop, sum_partials(g->part_d, nc));
+                }
+                done = stop_check(opts, &stop, r_norm, n);
+            }
+
+            if (done) {
+                // Confirm with the true residual; on drift continue from it
+                double res = st->recursive_residual;
+                if (check_true) {
+                    double t_replace = omp_get_wtime();
+                    tasks_residual(g, opts, A, x, b, r, r0, t, 0, warm);
+                    wait_chunks(g, g->tok_r);
+                    st->replace_time += omp_get_wtime() - t_replace;
+                    st->replace_count++;
+                    res = sqrt(sum_partials(g->part_a, nc)) / bnorm;
+                    rho = sum_partials(g->part_b, nc);
+                    st->true_residual = res;
+                }
+                if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                    if (opts->verbose) {
+                        printf("BICGSTAB (tasks, %d threads) converged at iteration %d (residual: %.2e)\n",
+                               num_threads, iter+1, res);
+                    }
+                    converged = 1;
+                    iter++;
+                    break;
+                }
+                r_norm_ref = res * bnorm;
+                restart = 1;
+                continue;
+            }
+
+            // Periodic or drift-triggered residual replacement
+            if ((opts->replace_interval > 0 && (iter+1) % opts->replace_interval == 0) ||
+                (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+                double t_replace = omp_get_wtime();
+                tasks_residual(g, opts, A, x, b, r, r0, t, 0, warm);
+                wait_chunks(g, g->tok_r);
+                st->replace_time += omp_get_wtime() - t_replace;
+                st->replace_count++;
+                st->true_residual = sqrt(sum_partials(g->part_a, nc)) / bnorm;
+                rho = sum_partials(g->part_b, nc);
+                r_norm_ref = st->true_residual * bnorm;
+            }
+
+            if (fabs(omega) < 1e-30) {
+                printf("BICGSTAB (tasks): omega breakdown at iteration %d\n", iter);
+                break;
+            }
+        }
+
+        #pragma omp taskwait
+        stop_value = stop.value;
+    }
+
+    *solve_time = omp_get_wtime() - start;
+    st->iterations = iter;
+    st->stop_value = stop_value;
+
+    task_graph_free(g);
+    if (own_ws) solver_workspace_free(ws);
+
+    if (!converged && iter >= opts->max_iter) {
+        printf("BICGSTAB (tasks) did not converge within %d iterations\n", opts->max_iter);
+        return -1;
+    }
+    return iter;
+}
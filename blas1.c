@@ -0,0 +1,285 @@
+// blas1.c
+// Vector kernels with one implementation per instruction set, picked at startup
+
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "blas1.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BLAS1_X86 1
+#include <immintrin.h>
+#endif
+
+// Streaming threshold when the cache size is unknown
+#define BLAS1_DEFAULT_LLC (32L << 20)
+
+typedef struct {
+    const char *name;
+    double (*dot)(const double*, const double*, int);
+    void (*dot2)(const double*, const double*, const double*, const double*, int,
+                 double*, double*);
+    void (*copy)(const double*, double*, int, int);
+    void (*axpy)(double, const double*, double*, int);
+    void (*axpby)(double, const double*, double, const double*, double*, int, int);
+    double (*axpby_norm)(double, const double*, double, const double*, double*, int, int);
+    void (*direction)(double*, const double*, const double*, double, double, int);
+} Blas1Kernels;
+
+// Scalar entries before p reaches an align-byte boundary (all of them if p
+// cannot get there, i.e. is not even 8-byte aligned)
+static int peel_count(const void *p, int n, size_t align) {
+    uintptr_t mis = (uintptr_t)p % align;
+    if (mis == 0) return 0;
+    if (mis % sizeof(double) != 0) return n;
+    int head = (int)((align - mis) / sizeof(double));
+    return head < n ? head : n;
+}
+
+// ---- Portable scalar code (four accumulators via VW = 1) ----
+
+#define VEC                 double
+#define VW                  1
+#define VZERO()             0.0
+#define VSET1(s)            (s)
+#define VLOADU(p)           (*(p))
+#define VSTORE(p, v)        (*(p) = (v))
+#define VSTREAM(p, v)       (*(p) = (v))
+#define VADD(a, b)          ((a) + (b))
+#define VSUB(a, b)          ((a) - (b))
+#define VMUL(a, b)          ((a) * (b))
+#define VFMA(a, b, c)       ((a) * (b) + (c))
+#define VHSUM(v)            (v)
+#define VFENCE()            ((void)0)
+#define BLAS1_TARGET
+#define FN(name)            name##_scalar
+#define ISA_NAME            "scalar"
+#include "blas1_template.h"
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOADU
+#undef VSTORE
+#undef VSTREAM
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VFMA
+#undef VHSUM
+#undef VFENCE
+#undef BLAS1_TARGET
+#undef FN
+#undef ISA_NAME
+
+#ifdef BLAS1_X86
+
+// ---- SSE2: 2 doubles, no FMA ----
+
+#define BLAS1_TARGET        __attribute__((target("sse2")))
+BLAS1_TARGET static inline double hsum_sse2(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+#define VEC                 __m128d
+#define VW                  2
+#define VZERO()             _mm_setzero_pd()
+#define VSET1(s)            _mm_set1_pd(s)
+#define VLOADU(p)           _mm_loadu_pd(p)
+#define VSTORE(p, v)        _mm_store_pd((p), (v))
+#define VSTREAM(p, v)       _mm_stream_pd((p), (v))
+#define VADD(a, b)          _mm_add_pd((a), (b))
+#define VSUB(a, b)          _mm_sub_pd((a), (b))
+#define VMUL(a, b)          _mm_mul_pd((a), (b))
+#define VFMA(a, b, c)       _mm_add_pd(_mm_mul_pd((a), (b)), (c))
+#define VHSUM(v)            hsum_sse2(v)
+#define VFENCE()            _mm_sfence()
+#define FN(name)            name##_sse2
+#define ISA_NAME            "sse2"
+#include "blas1_template.h"
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOADU
+#undef VSTORE
+#undef VSTREAM
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VFMA
+#undef VHSUM
+#undef VFENCE
+#undef BLAS1_TARGET
+#undef FN
+#undef ISA_NAME
+
+// ---- AVX2 + FMA: 4 doubles ----
+
+#define BLAS1_TARGET        __attribute__((target("avx2,fma")))
+BLAS1_TARGET static inline double hsum_avx2(__m256d v) {
+    __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+#define VEC                 __m256d
+#define VW                  4
+#define VZERO()             _mm256_setzero_pd()
+#define VSET1(s)            _mm256_set1_pd(s)
+#define VLOADU(p)           _mm256_loadu_pd(p)
+#define VSTORE(p, v)        _mm256_store_pd((p), (v))
+#define VSTREAM(p, v)       _mm256_stream_pd((p), (v))
+#define VADD(a, b)          _mm256_add_pd((a), (b))
+#define VSUB(a, b)          _mm256_sub_pd((a), (b))
+#define VMUL(a, b)          _mm256_mul_pd((a), (b))
+#define VFMA(a, b, c)       _mm256_fmadd_pd((a), (b), (c))
+#define VHSUM(v)            hsum_avx2(v)
+#define VFENCE()            _mm_sfence()
+#define FN(name)            name##_avx2
+#define ISA_NAME            "avx2"
+#include "blas1_template.h"
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOADU
+#undef VSTORE
+#undef VSTREAM
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VFMA
+#undef VHSUM
+#undef VFENCE
+#undef BLAS1_TARGET
+#undef FN
+#undef ISA_NAME
+
+// ---- AVX-512F: 8 doubles ----
+
+#define BLAS1_TARGET        __attribute__((target("avx512f")))
+#define VEC                 __m512d
+#define VW                  8
+#define VZERO()             _mm512_setzero_pd()
+#define VSET1(s)            _mm512_set1_pd(s)
+#define VLOADU(p)           _mm512_loadu_pd(p)
+#define VSTORE(p, v)        _mm512_store_pd((p), (v))
+#define VSTREAM(p, v)       _mm512_stream_pd((p), (v))
+#define VADD(a, b)          _mm512_add_pd((a), (b))
+#define VSUB(a, b)          _mm512_sub_pd((a), (b))
+#define VMUL(a, b)          _mm512_mul_pd((a), (b))
+#define VFMA(a, b, c)       _mm512_fmadd_pd((a), (b), (c))
+#define VHSUM(v)            _mm512_reduce_add_pd(v)
+#define VFENCE()            _mm_sfence()
+#define FN(name)            name##_avx512
+#define ISA_NAME            "avx512"
+#include "blas1_template.h"
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOADU
+#undef VSTORE
+#undef VSTREAM
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VFMA
+#undef VHSUM
+#undef VFENCE
+#undef BLAS1_TARGET
+#undef FN
+#undef ISA_NAME
+
+#endif // BLAS1_X86
+
+// ---- Dispatch ----
+
+static const Blas1Kernels *active = &kernels_scalar;
+static long stream_bytes = BLAS1_DEFAULT_LLC / 2;
+
+// Implementation by name, NULL if this CPU or build lacks it
+static const Blas1Kernels* lookup(const char *isa) {
+    if (strcmp(isa, "scalar") == 0) return &kernels_scalar;
+#ifdef BLAS1_X86
+    __builtin_cpu_init();
+    if (strcmp(isa, "sse2") == 0 && __builtin_cpu_supports("sse2")) return &kernels_sse2;
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2") &&
+        __builtin_cpu_supports("fma")) return &kernels_avx2;
+    if (strcmp(isa, "avx512") == 0 && __builtin_cpu_supports("avx512f")) return &kernels_avx512;
+#endif
+    return NULL;
+}
+
+// Runs before main: best implementation, threshold from the cache size
+__attribute__((constructor))
+static void blas1_init(void) {
+    blas1_select(NULL);
+    long llc = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    stream_bytes = (llc > 0 ? llc : BLAS1_DEFAULT_LLC) / 2;
+}
+
+const char* blas1_isa(void) {
+    return active->name;
+}
+
+int blas1_select(const char *isa) {
+    if (isa) {
+        const Blas1Kernels *k = lookup(isa);
+        if (!k) return -1;
+        active = k;
+        return 0;
+    }
+    static const char *const best_first[] = { "avx512", "avx2", "sse2", "scalar" };
+    for (size_t i = 0; i < sizeof(best_first) / sizeof(best_first[0]); i++) {
+        const Blas1Kernels *k = lookup(best_first[i]);
+        if (k) {
+            active = k;
+            break;
+        }
+    }
+    return 0;
+}
+
+int blas1_stream(long n) {
+    return stream_bytes > 0 && n * (long)sizeof(double) > stream_bytes;
+}
+
+void blas1_set_stream_bytes(long bytes) {
+    stream_bytes = bytes;
+}
+
+double blas1_dot(const double *a, const double *b, int n) {
+    return active->dot(a, b, n);
+}
+
+void blas1_dot2(const double *a, const double *b, const double *c, const double *d, int n,
+                double *ab, double *cd) {
+    active->dot2(a, b, c, d, n, ab, cd);
+}
+
+void blas1_copy(const double *src, double *dst, int n, int stream) {
+    active->copy(src, dst, n, stream);
+}
+
+void blas1_axpy(double a, const double *x, double *y, int n) {
+    active->axpy(a, x, y, n);
+}
+
+void blas1_axpby(double a, const double *x, double b, const double *y, double *z,
+                 int n, int stream) {
+    active->axpby(a, x, b, y, z, n, stream);
+}
+
+double blas1_axpby_norm(double a, const double *x, double b, const double *y, double *z,
+                        int n, int stream) {
+    return active->axpby_norm(a, x, b, y, z, n, stream);
+}
+
+void blas1_direction(double *p, const double *r, const double *v, double beta, double omega,
+                     int n) {
+    active->direction(p, r, v, beta, omega, n);
+}
@@ -0,0 +1,58 @@
+// blas1.h
+// Vector kernels shared by the solvers, hand-vectorized for several
+// instruction sets and selected once at program start
+//
+// Implementations: portable scalar code, SSE2, AVX2+FMA and AVX-512F (x86
+// only, chosen from cpuid). Reductions keep four independent accumulators
+// so the loop is limited by loads, not by the floating-point add latency.
+// Kernels that store peel the first entries until the output is vector
+// aligned; outputs that are only written can use non-temporal (streaming)
+// stores, which skip the read-for-ownership once vectors exceed the cache
+//
+// All kernels take plain ranges, so parallel callers give each thread a
+// slice. The summation order depends on the instruction set and on the
+// slice alignment, not on anything else
+
+#ifndef BLAS1_H
+#define BLAS1_H
+
+// Name of the active implementation ("scalar", "sse2", "avx2", "avx512")
+const char* blas1_isa(void);
+
+// Switches the implementation (NULL = best supported); -1 if the CPU or the
+// build does not support it
+int blas1_select(const char *isa);
+
+// 1 if an output of n doubles should be written with streaming stores
+// (larger than the threshold, by default half the last-level cache)
+int blas1_stream(long n);
+
+// Sets the streaming threshold in bytes (0 = never stream)
+void blas1_set_stream_bytes(long bytes);
+
+// a.b
+double blas1_dot(const double *a, const double *b, int n);
+
+// a.b and c.d in one pass
+void blas1_dot2(const double *a, const double *b, const double *c, const double *d, int n,
+                double *ab, double *cd);
+
+// dst = src
+void blas1_copy(const double *src, double *dst, int n, int stream);
+
+// y = y + a*x
+void blas1_axpy(double a, const double *x, double *y, int n);
+
+// z = a*x + b*y (z may alias x or y only with stream = 0)
+void blas1_axpby(double a, const double *x, double b, const double *y, double *z,
+                 int n, int stream);
+
+// z = a*x + b*y, returns ||z||^2
+double blas1_axpby_norm(double a, const double *x, double b, const double *y, double *z,
+                        int n, int stream);
+
+// BICGSTAB search direction p = r + beta*(p - omega*v)
+void blas1_direction(double *p, const double *r, const double *v, double beta, double omega,
+                     int n);
+
+#endif // BLAS1_H
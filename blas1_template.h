@@ -0,0 +1,184 @@
+// blas1_template.h
+// Kernel bodies of blas1.c, included once per instruction set
+//
+// The includer defines:
+//   VEC, VW            vector type and its number of doubles
+//   VZERO(), VSET1(s)  constant vectors
+//   VLOADU(p)          unaligned load
+//   VSTORE(p, v)       aligned store, VSTREAM(p, v) aligned non-temporal store
+//   VADD, VSUB, VMUL   lane-wise arithmetic
+//   VFMA(a, b, c)      a*b + c
+//   VHSUM(v)           sum of the lanes
+//   VFENCE()           orders streaming stores before later stores
+//   BLAS1_TARGET       function attribute enabling the instruction set
+//   FN(name)           kernel name with the instruction-set suffix
+//   ISA_NAME           name reported by blas1_isa
+
+// Entries to handle before p is aligned for VW-wide stores
+#define PEEL(p, n) peel_count((const void*)(p), (n), VW * sizeof(double))
+
+BLAS1_TARGET
+static double FN(dot)(const double *a, const double *b, int n) {
+    int i = 0, head = PEEL(a, n);
+    double sum = 0.0;
+    for (; i < head; i++) sum += a[i] * b[i];
+
+    VEC s0 = VZERO(), s1 = VZERO(), s2 = VZERO(), s3 = VZERO();
+    for (; i + 4 * VW <= n; i += 4 * VW) {
+        s0 = VFMA(VLOADU(a + i), VLOADU(b + i), s0);
+        s1 = VFMA(VLOADU(a + i + VW), VLOADU(b + i + VW), s1);
+        s2 = VFMA(VLOADU(a + i + 2 * VW), VLOADU(b + i + 2 * VW), s2);
+        s3 = VFMA(VLOADU(a + i + 3 * VW), VLOADU(b + i + 3 * VW), s3);
+    }
+    for (; i + VW <= n; i += VW) {
+        s0 = VFMA(VLOADU(a + i), VLOADU(b + i), s0);
+    }
+    sum += VHSUM(VADD(VADD(s0, s1), VADD(s2, s3)));
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+BLAS1_TARGET
+static void FN(dot2)(const double *a, const double *b, const double *c, const double *d, int n,
+                     double *ab_out, double *cd_out) {
+    int i = 0, head = PEEL(a, n);
+    double ab = 0.0, cd = 0.0;
+    for (; i < head; i++) {
+        ab += a[i] * b[i];
+        cd += c[i] * d[i];
+    }
+
+    // Same accumulators and order as dot, so a.b (and c.d for c aligned
+    // like a) match dot bitwise
+    VEC x0 = VZERO(), x1 = VZERO(), x2 = VZERO(), x3 = VZERO();
+    VEC y0 = VZERO(), y1 = VZERO(), y2 = VZERO(), y3 = VZERO();
+    for (; i + 4 * VW <= n; i += 4 * VW) {
+        x0 = VFMA(VLOADU(a + i), VLOADU(b + i), x0);
+        y0 = VFMA(VLOADU(c + i), VLOADU(d + i), y0);
+        x1 = VFMA(VLOADU(a + i + VW), VLOADU(b + i + VW), x1);
+        y1 = VFMA(VLOADU(c + i + VW), VLOADU(d + i + VW), y1);
+        x2 = VFMA(VLOADU(a + i + 2 * VW), VLOADU(b + i + 2 * VW), x2);
+        y2 = VFMA(VLOADU(c + i + 2 * VW), VLOADU(d + i + 2 * VW), y2);
+        x3 = VFMA(VLOADU(a + i + 3 * VW), VLOADU(b + i + 3 * VW), x3);
+        y3 = VFMA(VLOADU(c + i + 3 * VW), VLOADU(d + i + 3 * VW), y3);
+    }
+    for (; i + VW <= n; i += VW) {
+        x0 = VFMA(VLOADU(a + i), VLOADU(b + i), x0);
+        y0 = VFMA(VLOADU(c + i), VLOADU(d + i), y0);
+    }
+    ab += VHSUM(VADD(VADD(x0, x1), VADD(x2, x3)));
+    cd += VHSUM(VADD(VADD(y0, y1), VADD(y2, y3)));
+    for (; i < n; i++) {
+        ab += a[i] * b[i];
+        cd += c[i] * d[i];
+    }
+    *ab_out = ab;
+    *cd_out = cd;
+}
+
+BLAS1_TARGET
+static void FN(copy)(const double *src, double *dst, int n, int stream) {
+    int i = 0, head = PEEL(dst, n);
+    for (; i < head; i++) dst[i] = src[i];
+    if (stream) {
+        for (; i + VW <= n; i += VW) VSTREAM(dst + i, VLOADU(src + i));
+        VFENCE();
+    } else {
+        for (; i + VW <= n; i += VW) VSTORE(dst + i, VLOADU(src + i));
+    }
+    for (; i < n; i++) dst[i] = src[i];
+}
+
+BLAS1_TARGET
+static void FN(axpy)(double a, const double *x, double *y, int n) {
+    int i = 0, head = PEEL(y, n);
+    for (; i < head; i++) y[i] += a * x[i];
+    VEC va = VSET1(a);
+    for (; i + VW <= n; i += VW) {
+        VSTORE(y + i, VFMA(va, VLOADU(x + i), VLOADU(y + i)));
+    }
+    for (; i < n; i++) y[i] += a * x[i];
+}
+
+BLAS1_TARGET
+static void FN(axpby)(double a, const double *x, double b, const double *y, double *z,
+                      int n, int stream) {
+    int i = 0, head = PEEL(z, n);
+    for (; i < head; i++) z[i] = a * x[i] + b * y[i];
+    VEC va = VSET1(a), vb = VSET1(b);
+    if (stream) {
+        for (; i + VW <= n; i += VW) {
+            VSTREAM(z + i, VFMA(va, VLOADU(x + i), VMUL(vb, VLOADU(y + i))));
+        }
+        VFENCE();
+    } else {
+        for (; i + VW <= n; i += VW) {
+            VSTORE(z + i, VFMA(va, VLOADU(x + i), VMUL(vb, VLOADU(y + i))));
+        }
+    }
+    for (; i < n; i++) z[i] = a * x[i] + b * y[i];
+}
+
+BLAS1_TARGET
+static double FN(axpby_norm)(double a, const double *x, double b, const double *y, double *z,
+                             int n, int stream) {
+    int i = 0, head = PEEL(z, n);
+    double sum = 0.0;
+    for (; i < head; i++) {
+        z[i] = a * x[i] + b * y[i];
+        sum += z[i] * z[i];
+    }
+
+    VEC va = VSET1(a), vb = VSET1(b);
+    VEC s0 = VZERO(), s1 = VZERO();
+    if (stream) {
+        for (; i + 2 * VW <= n; i += 2 * VW) {
+            VEC z0 = VFMA(va, VLOADU(x + i), VMUL(vb, VLOADU(y + i)));
+            VEC z1 = VFMA(va, VLOADU(x + i + VW), VMUL(vb, VLOADU(y + i + VW)));
+            VSTREAM(z + i, z0);
+            VSTREAM(z + i + VW, z1);
+            s0 = VFMA(z0, z0, s0);
+            s1 = VFMA(z1, z1, s1);
+        }
+    } else {
+        for (; i + 2 * VW <= n; i += 2 * VW) {
+            VEC z0 = VFMA(va, VLOADU(x + i), VMUL(vb, VLOADU(y + i)));
+            VEC z1 = VFMA(va, VLOADU(x + i + VW), VMUL(vb, VLOADU(y + i + VW)));
+            VSTORE(z + i, z0);
+            VSTORE(z + i + VW, z1);
+            s0 = VFMA(z0, z0, s0);
+            s1 = VFMA(z1, z1, s1);
+        }
+    }
+    for (; i + VW <= n; i += VW) {
+        VEC z0 = VFMA(va, VLOADU(x + i), VMUL(vb, VLOADU(y + i)));
+        VSTORE(z + i, z0);
+        s0 = VFMA(z0, z0, s0);
+    }
+    if (stream) VFENCE();
+    sum += VHSUM(VADD(s0, s1));
+    for (; i < n; i++) {
+        z[i] = a * x[i] + b * y[i];
+        sum += z[i] * z[i];
+    }
+    return sum;
+}
+
+BLAS1_TARGET
+static void FN(direction)(double *p, const double *r, const double *v, double beta, double omega,
+                          int n) {
+    int i = 0, head = PEEL(p, n);
+    for (; i < head; i++) p[i] = r[i] + beta * (p[i] - omega * v[i]);
+    VEC vbeta = VSET1(beta), vomega = VSET1(omega);
+    for (; i + VW <= n; i += VW) {
+        VEC d = VSUB(VLOADU(p + i), VMUL(vomega, VLOADU(v + i)));
+        VSTORE(p + i, VFMA(vbeta, d, VLOADU(r + i)));
+    }
+    for (; i < n; i++) p[i] = r[i] + beta * (p[i] - omega * v[i]);
+}
+
+static const Blas1Kernels FN(kernels) = {
+    ISA_NAME, FN(dot), FN(dot2), FN(copy), FN(axpy), FN(axpby), FN(axpby_norm), FN(direction)
+};
+
+#undef PEEL
@@ -0,0 +1,211 @@
+// csr5.c
+// CSR5 tile descriptors and segmented-sum SpMV kernels
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "csr5.h"
+
+// One tile: segmented sums in all lanes, lane carries, then one value per
+// row whose last entry lies in the tile (with the w.y / y.y epilogues).
+// carry is the partial sum of the row open at the tile start; returns the
+// partial sum of the row still open at the tile end. full = 0 only for the
+// last tile, whose lanes run past nnz
+static inline double csr5_tile(const Csr5Matrix *m, int t, double carry, const double *x,
+                               double *y, const double *w, double *wy, double *yy, int full) {
+    const CSRMatrix *A = m->A;
+    int base = t * CSR5_TILE;
+    int count = A->nnz - base;
+    const double *val = A->values + base;
+    const int *col = A->col_idx + base;
+    const unsigned short *flags = m->lane_flags + t * CSR5_OMEGA;
+
+    // Products in entry order (contiguous loads, x gathered), then the
+    // segmented sum across the lanes; seg[k][l] is lane l's running sum up
+    // to its entry k since its last row end
+    double prod[CSR5_TILE];
+    if (full) {
+        #pragma omp simd
+        for (int e = 0; e < CSR5_TILE; e++) prod[e] = val[e] * x[col[e]];
+    } else {
+        for (int e = 0; e < CSR5_TILE; e++) prod[e] = e < count ? val[e] * x[col[e]] : 0.0;
+    }
+    double seg[CSR5_SIGMA][CSR5_OMEGA];
+    double acc[CSR5_OMEGA] = {0.0};
+    for (int k = 0; k < CSR5_SIGMA; k++) {
+        #pragma omp simd
+        for (int l = 0; l < CSR5_OMEGA; l++) {
+            double sum = acc[l] + prod[l * CSR5_SIGMA + k];
+            seg[k][l] = sum;
+            acc[l] = ((flags[l] >> k) & 1) ? 0.0 : sum;
+        }
+    }
+
+    // A lane's first row end also completes the row carried in from the
+    // lanes (and tiles) before it; acc[l] is the lane's open tail
+    for (int l = 0; l < CSR5_OMEGA; l++) {
+        if (flags[l]) {
+            seg[__builtin_ctz(flags[l])][l] += carry;
+            carry = acc[l];
+        } else {
+            carry += acc[l];
+        }
+    }
+
+    // Rows ending here: the sum sits at the row's last entry (empty rows: 0)
+    double a = 0.0, c = 0.0;
+    int r_end = m->tile_row[t + 1];
+    for (int r = m->tile_row[t]; r < r_end; r++) {
+        int len = A->row_ptr[r + 1] - A->row_ptr[r];
+        int p = len > 0 ? A->row_ptr[r + 1] - 1 - base : 0;
+        double v = len > 0 ? seg[p % CSR5_SIGMA][p / CSR5_SIGMA] : 0.0;
+        y[r] = v;
+        if (w) {
+            a += w[r] * v;
+            c += v * v;
+        }
+    }
+    *wy += a;
+    *yy += c;
+    return carry;
+}
+
+// Tiles t0..t1-1 in order; returns the carry out of the last one
+static double csr5_tiles(const Csr5Matrix *m, int t0, int t1, const double *x, double *y,
+                         const double *w, double *wy, double *yy) {
+    double carry = 0.0;
+    int full_tiles = m->A->nnz / CSR5_TILE;
+    for (int t = t0; t < t1; t++) {
+        if (t < full_tiles) {
+            carry = csr5_tile(m, t, carry, x, y, w, wy, yy, 1);
+        } else {
+            carry = csr5_tile(m, t, carry, x, y, w, wy, yy, 0);
+        }
+    }
+    return carry;
+}
+
+static void csr5_apply(LinearOperator *op, const double *x, double *y, int parallel) {
+    Csr5Matrix *m = (Csr5Matrix*)op;
+    if (parallel) {
+        csr5_matvec_parallel(m, x, y, NULL, NULL);
+    } else {
+        csr5_matvec(m, x, y, NULL, NULL);
+    }
+}
+
+static void csr5_apply_dots(LinearOperator *op, const double *x, double *y, const double *w,
+                            double *dots, int parallel) {
+    Csr5Matrix *m = (Csr5Matrix*)op;
+    if (parallel) {
+        csr5_matvec_parallel(m, x, y, w, dots);
+    } else {
+        csr5_matvec(m, x, y, w, dots);
+    }
+}
+
+Csr5Matrix* csr5_create(CSRMatrix *A) {
+    Csr5Matrix *m = (Csr5Matrix*)calloc(1, sizeof(Csr5Matrix));
+    m->op.name = "CSR5";
+    m->op.n = A->n;
+    m->op.apply = csr5_apply;
+    m->op.apply_dots = csr5_apply_dots;
+    m->A = A;
+    m->num_tiles = (A->nnz + CSR5_TILE - 1) / CSR5_TILE;
+
+    int lanes = m->num_tiles * CSR5_OMEGA;
+    size_t bytes = arena_size(m->num_tiles + 1, sizeof(int)) +
+                   arena_size(lanes > 0 ? lanes : 1, sizeof(unsigned short));
+    if (arena_init(&m->arena, bytes) != 0) {
+        free(m);
+        return NULL;
+    }
+    m->tile_row = (int*)arena_alloc(&m->arena, m->num_tiles + 1, sizeof(int));
+    m->lane_flags = (unsigned short*)arena_alloc(&m->arena, lanes > 0 ? lanes : 1,
+                                                 sizeof(unsigned short));
+
+    // Tile t serves the rows with row_ptr[r+1] in (t*TILE, (t+1)*TILE];
+    // leading empty rows go to tile 0 and trailing ones to the last tile
+    int r = 0;
+    m->tile_row[0] = 0;
+    for (int t = 1; t < m->num_tiles; t++) {
+        int base = t * CSR5_TILE;
+        while (r < A->n && A->row_ptr[r + 1] <= base) r++;
+        m->tile_row[t] = r;
+    }
+    m->tile_row[m->num_tiles] = A->n;
+
+    // Row-end flags: entry e is bit e % SIGMA of lane e / SIGMA
+    for (int i = 0; i < A->n; i++) {
+        if (A->row_ptr[i + 1] > A->row_ptr[i]) {
+            int e = A->row_ptr[i + 1] - 1;
+            m->lane_flags[e / CSR5_SIGMA] |= (unsigned short)(1u << (e % CSR5_SIGMA));
+        }
+    }
+    return m;
+}
+
+void csr5_free(Csr5Matrix *m) {
+    if (!m) return;
+    arena_release(&m->arena);
+    free(m);
+}
+
+void csr5_matvec(Csr5Matrix *m, const double *x, double *y, const double *w, double *dots) {
+    double wy = 0.0, yy = 0.0;
+    if (m->num_tiles == 0) {
+        for (int i = 0; i < m->A->n; i++) y[i] = 0.0;
+    }
+    csr5_tiles(m, 0, m->num_tiles, x, y, w, &wy, &yy);
+    if (w) {
+        dots[0] = wy;
+        dots[1] = yy;
+    }
+}
+
+void csr5_matvec_parallel(Csr5Matrix *m, const double *x, double *y, const double *w,
+                          double *dots) {
+    if (m->num_tiles == 0) {
+        csr5_matvec(m, x, y, w, dots);
+        return;
+    }
+    int max_threads = omp_get_max_threads();
+    double carry[max_threads], part_wy[max_threads], part_yy[max_threads];
+    int carry_row[max_threads];
+    int team = 1;
+
+    #pragma omp parallel
+    {
+        int nt = omp_get_num_threads(), id = omp_get_thread_num();
+        int t0 = (int)((long)m->num_tiles * id / nt);
+        int t1 = (int)((long)m->num_tiles * (id + 1) / nt);
+        part_wy[id] = 0.0;
+        part_yy[id] = 0.0;
+        carry[id] = csr5_tiles(m, t0, t1, x, y, w, &part_wy[id], &part_yy[id]);
+        // The open row at the end of this range was written by a later thread
+        carry_row[id] = t1 < m->num_tiles ? m->tile_row[t1] : -1;
+        if (id == 0) team = nt;
+    }
+
+    // Add each thread's tail to its row in thread order (a row may span
+    // several ranges), correcting the dots for the changed y entries
+    double wy = 0.0, yy = 0.0;
+    for (int id = 0; id < team; id++) {
+        wy += part_wy[id];
+        yy += part_yy[id];
+    }
+    for (int id = 0; id < team; id++) {
+        int r = carry_row[id];
+        if (r < 0 || carry[id] == 0.0) continue;
+        double old = y[r];
+        y[r] = old + carry[id];
+        if (w) {
+            wy += w[r] * carry[id];
+            yy += carry[id] * (2.0 * old + carry[id]);
+        }
+    }
+    if (w) {
+        dots[0] = wy;
+        dots[1] = yy;
+    }
+}
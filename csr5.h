@@ -0,0 +1,47 @@
+// csr5.h
+// CSR5 storage: tile descriptors over the arrays of an existing CSRMatrix
+//
+// The nonzeros are cut into tiles of CSR5_OMEGA lanes x CSR5_SIGMA entries;
+// lane l of a tile owns CSR5_SIGMA consecutive entries. Every tile holds the
+// same number of entries whatever the row lengths, so tiles are the unit of
+// work and of thread balance. Per tile the SpMV runs
+//   1. a segmented sum in all lanes at once: products accumulate along the
+//      lane and restart after each entry flagged as the end of a row
+//   2. a carry pass over the lanes for rows that continue across lanes
+//   3. one read per row (the sum at the row's last entry), with no inner
+//      loop, so 1-entry Dirichlet rows and 5-entry interior rows cost the
+//      same control flow
+// Rows crossing tile (and thread) boundaries receive the carried partial
+// sum. values / col_idx / row_ptr are borrowed, not copied or reordered
+
+#ifndef CSR5_H
+#define CSR5_H
+
+#include "fem_matrix.h"
+#include "linear_operator.h"
+
+#define CSR5_OMEGA 8        // Lanes per tile (one AVX-512 vector of doubles)
+#define CSR5_SIGMA 16       // Entries per lane (bits of a lane flag word)
+#define CSR5_TILE (CSR5_OMEGA * CSR5_SIGMA)
+
+typedef struct {
+    LinearOperator op;          // Must be first: passed to solvers as LinearOperator*
+    CSRMatrix *A;               // Borrowed arrays (must outlive the descriptor)
+    int num_tiles;
+    int *tile_row;              // num_tiles + 1: first row whose last entry is in the tile
+    unsigned short *lane_flags; // num_tiles * CSR5_OMEGA: bit k = entry k of the lane ends a row
+    Arena arena;                // Holds tile_row and lane_flags
+} Csr5Matrix;
+
+// Builds the tile descriptors for A (O(n + nnz / CSR5_SIGMA) extra memory)
+Csr5Matrix* csr5_create(CSRMatrix *A);
+void csr5_free(Csr5Matrix *m);
+
+// y = A*x (serial); with w != NULL also dots[0] = w.y, dots[1] = y.y
+void csr5_matvec(Csr5Matrix *m, const double *x, double *y, const double *w, double *dots);
+
+// Same on the current OpenMP team, tiles split evenly over the threads
+void csr5_matvec_parallel(Csr5Matrix *m, const double *x, double *y, const double *w,
+                          double *dots);
+
+#endif // CSR5_H
@@ -0,0 +1,234 @@
+// fem_assembly.c
+// Variable-coefficient assembly with bilinear elements and 2x2 Gauss quadrature
+// Phase 1 (parallel over elements): element stiffness and load
+// Phase 2 (parallel over rows): each row gathers from the <= 4 elements
+// around its node, so no two threads ever write the same entry
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "fem_assembly.h"
+
+#define NQ 4    // Quadrature points per element (2x2 Gauss)
+#define NE 4    // Nodes per element
+
+// Local node a of element (ei, ej): 0=(ei,ej) 1=(ei+1,ej) 2=(ei+1,ej+1) 3=(ei,ej+1)
+// Reference coordinates (xi along i, eta along j)
+static const double node_xi[NE]  = {-1.0,  1.0, 1.0, -1.0};
+static const double node_eta[NE] = {-1.0, -1.0, 1.0,  1.0};
+
+static const int node_di[NE] = {0, 1, 1, 0};
+static const int node_dj[NE] = {0, 0, 1, 1};
+
+// Gauss points in reference coordinates (weights are 1)
+#define GAUSS_PT 0.57735026918962576451
+static const double quad_xi[NQ]  = {-GAUSS_PT,  GAUSS_PT, GAUSS_PT, -GAUSS_PT};
+static const double quad_eta[NQ] = {-GAUSS_PT, -GAUSS_PT, GAUSS_PT,  GAUSS_PT};
+
+static double shape(int a, double xi, double eta) {
+    return 0.25 * (1.0 + xi * node_xi[a]) * (1.0 + eta * node_eta[a]);
+}
+
+// Geometry of element e at quadrature point q: physical position, scaled
+// weight and weighted gradient products (node (i,j) is at x = i*hi, y = j*hj)
+static void element_geometry(int ei, int ej, double hi, double hj, int q,
+                             double *quad, double *grad) {
+    double xi = quad_xi[q], eta = quad_eta[q];
+    double wdet = 0.25 * hi * hj;   // weight 1 times detJ
+    quad[0] = (ei + 0.5 * (1.0 + xi)) * hi;
+    quad[1] = (ej + 0.5 * (1.0 + eta)) * hj;
+    quad[2] = wdet;
+    
+    double gx[NE], gy[NE];
+    for (int a = 0; a < NE; a++) {
+        gx[a] = 0.25 * node_xi[a] * (1.0 + eta * node_eta[a]) * (2.0 / hi);
+        gy[a] = 0.25 * node_eta[a] * (1.0 + xi * node_xi[a]) * (2.0 / hj);
+    }
+    for (int a = 0; a < NE; a++) {
+        for (int b = 0; b < NE; b++) {
+            grad[a*NE + b] = wdet * (gx[a] * gx[b] + gy[a] * gy[b]);
+        }
+    }
+}
+
+// Coefficient at a quadrature point: callback, or nodal samples interpolated
+static double eval_coefficient(CoefficientFn fn, const double *nodal, void *ctx,
+                               const int *nodes, int q, double x, double y,
+                               double default_value) {
+    if (fn) return fn(x, y, ctx);
+    if (nodal) {
+        double value = 0.0;
+        for (int a = 0; a < NE; a++) {
+            value += shape(a, quad_xi[q], quad_eta[q]) * nodal[nodes[a]];
+        }
+        return value;
+    }
+    return default_value;
+}
+
+FEMAssembly* fem_assembly_create(int nx, int ny, int cache_geometry) {
+    printf("Creating FEM assembly: %dx%d grid (%d nodes)\n", nx, ny, nx*ny);
+    
+    FEMAssembly *fa = (FEMAssembly*)malloc(sizeof(FEMAssembly));
+    
+    // Pattern: identity on Dirichlet rows, 3x3 neighbourhood elsewhere
+    // (columns in ascending order since node = i*nx + j)
+    int interior = (nx > 2 && ny > 2) ? (nx - 2) * (ny - 2) : 0;
+    FEMSystem *sys = fem_system_alloc(nx, ny, nx * ny + 8 * interior);
+    fa->sys = sys;
+    CSRMatrix *A = &sys->A;
+    int nnz_count = 0;
+    A->row_ptr[0] = 0;
+    for (int i = 0; i < ny; i++) {
+        for (int j = 0; j < nx; j++) {
+            int node = i * nx + j;
+            if (get_boundary_type(i, j, nx, ny) > 0) {
+                A->col_idx[nnz_count++] = node;
+            } else {
+                for (int di = -1; di <= 1; di++) {
+                    for (int dj = -1; dj <= 1; dj++) {
+                        A->col_idx[nnz_count++] = (i + di) * nx + (j + dj);
+                    }
+                }
+            }
+            A->row_ptr[node + 1] = nnz_count;
+        }
+    }
+    
+    // Element -> CSR position map
+    fa->num_elements = (nx - 1) * (ny - 1);
+    fa->elem_pos = (int*)malloc(fa->num_elements * NE * NE * sizeof(int));
+    fa->elem_matrix = (double*)malloc(fa->num_elements * NE * NE * sizeof(double));
+    fa->elem_load = (double*)malloc(fa->num_elements * NE * sizeof(double));
+    
+    #pragma omp parallel for
+    for (int e = 0; e < fa->num_elements; e++) {
+        int ei = e / (nx - 1), ej = e % (nx - 1);
+        for (int a = 0; a < NE; a++) {
+            int ia = ei + node_di[a], ja = ej + node_dj[a];
+            int row = ia * nx + ja;
+            for (int b = 0; b < NE; b++) {
+                int pos = -1;
+                if (get_boundary_type(ia, ja, nx, ny) == 0) {
+                    // Offset of column (ib, jb) inside the 3x3 row block
+                    int di = ei + node_di[b] - ia, dj = ej + node_dj[b] - ja;
+                    pos = A->row_ptr[row] + (di + 1) * 3 + (dj + 1);
+                }
+                fa->elem_pos[(e*NE + a)*NE + b] = pos;
+            }
+        }
+    }
+    
+    // Optional geometry cache
+    fa->geo_quad = NULL;
+    fa->geo_grad = NULL;
+    if (cache_geometry) {
+        double hi = 1.0 / (ny - 1), hj = 1.0 / (nx - 1);
+        fa->geo_quad = (double*)malloc(fa->num_elements * NQ * 3 * sizeof(double));
+        fa->geo_grad = (double*)malloc(fa->num_elements * NQ * NE * NE * sizeof(double));
+        #pragma omp parallel for
+        for (int e = 0; e < fa->num_elements; e++) {
+            int ei = e / (nx - 1), ej = e % (nx - 1);
+            for (int q = 0; q < NQ; q++) {
+                element_geometry(ei, ej, hi, hj, q,
+                                 &fa->geo_quad[(e*NQ + q)*3],
+                                 &fa->geo_grad[(e*NQ + q)*NE*NE]);
+            }
+        }
+    }
+    
+    printf("Assembly pattern: %d non-zeros, %d elements%s\n", A->nnz,
+           fa->num_elements, cache_geometry ? " (geometry cached)" : "");
+    return fa;
+}
+
+void fem_assemble(FEMAssembly *fa, const FEMCoefficients *coef) {
+    FEMSystem *sys = fa->sys;
+    int nx = sys->nx, ny = sys->ny;
+    double hi = 1.0 / (ny - 1), hj = 1.0 / (nx - 1);
+    FEMCoefficients none = {NULL, NULL, NULL, NULL, NULL};
+    if (!coef) coef = &none;
+    
+    // Phase 1: element matrices and loads
+    #pragma omp parallel for
+    for (int e = 0; e < fa->num_elements; e++) {
+        int ei = e / (nx - 1), ej = e % (nx - 1);
+        int nodes[NE];
+        for (int a = 0; a < NE; a++) {
+            nodes[a] = (ei + node_di[a]) * nx + (ej + node_dj[a]);
+        }
+        
+        double *ke = &fa->elem_matrix[e*NE*NE];
+        double *fe = &fa->elem_load[e*NE];
+        for (int a = 0; a < NE*NE; a++) ke[a] = 0.0;
+        for (int a = 0; a < NE; a++) fe[a] = 0.0;
+        
+        for (int q = 0; q < NQ; q++) {
+            double quad_local[3], grad_local[NE*NE];
+            const double *quad, *grad;
+            if (fa->geo_quad) {
+                quad = &fa->geo_quad[(e*NQ + q)*3];
+                grad = &fa->geo_grad[(e*NQ + q)*NE*NE];
+            } else {
+                element_geometry(ei, ej, hi, hj, q, quad_local, grad_local);
+                quad = quad_local;
+                grad = grad_local;
+            }
+            
+            double k = eval_coefficient(coef->k_func, coef->k_nodal, coef->ctx,
+                                        nodes, q, quad[0], quad[1], 1.0);
+            double f = eval_coefficient(coef->f_func, coef->f_nodal, coef->ctx,
+                                        nodes, q, quad[0], quad[1], 0.0);
+            for (int a = 0; a < NE*NE; a++) {
+                ke[a] += k * grad[a];
+            }
+            for (int a = 0; a < NE; a++) {
+                fe[a] += f * quad[2] * shape(a, quad_xi[q], quad_eta[q]);
+            }
+        }
+    }
+    
+    // Phase 2: gather into rows (each row owned by one thread)
+    CSRMatrix *A = &sys->A;
+    #pragma omp parallel for
+    for (int node = 0; node < sys->n; node++) {
+        int i = node / nx, j = node % nx;
+        int boundary = get_boundary_type(i, j, nx, ny);
+        
+        if (boundary > 0) {
+            // Dirichlet row: T = 1 on top, 0 elsewhere
+            A->values[A->row_ptr[node]] = 1.0;
+            sys->b[node] = (boundary == 3) ? 1.0 : 0.0;
+            continue;
+        }
+        
+        for (int k = A->row_ptr[node]; k < A->row_ptr[node+1]; k++) {
+            A->values[k] = 0.0;
+        }
+        double load = 0.0;
+        
+        // Interior node: local index a in each of its 4 elements
+        for (int a = 0; a < NE; a++) {
+            int ei = i - node_di[a], ej = j - node_dj[a];
+            int e = ei * (nx - 1) + ej;
+            const double *ke = &fa->elem_matrix[(e*NE + a)*NE];
+            const int *pos = &fa->elem_pos[(e*NE + a)*NE];
+            for (int b = 0; b < NE; b++) {
+                A->values[pos[b]] += ke[b];
+            }
+            load += fa->elem_load[e*NE + a];
+        }
+        sys->b[node] = load;
+    }
+}
+
+void fem_assembly_free(FEMAssembly *fa) {
+    if (fa) {
+        free_fem_system(fa->sys);
+        free(fa->elem_pos);
+        free(fa->elem_matrix);
+        free(fa->elem_load);
+        free(fa->geo_quad);
+        free(fa->geo_grad);
+        free(fa);
+    }
+}
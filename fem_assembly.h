@@ -0,0 +1,49 @@
+// fem_assembly.h
+// Header file for variable-coefficient FEM assembly
+// Solves -div(k grad T) = f with bilinear elements and 2x2 Gauss quadrature
+
+#ifndef FEM_ASSEMBLY_H
+#define FEM_ASSEMBLY_H
+
+#include "fem_matrix.h"
+
+// Coefficient callback: value at point (x, y)
+typedef double (*CoefficientFn)(double x, double y, void *ctx);
+
+// Conductivity k(x,y) and source f(x,y), each given either as a callback
+// or as values sampled at the grid nodes (interpolated bilinearly)
+// Neither given: k = 1, f = 0
+typedef struct {
+    CoefficientFn k_func;   // Conductivity callback
+    const double *k_nodal;  // ...or conductivity at nodes
+    CoefficientFn f_func;   // Source callback
+    const double *f_nodal;  // ...or source at nodes
+    void *ctx;              // Passed to both callbacks
+} FEMCoefficients;
+
+// Assembly object: the CSR pattern and element-to-CSR map are built once,
+// fem_assemble() then refills values and b in place
+typedef struct {
+    FEMSystem *sys;         // System with 9-point pattern (Dirichlet rows: identity)
+    int num_elements;       // (nx-1)*(ny-1)
+    int *elem_pos;          // [e][a][b] CSR position of (node_a, node_b), -1 on Dirichlet rows
+    double *elem_matrix;    // [e][a][b] element stiffness from the last assembly
+    double *elem_load;      // [e][a] element load vector from the last assembly
+    
+    // Per-element geometric factors (NULL when caching is off)
+    double *geo_quad;       // [e][q] x, y, weight*detJ
+    double *geo_grad;       // [e][q][a][b] weight*detJ*grad(phi_a).grad(phi_b)
+} FEMAssembly;
+
+// Builds pattern and element map; cache_geometry = 1 also stores per-element
+// quadrature geometry so later assemblies only evaluate coefficients
+FEMAssembly* fem_assembly_create(int nx, int ny, int cache_geometry);
+
+// Numeric phase: evaluates coefficients and fills A.values and b
+// (elements and rows processed in parallel, no atomics)
+void fem_assemble(FEMAssembly *fa, const FEMCoefficients *coef);
+
+// Frees the assembly and its system
+void fem_assembly_free(FEMAssembly *fa);
+
+#endif // FEM_ASSEMBLY_H
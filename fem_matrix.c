@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "fem_matrix.h"
 
@@ -15,7 +16,7 @@ static int get_node_number(int i, int j, int nx) {
 
 // Checks if a node is on boundary
 // Returns: 0=interior, 1=bottom, 2=right, 3=top, 4=left
-static int get_boundary_type(int i, int j, int nx, int ny) {
+int get_boundary_type(int i, int j, int nx, int ny) {
     if (j == 0) return 1;      // Bottom: T=0
     if (i == ny-1) return 2;   // Right: T=0
     if (j == nx-1) return 3;   // Top: T=1
@@ -23,27 +24,78 @@ static int get_boundary_type(int i, int j, int nx, int ny) {
     return 0;                  // Interior
 }
 
-// Main function to create the FEM system
-FEMSystem* create_fem_system(int nx, int ny) {
-    printf("Creating FEM system: %dx%d grid (%d nodes)\n", nx, ny, nx*ny);
-    
-    // Allocate system structure
+FEMSystem* fem_system_alloc(int nx, int ny, int nnz) {
     FEMSystem *sys = (FEMSystem*)malloc(sizeof(FEMSystem));
+    memset(sys, 0, sizeof(FEMSystem));
     sys->n = nx * ny;
+    sys->nx = nx;
+    sys->ny = ny;
+    sys->A.n = sys->n;
     
-    // For a structured grid, each interior node connects to ~5 nodes (itself + 4 neighbors)
-    // Boundary nodes have fewer connections
-    // Estimate: roughly 5*n non-zeros (we'll count exactly later)
-    int max_nnz = 5 * sys->n;
+    // One region, arrays in the order they are streamed by the SpMV
+    size_t bytes = 2 * arena_size(sys->n, sizeof(double));
+    if (nnz >= 0) {
+        bytes += arena_size(sys->n + 1, sizeof(int)) + arena_size(nnz, sizeof(int)) +
+                 arena_size(nnz, sizeof(double));
+    }
+    if (arena_init(&sys->arena, bytes) != 0) {
+        free(sys);
+        return NULL;
+    }
+    if (nnz >= 0) {
+        sys->A.nnz = nnz;
+        sys->A.row_ptr = (int*)arena_alloc(&sys->arena, sys->n + 1, sizeof(int));
+        sys->A.col_idx = (int*)arena_alloc(&sys->arena, nnz, sizeof(int));
+        sys->A.values = (double*)arena_alloc(&sys->arena, nnz, sizeof(double));
+    }
+    sys->b = (double*)arena_alloc(&sys->arena, sys->n, sizeof(double));
+    sys->x = (double*)arena_alloc(&sys->arena, sys->n, sizeof(double));
+    return sys;
+}
+
+// Symbolic phase: allocates the system and builds the CSR pattern
+// Row layout: Dirichlet rows hold only the diagonal, interior rows the
+// 5-point stencil in the order West, South, Diagonal, North, East
+FEMSystem* fem_system_symbolic(int nx, int ny) {
+    // Entries: 1 per boundary row, 5 per interior row
+    // (interior nodes always have all four neighbours)
+    int interior = (nx > 2 && ny > 2) ? (nx - 2) * (ny - 2) : 0;
+    FEMSystem *sys = fem_system_alloc(nx, ny, nx * ny + 4 * interior);
     
-    // Temporary storage for building matrix (we'll compress later)
-    double *temp_values = (double*)calloc(max_nnz, sizeof(double));
-    int *temp_col = (int*)calloc(max_nnz, sizeof(int));
-    int *temp_row = (int*)calloc(sys->n + 1, sizeof(int));
+    // Row pointers
+    sys->A.row_ptr[0] = 0;
+    for (int i = 0; i < ny; i++) {
+        for (int j = 0; j < nx; j++) {
+            int node = get_node_number(i, j, nx);
+            int row_len = get_boundary_type(i, j, nx, ny) > 0 ? 1 : 5;
+            sys->A.row_ptr[node + 1] = sys->A.row_ptr[node] + row_len;
+        }
+    }
     
-    // Allocate solution vectors
-    sys->b = (double*)calloc(sys->n, sizeof(double));
-    sys->x = (double*)calloc(sys->n, sizeof(double));
+    // Column indices (exact sizes, no temporary arrays)
+    for (int i = 0; i < ny; i++) {
+        for (int j = 0; j < nx; j++) {
+            int node = get_node_number(i, j, nx);
+            int *cols = &sys->A.col_idx[sys->A.row_ptr[node]];
+            if (get_boundary_type(i, j, nx, ny) > 0) {
+                cols[0] = node;
+            } else {
+                cols[0] = get_node_number(i, j-1, nx);   // West
+                cols[1] = get_node_number(i-1, j, nx);   // South
+                cols[2] = node;                          // Diagonal
+                cols[3] = get_node_number(i+1, j, nx);   // North
+                cols[4] = get_node_number(i, j+1, nx);   // East
+            }
+        }
+    }
+    return sys;
+}
+
+// Numeric phase: fills A.values and b in place (parallel over rows)
+// k_nodal: conductivity at the nodes (NULL = 1); each stencil coupling
+// uses the average conductivity of the two nodes it connects
+void fem_system_numeric(FEMSystem *sys, const double *k_nodal) {
+    int nx = sys->nx, ny = sys->ny;
     
     // Grid spacing
     double hx = 1.0 / (nx - 1);  // x-direction spacing
@@ -55,113 +107,274 @@ FEMSystem* create_fem_system(int nx, int ny) {
     double kn = -(hy/hx) / 6.0;         // North-south neighbor
     double kw = -(hx/hy) / 6.0;         // East-west neighbor
     
+    #pragma omp parallel for
+    for (int node = 0; node < sys->n; node++) {
+        int i = node / nx, j = node % nx;
+        int boundary = get_boundary_type(i, j, nx, ny);
+        double *vals = &sys->A.values[sys->A.row_ptr[node]];
+        
+        if (boundary > 0) {
+            // Boundary node: apply Dirichlet condition
+            // Row equation becomes: T[node] = boundary_value
+            vals[0] = 1.0;
+            sys->b[node] = (boundary == 3) ? 1.0 : 0.0;  // Top boundary: T=1
+        } else if (k_nodal == NULL) {
+            // Constant conductivity: 5-point stencil
+            vals[0] = kw;
+            vals[1] = kn;
+            vals[2] = ke;
+            vals[3] = kn;
+            vals[4] = kw;
+            sys->b[node] = 0.0;  // Source term = 0 for Laplace
+        } else {
+            double k0 = k_nodal[node];
+            double k_w = 0.5 * (k0 + k_nodal[get_node_number(i, j-1, nx)]);
+            double k_s = 0.5 * (k0 + k_nodal[get_node_number(i-1, j, nx)]);
+            double k_n = 0.5 * (k0 + k_nodal[get_node_number(i+1, j, nx)]);
+            double k_e = 0.5 * (k0 + k_nodal[get_node_number(i, j+1, nx)]);
+            vals[0] = k_w * kw;
+            vals[1] = k_s * kn;
+            vals[3] = k_n * kn;
+            vals[4] = k_e * kw;
+            vals[2] = -(vals[0] + vals[1] + vals[3] + vals[4]);
+            sys->b[node] = 0.0;
+        }
+    }
+}
+
+// Main function to create the FEM system
+FEMSystem* create_fem_system(int nx, int ny) {
+    printf("Creating FEM system: %dx%d grid (%d nodes)\n", nx, ny, nx*ny);
+    
+    FEMSystem *sys = fem_system_symbolic(nx, ny);
+    fem_system_numeric(sys, NULL);
+    
+    printf("Matrix created: %d nodes, %d non-zeros\n", sys->n, sys->A.nnz);
+    return sys;
+}
+
+// Free all memory
+void free_fem_system(FEMSystem *sys) {
+    if (sys) {
+        arena_release(&sys->arena);
+        free(sys);
+    }
+}
+
+// Symmetric permutation: row perm[i] of the copy is row i of A with every
+// column c renamed to perm[c]; entries are insertion-sorted by column
+FEMSystem* fem_system_permute(const FEMSystem *sys, const int *perm) {
+    int n = sys->n;
+    const CSRMatrix *A = &sys->A;
+    FEMSystem *out = fem_system_alloc(sys->nx, sys->ny, A->nnz);
+    int *inv = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) inv[perm[i]] = i;
+    
+    out->A.row_ptr[0] = 0;
+    for (int r = 0; r < n; r++) {
+        int old = inv[r];
+        out->A.row_ptr[r + 1] = out->A.row_ptr[r] + (A->row_ptr[old + 1] - A->row_ptr[old]);
+    }
+    for (int r = 0; r < n; r++) {
+        int old = inv[r];
+        int *cols = &out->A.col_idx[out->A.row_ptr[r]];
+        double *vals = &out->A.values[out->A.row_ptr[r]];
+        int len = 0;
+        for (int j = A->row_ptr[old]; j < A->row_ptr[old + 1]; j++, len++) {
+            int c = perm[A->col_idx[j]];
+            double v = A->values[j];
+            int k = len;
+            while (k > 0 && cols[k - 1] > c) {
+                cols[k] = cols[k - 1];
+                vals[k] = vals[k - 1];
+                k--;
+            }
+            cols[k] = c;
+            vals[k] = v;
+        }
+        out->b[r] = sys->b[old];
+        out->x[r] = sys->x[old];
+    }
+    free(inv);
+    return out;
+}
+
+// Copy with the Dirichlet columns moved to the right-hand side: an entry
+// a_ij of a free row with j a Dirichlet node becomes b_i -= a_ij * x_j,
+// x_j = b_j / a_jj. The Dirichlet rows stay, so numbering and solution are
+// unchanged, and a symmetric stencil gives a symmetric matrix
+FEMSystem* fem_system_eliminate_dirichlet(const FEMSystem *sys) {
+    int n = sys->n;
+    CSRMatrix *A = (CSRMatrix*)&sys->A;
+    
+    int nnz = 0;
+    for (int i = 0; i < n; i++) {
+        if (is_dirichlet_row(A, i)) {
+            nnz++;
+            continue;
+        }
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            int c = A->col_idx[j];
+            if (c == i || !is_dirichlet_row(A, c)) nnz++;
+        }
+    }
+    
+    FEMSystem *out = fem_system_alloc(sys->nx, sys->ny, nnz);
+    int k = 0;
+    out->A.row_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        double bi = sys->b[i];
+        int dirichlet = is_dirichlet_row(A, i);
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            int c = A->col_idx[j];
+            if (!dirichlet && c != i && is_dirichlet_row(A, c)) {
+                bi -= A->values[j] * sys->b[c] / A->values[A->row_ptr[c]];
+                continue;
+            }
+            out->A.col_idx[k] = c;
+            out->A.values[k] = A->values[j];
+            k++;
+        }
+        out->A.row_ptr[i + 1] = k;
+        out->b[i] = bi;
+        out->x[i] = sys->x[i];
+    }
+    return out;
+}
+
+// Mass matrix for bilinear rectangular elements
+// Element mass: (hx*hy/36) * [4 2 1 2; 2 4 2 1; 1 2 4 2; 2 1 2 4], so a node
+// pair gets 4/36 (same node), 2/36 (edge neighbours) or 1/36 (diagonal
+// neighbours) times hx*hy from every element containing both nodes
+CSRMatrix create_mass_matrix(int nx, int ny, int lumped) {
+    CSRMatrix M;
+    int n = nx * ny;
+    double hx = 1.0 / (nx - 1);
+    double hy = 1.0 / (ny - 1);
+    double area = hx * hy;
+    
+    M.n = n;
+    M.row_ptr = (int*)malloc((n + 1) * sizeof(int));
+    M.values = (double*)malloc((lumped ? 1 : 9) * n * sizeof(double));
+    M.col_idx = (int*)malloc((lumped ? 1 : 9) * n * sizeof(int));
+    
     int nnz_count = 0;
-    temp_row[0] = 0;
+    M.row_ptr[0] = 0;
     
-    // Loop over all nodes to build matrix
     for (int i = 0; i < ny; i++) {
         for (int j = 0; j < nx; j++) {
             int node = get_node_number(i, j, nx);
-            int boundary = get_boundary_type(i, j, nx, ny);
+            double row_sum = 0.0;
             
-            if (boundary > 0) {
-                // Boundary node: apply Dirichlet condition
-                // Row equation becomes: T[node] = boundary_value
-                // Matrix: 1.0 on diagonal, 0 elsewhere
-                temp_values[nnz_count] = 1.0;
-                temp_col[nnz_count] = node;
-                nnz_count++;
-                
-                // Right-hand side
-                if (boundary == 3) {
-                    sys->b[node] = 1.0;  // Top boundary: T=1
-                } else {
-                    sys->b[node] = 0.0;  // Other boundaries: T=0
-                }
-            } else {
-                // Interior node: assemble stiffness matrix
-                // 5-point stencil for 2D Laplace operator
-                
-                // West neighbor (j-1)
-                if (j > 0) {
-                    int neighbor = get_node_number(i, j-1, nx);
-                    temp_values[nnz_count] = kw;
-                    temp_col[nnz_count] = neighbor;
-                    nnz_count++;
-                }
-                
-                // South neighbor (i-1)
-                if (i > 0) {
-                    int neighbor = get_node_number(i-1, j, nx);
-                    temp_values[nnz_count] = kn;
-                    temp_col[nnz_count] = neighbor;
-                    nnz_count++;
-                }
-                
-                // Diagonal (self)
-                temp_values[nnz_count] = ke;
-                temp_col[nnz_count] = node;
-                nnz_count++;
-                
-                // North neighbor (i+1)
-                if (i < ny-1) {
-                    int neighbor = get_node_number(i+1, j, nx);
-                    temp_values[nnz_count] = kn;
-                    temp_col[nnz_count] = neighbor;
-                    nnz_count++;
+            for (int di = -1; di <= 1; di++) {
+                for (int dj = -1; dj <= 1; dj++) {
+                    int ni = i + di, nj = j + dj;
+                    if (ni < 0 || ni >= ny || nj < 0 || nj >= nx) continue;
+                    
+                    // Count elements (ei, ej) containing both nodes
+                    int shared = 0;
+                    for (int ei = (di > 0 ? i : i - 1); ei <= (di < 0 ? i - 1 : i); ei++) {
+                        for (int ej = (dj > 0 ? j : j - 1); ej <= (dj < 0 ? j - 1 : j); ej++) {
+                            if (ei >= 0 && ei < ny - 1 && ej >= 0 && ej < nx - 1) shared++;
+                        }
+                    }
+                    if (shared == 0) continue;
+                    
+                    int dist = (di != 0) + (dj != 0);
+                    double weight = (dist == 0 ? 4.0 : (dist == 1 ? 2.0 : 1.0)) / 36.0;
+                    double value = shared * weight * area;
+                    row_sum += value;
+                    
+                    if (!lumped) {
+                        M.values[nnz_count] = value;
+                        M.col_idx[nnz_count] = get_node_number(ni, nj, nx);
+                        nnz_count++;
+                    }
                 }
-                
-                // East neighbor (j+1)
-                if (j < nx-1) {
-                    int neighbor = get_node_number(i, j+1, nx);
-                    temp_values[nnz_count] = kw;
-                    temp_col[nnz_count] = neighbor;
-                    nnz_count++;
-                }
-                
-                // Right-hand side (source term = 0 for Laplace)
-                sys->b[node] = 0.0;
             }
             
-            temp_row[node + 1] = nnz_count;
+            if (lumped) {
+                M.values[nnz_count] = row_sum;
+                M.col_idx[nnz_count] = node;
+                nnz_count++;
+            }
+            M.row_ptr[node + 1] = nnz_count;
         }
     }
     
-    // Now copy to final CSR structure with exact size
-    sys->A.n = sys->n;
-    sys->A.nnz = nnz_count;
-    sys->A.values = (double*)malloc(nnz_count * sizeof(double));
-    sys->A.col_idx = (int*)malloc(nnz_count * sizeof(int));
-    sys->A.row_ptr = (int*)malloc((sys->n + 1) * sizeof(int));
+    M.nnz = nnz_count;
+    return M;
+}
+
+// Sparse matrix sum C = a*A + b*B
+// Uses a dense position marker per row, so column order need not be sorted
+CSRMatrix csr_add(double a, CSRMatrix *A, double b, CSRMatrix *B) {
+    CSRMatrix C;
+    int n = A->n;
+    int *pos = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) pos[i] = -1;
     
-    for (int i = 0; i < nnz_count; i++) {
-        sys->A.values[i] = temp_values[i];
-        sys->A.col_idx[i] = temp_col[i];
-    }
+    C.n = n;
+    C.row_ptr = (int*)malloc((n + 1) * sizeof(int));
+    C.values = (double*)malloc((A->nnz + B->nnz) * sizeof(double));
+    C.col_idx = (int*)malloc((A->nnz + B->nnz) * sizeof(int));
     
-    for (int i = 0; i <= sys->n; i++) {
-        sys->A.row_ptr[i] = temp_row[i];
+    int nnz_count = 0;
+    C.row_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        int row_start = nnz_count;
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            int col = A->col_idx[k];
+            if (pos[col] < row_start) {
+                pos[col] = nnz_count;
+                C.col_idx[nnz_count] = col;
+                C.values[nnz_count] = 0.0;
+                nnz_count++;
+            }
+            C.values[pos[col]] += a * A->values[k];
+        }
+        for (int k = B->row_ptr[i]; k < B->row_ptr[i+1]; k++) {
+            int col = B->col_idx[k];
+            if (pos[col] < row_start) {
+                pos[col] = nnz_count;
+                C.col_idx[nnz_count] = col;
+                C.values[nnz_count] = 0.0;
+                nnz_count++;
+            }
+            C.values[pos[col]] += b * B->values[k];
+        }
+        C.row_ptr[i + 1] = nnz_count;
     }
+    C.nnz = nnz_count;
     
-    // Free temporary storage
-    free(temp_values);
-    free(temp_col);
-    free(temp_row);
-    
-    printf("Matrix created: %d nodes, %d non-zeros\n", sys->n, sys->A.nnz);
-    return sys;
+    free(pos);
+    return C;
 }
 
-// Free all memory
-void free_fem_system(FEMSystem *sys) {
-    if (sys) {
-        free(sys->A.values);
-        free(sys->A.col_idx);
-        free(sys->A.row_ptr);
-        free(sys->b);
-        free(sys->x);
-        free(sys);
+double csr_norm_inf(CSRMatrix *A) {
+    double norm = 0.0;
+    for (int i = 0; i < A->n; i++) {
+        double row_sum = 0.0;
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            row_sum += fabs(A->values[k]);
+        }
+        if (row_sum > norm) norm = row_sum;
     }
+    return norm;
+}
+
+void free_csr_matrix(CSRMatrix *A) {
+    free(A->values);
+    free(A->col_idx);
+    free(A->row_ptr);
+    A->values = NULL;
+    A->col_idx = NULL;
+    A->row_ptr = NULL;
+}
+
+int is_dirichlet_row(CSRMatrix *A, int i) {
+    int start = A->row_ptr[i];
+    return A->row_ptr[i+1] - start == 1 && A->col_idx[start] == i;
 }
 
 // Print system information
@@ -180,4 +393,53 @@ void matvec_csr(CSRMatrix *A, double *x, double *y) {
             y[i] += A->values[j] * x[A->col_idx[j]];
         }
     }
+}
+
+// Fused residual for CSR format: r = b - A*x, returns ||r||^2
+// Saves the separate pass (and extra vector) of matvec followed by axpby
+double residual_csr(CSRMatrix *A, double *x, double *b, double *r) {
+    double norm2 = 0.0;
+    for (int i = 0; i < A->n; i++) {
+        double sum = b[i];
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            sum -= A->values[j] * x[A->col_idx[j]];
+        }
+        r[i] = sum;
+        norm2 += sum * sum;
+    }
+    return norm2;
+}
+
+// Fused SpMV + dot: y = A*x on rows lo..hi-1, returns w.y over the rows
+// The dot uses each row's result while it is still in a register, instead
+// of re-reading y in a separate pass
+double matvec_csr_dot(CSRMatrix *A, const double *x, double *y, const double *w,
+                      int lo, int hi) {
+    double dot = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            sum += A->values[j] * x[A->col_idx[j]];
+        }
+        y[i] = sum;
+        dot += w[i] * sum;
+    }
+    return dot;
+}
+
+// Fused SpMV + two dots: y = A*x on rows lo..hi-1 with w.y and y.y
+void matvec_csr_dot2(CSRMatrix *A, const double *x, double *y, const double *w,
+                     int lo, int hi, double *wy, double *yy) {
+    double a = 0.0, c = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            sum += A->values[j] * x[A->col_idx[j]];
+        }
+        y[i] = sum;
+        a += w[i] * sum;
+        c += sum * sum;
+    }
+    *wy = a;
+    *yy = c;
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #ifndef FEM_MATRIX_H
 #define FEM_MATRIX_H
 
+#include "arena.h"
+
 // Structure to hold our sparse matrix in CSR format
 // CSR = Compressed Sparse Row (efficient for sparse matrices)
 typedef struct {
@@ -21,19 +23,75 @@ typedef struct {
     double *b;          // Right-hand side vector
     double *x;          // Solution vector (initialized to zeros)
     int n;              // Problem size
+    int nx, ny;         // Grid dimensions (node = i*nx + j, 0 <= i < ny, 0 <= j < nx)
+    Arena arena;        // Region holding row_ptr, col_idx, values, b, x (in that order)
 } FEMSystem;
 
 // Function declarations
 // Creates the FEM system for given grid size (nx x ny)
+// (symbolic + numeric phase below)
 FEMSystem* create_fem_system(int nx, int ny);
 
-// Frees all allocated memory
+// Allocates a system whose row_ptr, col_idx, values, b and x share one
+// aligned arena, all zeroed (nnz < 0: no CSR arrays, for matrix-free operators)
+FEMSystem* fem_system_alloc(int nx, int ny, int nnz);
+
+// Symbolic phase: allocates the system and the CSR pattern (values zeroed)
+FEMSystem* fem_system_symbolic(int nx, int ny);
+
+// Numeric phase: refills A.values and b in place, reusing the pattern
+// k_nodal: conductivity at the nodes (NULL = constant 1)
+void fem_system_numeric(FEMSystem *sys, const double *k_nodal);
+
+// Boundary side of grid node (i,j): 0=interior, 1=bottom, 2=right, 3=top, 4=left
+// Dirichlet value is 1 on the top (3), 0 elsewhere
+int get_boundary_type(int i, int j, int nx, int ny);
+
+// Frees a system from fem_system_alloc (one call for all arrays)
 void free_fem_system(FEMSystem *sys);
 
+// Symmetrically permuted copy P A P^T, P b, P x: old node i becomes perm[i]
+// (columns sorted within each row; the grid numbering no longer applies)
+FEMSystem* fem_system_permute(const FEMSystem *sys, const int *perm);
+
+// Copy with Dirichlet unknowns eliminated from the other rows (their
+// columns folded into b); the identity rows remain. Symmetric positive
+// definite for the Laplace stencil, so CG applies (pcg.h)
+FEMSystem* fem_system_eliminate_dirichlet(const FEMSystem *sys);
+
+// Mass matrix for bilinear elements on the nx x ny grid (all nodes)
+// lumped = 1: diagonal row-sum lumped mass, lumped = 0: consistent 9-point mass
+CSRMatrix create_mass_matrix(int nx, int ny, int lumped);
+
+// Sparse sum C = a*A + b*B (pattern is the union of both patterns)
+CSRMatrix csr_add(double a, CSRMatrix *A, double b, CSRMatrix *B);
+
+// Infinity norm (maximum absolute row sum)
+double csr_norm_inf(CSRMatrix *A);
+
+// Frees the arrays of a CSR matrix (not the struct itself)
+void free_csr_matrix(CSRMatrix *A);
+
+// 1 if row i is a Dirichlet row (only a diagonal entry)
+int is_dirichlet_row(CSRMatrix *A, int i);
+
 // Prints system info (for debugging)
 void print_system_info(FEMSystem *sys);
 
 // Matrix-vector multiplication: y = A*x
 void matvec_csr(CSRMatrix *A, double *x, double *y);
 
+// Fused residual: r = b - A*x in one pass over A
+// Returns ||r||^2 (accumulated in the same pass)
+double residual_csr(CSRMatrix *A, double *x, double *b, double *r);
+
+// Fused SpMV with reduction epilogue: y = A*x on rows lo..hi-1 (0, A->n for
+// all), returns w.y over those rows (e.g. r0.v after v = A*p)
+double matvec_csr_dot(CSRMatrix *A, const double *x, double *y, const double *w,
+                      int lo, int hi);
+
+// Same with two epilogues: *wy = w.y and *yy = y.y (e.g. t.s, t.t after t = A*s)
+void matvec_csr_dot2(CSRMatrix *A, const double *x, double *y, const double *w,
+                     int lo, int hi, double *wy, double *yy);
+
 #endif // FEM_MATRIX_H
\ No newline at end of file
@@ -0,0 +1,112 @@
+// heat_equation.c
+// Transient heat conduction with implicit theta-method time stepping
+// The step operator, RHS operator and solver workspace are built once;
+// every step only forms the RHS and solves from a warm initial guess.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heat_equation.h"
+#include "nested_iteration.h"
+
+// Replace Dirichlet rows of C by identity rows (keeping the pattern)
+static void set_identity_rows(CSRMatrix *C, CSRMatrix *K, double diag) {
+    for (int i = 0; i < C->n; i++) {
+        if (!is_dirichlet_row(K, i)) continue;
+        for (int k = C->row_ptr[i]; k < C->row_ptr[i+1]; k++) {
+            C->values[k] = (C->col_idx[k] == i) ? diag : 0.0;
+        }
+    }
+}
+
+HeatSolver* heat_solver_create(int nx, int ny, double dt, double theta, int lumped,
+                               SolverFn solver, const SolverOptions *opts) {
+    HeatSolver *hs = (HeatSolver*)malloc(sizeof(HeatSolver));
+    hs->steady = create_fem_system(nx, ny);
+    hs->dt = dt;
+    hs->theta = theta;
+    hs->extrapolate = 1;
+    hs->steps_taken = 0;
+    hs->solver = solver;
+    
+    int n = hs->steady->n;
+    CSRMatrix *K = &hs->steady->A;
+    hs->M = create_mass_matrix(nx, ny, lumped);
+    
+    // Step operator and RHS operator; Dirichlet rows keep T = boundary value
+    hs->step.A = csr_add(1.0, &hs->M, theta * dt, K);
+    set_identity_rows(&hs->step.A, K, 1.0);
+    hs->rhs_op = csr_add(1.0, &hs->M, -(1.0 - theta) * dt, K);
+    set_identity_rows(&hs->rhs_op, K, 0.0);
+    
+    hs->step.n = n;
+    hs->step.nx = nx;
+    hs->step.ny = ny;
+    arena_init(&hs->step.arena, 2 * arena_size(n, sizeof(double)));   // b and x only
+    hs->step.b = (double*)arena_alloc(&hs->step.arena, n, sizeof(double));
+    hs->step.x = (double*)arena_alloc(&hs->step.arena, n, sizeof(double));
+    hs->u_old = (double*)calloc(n, sizeof(double));
+    hs->u_older = (double*)calloc(n, sizeof(double));
+    
+    // Initial condition: cold plate, boundary values imposed
+    apply_dirichlet_values(hs->steady, hs->u_old);
+    memcpy(hs->u_older, hs->u_old, n * sizeof(double));
+    
+    // Work vectors live as long as the driver (NULL if out of memory: each
+    // step then allocates its own, and reports -1 if that fails too)
+    hs->opts = *opts;
+    hs->opts.workspace = solver_workspace_create(n);
+    
+    printf("Heat solver: dt = %.2e, theta = %.2f, %s mass, operator nnz = %d\n",
+           dt, theta, lumped ? "lumped" : "consistent", hs->step.A.nnz);
+    return hs;
+}
+
+int heat_solver_step(HeatSolver *hs, SolverStats *stats, double *step_time) {
+    int n = hs->step.n;
+    double start = wall_time();
+    
+    // b = (M - (1-theta)*dt*K) u^n, with boundary values on Dirichlet rows
+    matvec_csr(&hs->rhs_op, hs->u_old, hs->step.b);
+    for (int i = 0; i < n; i++) {
+        if (is_dirichlet_row(&hs->steady->A, i)) {
+            hs->step.b[i] = hs->steady->b[i];
+        }
+    }
+    
+    // Initial guess: linear extrapolation in time (or the previous step)
+    if (hs->extrapolate && hs->steps_taken > 0) {
+        for (int i = 0; i < n; i++) {
+            hs->step.x[i] = 2.0 * hs->u_old[i] - hs->u_older[i];
+        }
+    } else {
+        memcpy(hs->step.x, hs->u_old, n * sizeof(double));
+    }
+    
+    double solve_time;
+    int iter = hs->solver(&hs->step, &hs->opts, stats, &solve_time);
+    
+    // Rotate history: u^{n-1} <- u^n <- u^{n+1}
+    double *tmp = hs->u_older;
+    hs->u_older = hs->u_old;
+    hs->u_old = tmp;
+    memcpy(hs->u_old, hs->step.x, n * sizeof(double));
+    hs->steps_taken++;
+    
+    *step_time = wall_time() - start;
+    return iter;
+}
+
+void heat_solver_free(HeatSolver *hs) {
+    if (hs) {
+        solver_workspace_free(hs->opts.workspace);
+        free_csr_matrix(&hs->M);
+        free_csr_matrix(&hs->rhs_op);
+        free_csr_matrix(&hs->step.A);
+        arena_release(&hs->step.arena);
+        free(hs->u_old);
+        free(hs->u_older);
+        free_fem_system(hs->steady);
+        free(hs);
+    }
+}
@@ -0,0 +1,40 @@
+// heat_equation.h
+// Header file for the implicit time-stepping heat equation driver
+// Solves (M + theta*dt*K) u^{n+1} = (M - (1-theta)*dt*K) u^n each step
+
+#ifndef HEAT_EQUATION_H
+#define HEAT_EQUATION_H
+
+#include "fem_matrix.h"
+#include "bicgstab.h"
+
+// State kept alive between time steps: operator, right-hand side operator,
+// solver workspace and the last two solutions (for the initial guess)
+typedef struct {
+    FEMSystem *steady;      // Stiffness K and Dirichlet data (create_fem_system)
+    CSRMatrix M;            // Mass matrix
+    CSRMatrix rhs_op;       // M - (1-theta)*dt*K (zero rows at Dirichlet nodes)
+    FEMSystem step;         // A = M + theta*dt*K, b = step RHS, x = new solution
+    double *u_old;          // u^n
+    double *u_older;        // u^{n-1}
+    double dt;              // Time step
+    double theta;           // 1.0 = implicit Euler, 0.5 = Crank-Nicolson
+    int extrapolate;        // 1 = initial guess 2u^n - u^{n-1}, 0 = u^n
+    int steps_taken;
+    SolverFn solver;
+    SolverOptions opts;     // Solver options (workspace points to our own)
+} HeatSolver;
+
+// Builds the time-stepping operators on an nx x ny grid
+// Initial condition: u = 0 inside, boundary values on Dirichlet nodes
+HeatSolver* heat_solver_create(int nx, int ny, double dt, double theta, int lumped,
+                               SolverFn solver, const SolverOptions *opts);
+
+// Advances one time step; step_time gets RHS assembly + solve wall time
+// Returns solver iterations, or -1 if the solve failed
+int heat_solver_step(HeatSolver *hs, SolverStats *stats, double *step_time);
+
+// Frees all memory
+void heat_solver_free(HeatSolver *hs);
+
+#endif // HEAT_EQUATION_H
@@ -0,0 +1,45 @@
+// highorder.h
+// Header file for higher-order (Q1/Q2/Q3) Lagrange elements
+// The stiffness operator is applied matrix-free by sum factorization
+
+#ifndef HIGHORDER_H
+#define HIGHORDER_H
+
+#include "fem_matrix.h"
+#include "linear_operator.h"
+
+#define HO_MAX_DEGREE 3
+#define HO_NP (HO_MAX_DEGREE + 1)   // Max nodes per direction per element
+#define HO_NQ (HO_MAX_DEGREE + 1)   // Max Gauss points per direction
+
+// Matrix-free stiffness operator on ex x ey elements of degree p
+// Nodes follow the create_fem_system numbering: node = i*nx + j with
+// i along x (ny = ex*p + 1 nodes) and j along y (nx = ey*p + 1 nodes)
+typedef struct {
+    LinearOperator op;          // Must be first: passed to solvers as LinearOperator*
+    int degree;
+    int ex, ey;                 // Elements along x (i) and y (j)
+    int nx, ny;                 // Nodes along j and i
+    int nq;                     // Gauss points per direction (degree + 1)
+    double node_ref[HO_NP];     // Gauss-Lobatto-Legendre nodes on [-1, 1]
+    double B[HO_NQ][HO_NP];     // Basis values at Gauss points
+    double D[HO_NQ][HO_NP];     // Basis derivatives at Gauss points
+    double cx[HO_NQ][HO_NQ];    // Quadrature weight * metric for d/dx terms
+    double cy[HO_NQ][HO_NQ];    // Quadrature weight * metric for d/dy terms
+    int *color_elems[4];        // Elements by colour (no shared nodes within a colour)
+    int color_count[4];
+    int *dirichlet;             // Dirichlet nodes (identity rows)
+    int num_dirichlet;
+} HighOrderOperator;
+
+// Creates the high-order system (b = boundary values, x = 0) and its
+// operator; sys->A is empty (nnz = 0), use the operator for A*x
+FEMSystem* create_highorder_system(int ex, int ey, int degree, HighOrderOperator **op_out);
+
+// Node coordinates (x along i, y along j)
+void highorder_node_coordinates(HighOrderOperator *ho, double *xc, double *yc);
+
+// Frees system and operator
+void free_highorder_system(FEMSystem *sys, HighOrderOperator *ho);
+
+#endif // HIGHORDER_H
@@ -0,0 +1,496 @@
+// inspector.c
+// Matrix profiling, candidate SpMV formats and their timed selection
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <omp.h>
+#include "inspector.h"
+#include "bicgstab.h"
+#include "csr5.h"
+
+// Rows per DIA block: the partial sums of one block stay in L1
+#define DIA_BLOCK 256
+
+// Open-addressing table of distinct values (bit patterns) and their indices
+#define VALUE_SLOTS 1024
+
+typedef struct {
+    uint64_t keys[VALUE_SLOTS];
+    short index[VALUE_SLOTS];           // -1 = empty slot
+    double values[INSPECT_MAX_VALUES];
+    int count;
+} ValueTable;
+
+// Row kernel over rows lo..hi-1 with *wy = w.y and *yy = y.y
+typedef void (*RowsFn)(LinearOperator *op, const double *x, double *y, const double *w,
+                       int lo, int hi, double *wy, double *yy);
+
+// CSR with an SpmvPlan (plain / prefetch / gather kernel, or fp32 values)
+typedef struct {
+    LinearOperator op;      // Must be first
+    CSRMatrix *A;
+    SpmvPlan plan;
+    char name[32];
+} CsrOp;
+
+// CSR with each value replaced by its index in a table of distinct values
+typedef struct {
+    LinearOperator op;      // Must be first
+    CSRMatrix *A;
+    unsigned char *index;   // nnz
+    double table[INSPECT_MAX_VALUES];
+    Arena arena;
+} ViOp;
+
+// Diagonal storage: values[k*n + i] = A(i, i + offsets[k]) (0 where absent)
+typedef struct {
+    LinearOperator op;      // Must be first
+    int num_diags;
+    int offsets[INSPECT_MAX_DIAGONALS];
+    double *values;
+    Arena arena;
+} DiaOp;
+
+typedef struct {
+    LinearOperator *op;
+    void (*free_op)(LinearOperator *op);
+} Candidate;
+
+struct SpmvHandle {
+    Candidate chosen;
+    char names[INSPECT_CANDIDATES][32];     // Candidate names (the report points here)
+    InspectReport report;
+};
+
+// ============================================================================
+// Shared driver
+// ============================================================================
+
+// First row whose entries start at or after entry e
+static int row_at_entry(const CSRMatrix *A, long e) {
+    int lo = 0, hi = A->n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (A->row_ptr[mid] < e) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Whole-matrix SpMV through a row kernel; in parallel each thread takes an
+// equal share of the entries (A given) or of the rows (A = NULL)
+static void run_rows(RowsFn rows, LinearOperator *op, const CSRMatrix *A, const double *x,
+                     double *y, const double *w, double *dots, int parallel) {
+    const double *wv = w ? w : x;   // The kernels always form w.y
+    int n = op->n;
+    double wy = 0.0, yy = 0.0;
+    if (parallel) {
+        #pragma omp parallel reduction(+:wy, yy)
+        {
+            int nt = omp_get_num_threads(), id = omp_get_thread_num();
+            int lo, hi;
+            if (A) {
+                lo = row_at_entry(A, (long)A->nnz * id / nt);
+                hi = id == nt - 1 ? n : row_at_entry(A, (long)A->nnz * (id + 1) / nt);
+            } else {
+                lo = (int)((long)n * id / nt);
+                hi = (int)((long)n * (id + 1) / nt);
+            }
+            double a = 0.0, c = 0.0;
+            if (lo < hi) rows(op, x, y, wv, lo, hi, &a, &c);
+            wy += a;
+            yy += c;
+        }
+    } else {
+        rows(op, x, y, wv, 0, n, &wy, &yy);
+    }
+    if (dots) {
+        dots[0] = wy;
+        dots[1] = yy;
+    }
+}
+
+// ============================================================================
+// CSR (plan kernel)
+// ============================================================================
+
+static void csr_rows(LinearOperator *op, const double *x, double *y, const double *w,
+                     int lo, int hi, double *wy, double *yy) {
+    CsrOp *c = (CsrOp*)op;
+    spmv_csr_dot2(&c->plan, c->A, x, y, w, lo, hi, wy, yy);
+}
+
+static void csr_apply(LinearOperator *op, const double *x, double *y, int parallel) {
+    run_rows(csr_rows, op, ((CsrOp*)op)->A, x, y, NULL, NULL, parallel);
+}
+
+static void csr_apply_dots(LinearOperator *op, const double *x, double *y, const double *w,
+                           double *dots, int parallel) {
+    run_rows(csr_rows, op, ((CsrOp*)op)->A, x, y, w, dots, parallel);
+}
+
+static void csr_free(LinearOperator *op) {
+    spmv_plan_free(&((CsrOp*)op)->plan);
+    free(op);
+}
+
+// precision VALUES_FP64: the SPMV_AUTO kernel; otherwise plain rows on
+// narrowed values (NULL if they fail the check against tol)
+static LinearOperator* csr_create(CSRMatrix *A, ValuePrecision precision, double tol) {
+    CsrOp *c = (CsrOp*)calloc(1, sizeof(CsrOp));
+    c->A = A;
+    if (precision == VALUES_FP64) {
+        spmv_plan_init(&c->plan, A, SPMV_AUTO, 0);
+        if (c->plan.kernel == SPMV_PLAIN) {
+            snprintf(c->name, sizeof(c->name), "csr");
+        } else {
+            snprintf(c->name, sizeof(c->name), "csr-%s", spmv_kernel_name(c->plan.kernel));
+        }
+    } else {
+        spmv_plan_init(&c->plan, A, SPMV_PLAIN, 0);
+        if (spmv_plan_set_values(&c->plan, A, precision, tol) != precision) {
+            free(c);
+            return NULL;
+        }
+        snprintf(c->name, sizeof(c->name), "csr-%s", lowprec_name(precision));
+    }
+    c->op.name = c->name;
+    c->op.n = A->n;
+    c->op.apply = csr_apply;
+    c->op.apply_dots = csr_apply_dots;
+    return &c->op;
+}
+
+// ============================================================================
+// CSR with value indices
+// ============================================================================
+
+static void value_table_init(ValueTable *t) {
+    for (int s = 0; s < VALUE_SLOTS; s++) t->index[s] = -1;
+    t->count = 0;
+}
+
+// Index of v in the table, inserted if new (-1 once the table is full)
+static int value_index(ValueTable *t, double v) {
+    uint64_t key;
+    memcpy(&key, &v, sizeof(key));
+    int s = (int)((key * 0x9E3779B97F4A7C15ULL) >> 54);     // 10 bits = VALUE_SLOTS
+    while (t->index[s] >= 0) {
+        if (t->keys[s] == key) return t->index[s];
+        s = (s + 1) & (VALUE_SLOTS - 1);
+    }
+    if (t->count == INSPECT_MAX_VALUES) return -1;
+    t->keys[s] = key;
+    t->index[s] = (short)t->count;
+    t->values[t->count] = v;
+    return t->count++;
+}
+
+static void vi_rows(LinearOperator *op, const double *x, double *y, const double *w,
+                    int lo, int hi, double *wy, double *yy) {
+    ViOp *m = (ViOp*)op;
+    const int *col = m->A->col_idx;
+    const unsigned char *index = m->index;
+    double a = 0.0, c = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum = 0.0;
+        for (int j = m->A->row_ptr[i]; j < m->A->row_ptr[i+1]; j++) {
+            sum += m->table[index[j]] * x[col[j]];
+        }
+        y[i] = sum;
+        a += w[i] * sum;
+        c += sum * sum;
+    }
+    *wy = a;
+    *yy = c;
+}
+
+static void vi_apply(LinearOperator *op, const double *x, double *y, int parallel) {
+    run_rows(vi_rows, op, ((ViOp*)op)->A, x, y, NULL, NULL, parallel);
+}
+
+static void vi_apply_dots(LinearOperator *op, const double *x, double *y, const double *w,
+                          double *dots, int parallel) {
+    run_rows(vi_rows, op, ((ViOp*)op)->A, x, y, w, dots, parallel);
+}
+
+static void vi_free(LinearOperator *op) {
+    arena_release(&((ViOp*)op)->arena);
+    free(op);
+}
+
+// values: the distinct values of A found by the profile (all of them)
+static LinearOperator* vi_create(CSRMatrix *A, ValueTable *values) {
+    ViOp *m = (ViOp*)calloc(1, sizeof(ViOp));
+    if (arena_init(&m->arena, arena_size(A->nnz, 1)) != 0) {
+        free(m);
+        return NULL;
+    }
+    m->index = (unsigned char*)arena_alloc(&m->arena, A->nnz, 1);
+    for (int j = 0; j < A->nnz; j++) m->index[j] = (unsigned char)value_index(values, A->values[j]);
+    memcpy(m->table, values->values, values->count * sizeof(double));
+    m->A = A;
+    m->op.name = "csr-vi";
+    m->op.n = A->n;
+    m->op.apply = vi_apply;
+    m->op.apply_dots = vi_apply_dots;
+    return &m->op;
+}
+
+// ============================================================================
+// DIA
+// ============================================================================
+
+// Per block, each diagonal adds to the block's partial sums over the rows
+// where its column exists: contiguous loads of the values and of x. The
+// diagonals go in increasing offset, so the sum order (and last bit) can
+// differ from a CSR row stored in another order
+static void dia_rows(LinearOperator *op, const double *x, double *y, const double *w,
+                     int lo, int hi, double *wy, double *yy) {
+    DiaOp *m = (DiaOp*)op;
+    int n = op->n;
+    double sum[DIA_BLOCK];
+    double a = 0.0, c = 0.0;
+    for (int i0 = lo; i0 < hi; i0 += DIA_BLOCK) {
+        int i1 = i0 + DIA_BLOCK < hi ? i0 + DIA_BLOCK : hi;
+        for (int i = 0; i < i1 - i0; i++) sum[i] = 0.0;
+        for (int k = 0; k < m->num_diags; k++) {
+            int off = m->offsets[k];
+            const double *v = m->values + (size_t)k * n;
+            int b = i0 > -off ? i0 : -off;
+            int e = i1 < n - off ? i1 : n - off;
+            for (int i = b; i < e; i++) sum[i - i0] += v[i] * x[i + off];
+        }
+        for (int i = i0; i < i1; i++) {
+            double s = sum[i - i0];
+            y[i] = s;
+            a += w[i] * s;
+            c += s * s;
+        }
+    }
+    *wy = a;
+    *yy = c;
+}
+
+static void dia_apply(LinearOperator *op, const double *x, double *y, int parallel) {
+    run_rows(dia_rows, op, NULL, x, y, NULL, NULL, parallel);
+}
+
+static void dia_apply_dots(LinearOperator *op, const double *x, double *y, const double *w,
+                           double *dots, int parallel) {
+    run_rows(dia_rows, op, NULL, x, y, w, dots, parallel);
+}
+
+static void dia_free(LinearOperator *op) {
+    arena_release(&((DiaOp*)op)->arena);
+    free(op);
+}
+
+// offsets: the profile's sorted diagonal offsets
+static LinearOperator* dia_create(CSRMatrix *A, const int *offsets, int num_diags) {
+    DiaOp *m = (DiaOp*)calloc(1, sizeof(DiaOp));
+    size_t count = (size_t)num_diags * A->n;
+    if (arena_init(&m->arena, arena_size(count, sizeof(double))) != 0) {
+        free(m);
+        return NULL;
+    }
+    m->values = (double*)arena_alloc(&m->arena, count, sizeof(double));
+    m->num_diags = num_diags;
+    memcpy(m->offsets, offsets, num_diags * sizeof(int));
+    for (int i = 0; i < A->n; i++) {
+        int k = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            int off = A->col_idx[j] - i;
+            while (m->offsets[k] != off) k = (k + 1) % num_diags;
+            m->values[(size_t)k * A->n + i] += A->values[j];
+        }
+    }
+    m->op.name = "dia";
+    m->op.n = A->n;
+    m->op.apply = dia_apply;
+    m->op.apply_dots = dia_apply_dots;
+    return &m->op;
+}
+
+// ============================================================================
+// CSR5
+// ============================================================================
+
+static void csr5_op_free(LinearOperator *op) {
+    csr5_free((Csr5Matrix*)op);
+}
+
+// ============================================================================
+// Inspection
+// ============================================================================
+
+// One pass over A: row lengths, bandwidth, diagonal offsets (sorted, up to
+// INSPECT_MAX_DIAGONALS) and distinct values (into values, up to its size)
+static void profile_matrix(CSRMatrix *A, MatrixProfile *p, int *offsets, ValueTable *values) {
+    memset(p, 0, sizeof(*p));
+    p->n = A->n;
+    p->nnz = A->nnz;
+    value_table_init(values);
+    int many_values = 0;
+    for (int i = 0; i < A->n; i++) {
+        int len = A->row_ptr[i+1] - A->row_ptr[i];
+        p->row_hist[len < INSPECT_HIST_BINS - 1 ? len : INSPECT_HIST_BINS - 1]++;
+        if (len > p->max_row) p->max_row = len;
+        int hint = 0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            int off = A->col_idx[j] - i;
+            int band = off < 0 ? -off : off;
+            if (band > p->bandwidth) p->bandwidth = band;
+            // Sorted columns meet the offsets in order: try the next one first
+            if (p->diagonals <= INSPECT_MAX_DIAGONALS &&
+                !(hint < p->diagonals && offsets[hint] == off)) {
+                hint = 0;
+                while (hint < p->diagonals && offsets[hint] != off) hint++;
+                if (hint == p->diagonals) {
+                    if (p->diagonals < INSPECT_MAX_DIAGONALS) offsets[hint] = off;
+                    p->diagonals++;
+                }
+            }
+            hint++;
+            if (!many_values && value_index(values, A->values[j]) < 0) many_values = 1;
+        }
+    }
+    p->distinct_values = many_values ? INSPECT_MAX_VALUES + 1 : values->count;
+    if (p->diagonals <= INSPECT_MAX_DIAGONALS) {
+        // Insertion sort: DIA walks the diagonals by increasing offset
+        for (int a = 1; a < p->diagonals; a++) {
+            int v = offsets[a], b = a;
+            while (b > 0 && offsets[b-1] > v) {
+                offsets[b] = offsets[b-1];
+                b--;
+            }
+            offsets[b] = v;
+        }
+        p->dia_fill = A->n > 0 ? (double)A->nnz / ((double)p->diagonals * A->n) : 0.0;
+    }
+}
+
+SpmvHandle* spmv_inspect(CSRMatrix *A, double tol, int parallel) {
+    SpmvHandle *h = (SpmvHandle*)calloc(1, sizeof(SpmvHandle));
+    InspectReport *rep = &h->report;
+    const MatrixProfile *p = &rep->profile;
+    double start = wall_time();
+
+    int offsets[INSPECT_MAX_DIAGONALS];
+    ValueTable *values = (ValueTable*)malloc(sizeof(ValueTable));
+    profile_matrix(A, &rep->profile, offsets, values);
+    double built = wall_time();
+    rep->analyze_time = built - start;
+
+    // Candidates the profile allows; csr first, it is the baseline
+    Candidate cand[INSPECT_CANDIDATES];
+    int count = 0;
+    LinearOperator *op = csr_create(A, VALUES_FP64, tol);
+    cand[count++] = (Candidate){op, csr_free};
+    if ((op = csr_create(A, VALUES_FP32, tol))) cand[count++] = (Candidate){op, csr_free};
+    if (p->distinct_values <= INSPECT_MAX_VALUES && (op = vi_create(A, values))) {
+        cand[count++] = (Candidate){op, vi_free};
+    }
+    if (p->diagonals <= INSPECT_MAX_DIAGONALS && p->dia_fill >= INSPECT_MIN_DIA_FILL &&
+        (op = dia_create(A, offsets, p->diagonals))) {
+        cand[count++] = (Candidate){op, dia_free};
+    }
+    Csr5Matrix *tiles = csr5_create(A);
+    if (tiles) cand[count++] = (Candidate){&tiles->op, csr5_op_free};
+    free(values);
+    double timed = wall_time();
+    rep->build_time = timed - built;
+
+    // Full SpMVs with both dots, round-robin over the candidates so drift
+    // in the machine's load hits all of them; best time counts
+    double *x = (double*)malloc(A->n * sizeof(double));
+    double *y = (double*)malloc(A->n * sizeof(double));
+    for (int i = 0; i < A->n; i++) x[i] = 1.0 + 1e-3 * (i % 101);
+    double best[INSPECT_CANDIDATES];
+    for (int c = 0; c < count; c++) best[c] = 1e30;
+    for (int trial = 0; trial < INSPECT_TRIALS; trial++) {
+        for (int c = 0; c < count; c++) {
+            double dots[2];
+            double t0 = wall_time();
+            cand[c].op->apply_dots(cand[c].op, x, y, x, dots, parallel);
+            double dt = wall_time() - t0;
+            if (dt < best[c]) best[c] = dt;
+        }
+    }
+    free(x);
+    free(y);
+    rep->timing_time = wall_time() - timed;
+
+    int pick = 0;
+    for (int c = 1; c < count; c++) {
+        if (best[c] < best[pick]) pick = c;
+    }
+    if (best[pick] >= INSPECT_MARGIN * best[0]) pick = 0;
+
+    rep->num_candidates = count;
+    for (int c = 0; c < count; c++) {
+        snprintf(h->names[c], sizeof(h->names[c]), "%s", cand[c].op->name);
+        rep->names[c] = h->names[c];
+        rep->times[c] = best[c];
+    }
+    rep->chosen = h->names[pick];
+    rep->chosen_time = best[pick];
+    rep->csr_time = best[0];
+    h->chosen = cand[pick];
+    for (int c = 0; c < count; c++) {
+        if (c != pick) cand[c].free_op(cand[c].op);
+    }
+    rep->total_time = wall_time() - start;
+    rep->break_even = best[pick] < best[0] ? rep->total_time / (best[0] - best[pick]) : 0.0;
+    return h;
+}
+
+LinearOperator* spmv_handle_op(SpmvHandle *h) {
+    return h->chosen.op;
+}
+
+const InspectReport* spmv_handle_report(const SpmvHandle *h) {
+    return &h->report;
+}
+
+void spmv_handle_print(const SpmvHandle *h) {
+    const InspectReport *r = &h->report;
+    const MatrixProfile *p = &r->profile;
+    printf("Inspector: %d rows, %d nonzeros, longest row %d, bandwidth %d\n",
+           p->n, p->nnz, p->max_row, p->bandwidth);
+    printf("  Row lengths:");
+    for (int b = 0; b < INSPECT_HIST_BINS; b++) {
+        if (p->row_hist[b] == 0) continue;
+        printf(" %s%d:%d", b == INSPECT_HIST_BINS - 1 ? ">=" : "", b, p->row_hist[b]);
+    }
+    printf("\n");
+    if (p->diagonals > INSPECT_MAX_DIAGONALS) {
+        printf("  Diagonals: more than %d", INSPECT_MAX_DIAGONALS);
+    } else {
+        printf("  Diagonals: %d (fill %.2f)", p->diagonals, p->dia_fill);
+    }
+    if (p->distinct_values > INSPECT_MAX_VALUES) {
+        printf(", distinct values: more than %d\n", INSPECT_MAX_VALUES);
+    } else {
+        printf(", distinct values: %d\n", p->distinct_values);
+    }
+    printf("  SpMV (ms):");
+    for (int c = 0; c < r->num_candidates; c++) printf(" %s %.3f", r->names[c], 1e3 * r->times[c]);
+    printf("\n");
+    printf("  Chosen: %s; inspection %.1f ms (profile %.1f, build %.1f, timing %.1f)\n",
+           r->chosen, 1e3 * r->total_time, 1e3 * r->analyze_time, 1e3 * r->build_time,
+           1e3 * r->timing_time);
+    if (r->break_even > 0.0) {
+        printf("  Pays off after %.0f SpMVs\n", r->break_even);
+    } else {
+        printf("  Kept csr: the inspection does not pay off\n");
+    }
+}
+
+void spmv_handle_free(SpmvHandle *h) {
+    if (!h) return;
+    h->chosen.free_op(h->chosen.op);
+    free(h);
+}
@@ -0,0 +1,73 @@
+// inspector.h
+// Inspector-executor SpMV: analyze a CSR matrix once, pick a format/kernel
+//
+// spmv_inspect() profiles the matrix (row lengths, bandwidth, diagonals,
+// distinct values), builds the candidates the profile allows and times
+// them on the matrix. Candidates:
+//   csr        CSR with the SpmvPlan kernel (plain, or prefetch / gather
+//              when SPMV_AUTO finds scattered columns)
+//   csr-fp32   CSR with fp32 values, if they pass lowprec's check against tol
+//   csr-vi     CSR with 1-byte indices into a table of the distinct values
+//              (at most 256), exact
+//   dia        diagonal storage, if there are at most INSPECT_MAX_DIAGONALS
+//              diagonals that are mostly full; contiguous x loads, exact
+//   CSR5       CSR5 tiles (csr5.h)
+// The fastest one (csr unless another beats it by INSPECT_MARGIN) stays in
+// an opaque handle whose LinearOperator the solvers use via opts.op. The
+// others are freed. The handle borrows the CSR arrays
+
+#ifndef INSPECTOR_H
+#define INSPECTOR_H
+
+#include "fem_matrix.h"
+#include "linear_operator.h"
+
+#define INSPECT_HIST_BINS 10        // Row lengths 0..8, then 9 and longer
+#define INSPECT_MAX_DIAGONALS 16    // Largest diagonal count DIA is tried with
+#define INSPECT_MIN_DIA_FILL 0.5    // Share of DIA slots that must hold an entry
+#define INSPECT_MAX_VALUES 256      // Distinct values a 1-byte index can address
+#define INSPECT_TRIALS 5            // Timed SpMVs per candidate (best counts)
+#define INSPECT_MARGIN 0.95         // Time ratio to csr another candidate must beat
+#define INSPECT_CANDIDATES 5
+
+// What the inspector found out about the matrix
+typedef struct {
+    int n, nnz;
+    int row_hist[INSPECT_HIST_BINS];    // Rows per length (last bin: longer)
+    int max_row;                        // Longest row
+    int bandwidth;                      // max |col - row|
+    int diagonals;                      // Distinct col - row offsets (> MAX: "many")
+    double dia_fill;                    // nnz / (diagonals * n) (0 if many)
+    int distinct_values;                // Distinct values (> INSPECT_MAX_VALUES: "many")
+} MatrixProfile;
+
+// Cost and outcome of one inspection
+typedef struct {
+    MatrixProfile profile;
+    int num_candidates;
+    const char *names[INSPECT_CANDIDATES];
+    double times[INSPECT_CANDIDATES];   // Best SpMV time per candidate (s)
+    const char *chosen;
+    double chosen_time;                 // Best SpMV time of the chosen candidate (s)
+    double csr_time;                    // Best SpMV time of the csr candidate (s)
+    double analyze_time;                // Profiling pass (s)
+    double build_time;                  // Building all candidates (s)
+    double timing_time;                 // Timing them (s)
+    double total_time;                  // Whole inspection (s)
+    double break_even;                  // SpMVs until the inspection pays off (0 = never)
+} InspectReport;
+
+typedef struct SpmvHandle SpmvHandle;
+
+// Inspects A (parallel = 1: candidates are timed on the OpenMP team, as the
+// parallel solver runs them); tol bounds the csr-fp32 value error
+SpmvHandle* spmv_inspect(CSRMatrix *A, double tol, int parallel);
+
+// Operator for opts.op: y = A*x and the fused w.y / y.y with the chosen kernel
+LinearOperator* spmv_handle_op(SpmvHandle *h);
+
+const InspectReport* spmv_handle_report(const SpmvHandle *h);
+void spmv_handle_print(const SpmvHandle *h);
+void spmv_handle_free(SpmvHandle *h);
+
+#endif // INSPECTOR_H
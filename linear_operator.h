@@ -0,0 +1,22 @@
+// linear_operator.h
+// Abstract linear operator y = A*x
+// Lets the solvers run on operators that are not stored as a CSRMatrix
+// (e.g. matrix-free high-order elements)
+
+#ifndef LINEAR_OPERATOR_H
+#define LINEAR_OPERATOR_H
+
+typedef struct LinearOperator LinearOperator;
+
+struct LinearOperator {
+    const char *name;
+    int n;                  // Operator size
+    // y = A*x (parallel = 1: may use the current OpenMP team)
+    void (*apply)(LinearOperator *op, const double *x, double *y, int parallel);
+    // Optional fused form: y = A*x with dots[0] = w.y and dots[1] = y.y from
+    // the same pass (NULL = the solvers call apply and reduce separately)
+    void (*apply_dots)(LinearOperator *op, const double *x, double *y, const double *w,
+                       double *dots, int parallel);
+};
+
+#endif // LINEAR_OPERATOR_H
@@ -0,0 +1,245 @@
+// lowprec.c
+// Reduced-precision CSR values: encoding, error check and convert-on-load SpMV
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "lowprec.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LOWPREC_X86 1
+#include <immintrin.h>
+#endif
+
+static inline float float_from_bits(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline uint32_t float_bits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// bf16 is the upper half of a float
+static inline float bf16_to_float(uint16_t h) {
+    return float_from_bits((uint32_t)h << 16);
+}
+
+// Place sign, exponent and significand in a float's fields, then one
+// multiply by 2^(127-15) rebiases the exponent (zeros and subnormals included)
+static inline float fp16_to_float(uint16_t h) {
+    uint32_t bits = ((uint32_t)(h & 0x8000u) << 16) | ((uint32_t)(h & 0x7FFFu) << 13);
+    return float_from_bits(bits) * 0x1p112f;
+}
+
+// |v| rounded to the given number of significant bits
+static double round_significand(double v, int bits) {
+    if (v == 0.0) return 0.0;
+    int e;
+    double m = frexp(v, &e);
+    return ldexp(nearbyint(ldexp(m, bits)), e - bits);
+}
+
+static uint16_t bf16_encode(double v) {
+    double a = round_significand(fabs(v), 8);
+    uint16_t sign = v < 0.0 ? 0x8000u : 0u;
+    if (a < FLT_MIN) return sign;
+    return (uint16_t)(sign | (float_bits((float)a) >> 16));
+}
+
+static uint16_t fp16_encode(double v) {
+    double a = round_significand(fabs(v), 11);
+    uint16_t sign = v < 0.0 ? 0x8000u : 0u;
+    if (a < 0x1p-14) return (uint16_t)(sign | (uint16_t)nearbyint(fabs(v) * 0x1p24));  // Subnormal
+    if (a > 65504.0) a = 65504.0;       // Not reached after scaling
+    return (uint16_t)(sign | ((float_bits((float)a) >> 13) - 0x1C000u));
+}
+
+const char* lowprec_name(ValuePrecision precision) {
+    switch (precision) {
+    case VALUES_FP64: return "fp64";
+    case VALUES_FP32: return "fp32";
+    case VALUES_BF16: return "bf16";
+    case VALUES_FP16: return "fp16";
+    default:          return "auto";
+    }
+}
+
+int lowprec_bytes(ValuePrecision precision) {
+    switch (precision) {
+    case VALUES_FP32: return 4;
+    case VALUES_BF16:
+    case VALUES_FP16: return 2;
+    default:          return 8;
+    }
+}
+
+// Encodes A's values into lp->values (allocated) and returns the relative
+// error ||A - A_stored||_inf / ||A||_inf of what was stored
+static double encode_values(LowPrecValues *lp, CSRMatrix *A) {
+    float *f32 = (float*)lp->values;
+    uint16_t *h16 = (uint16_t*)lp->values;
+    double inv = 1.0 / lp->scale;
+    double max_err = 0.0, max_row = 0.0;
+    for (int i = 0; i < A->n; i++) {
+        double err = 0.0, row = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            double v = A->values[j];
+            double stored;
+            switch (lp->precision) {
+            case VALUES_FP32:
+                f32[j] = (float)(v * inv);
+                stored = (double)f32[j];
+                break;
+            case VALUES_BF16:
+                h16[j] = bf16_encode(v * inv);
+                stored = (double)bf16_to_float(h16[j]);
+                break;
+            default:
+                h16[j] = fp16_encode(v * inv);
+                stored = (double)fp16_to_float(h16[j]);
+                break;
+            }
+            err += fabs(v - stored * lp->scale);
+            row += fabs(v);
+        }
+        if (err > max_err) max_err = err;
+        if (row > max_row) max_row = row;
+    }
+    return max_row > 0.0 ? max_err / max_row : 0.0;
+}
+
+ValuePrecision lowprec_init(LowPrecValues *lp, CSRMatrix *A, ValuePrecision precision, double tol) {
+    memset(lp, 0, sizeof(*lp));
+    lp->precision = VALUES_FP64;
+    lp->scale = 1.0;
+    if (precision == VALUES_FP64 || A->nnz == 0) return VALUES_FP64;
+
+    // Scale: largest |v| of the rows with off-diagonal entries (Dirichlet
+    // identity rows would otherwise set it to 1 and make the stencil inexact)
+    double vmax = 0.0, vmax_all = 0.0;
+    for (int i = 0; i < A->n; i++) {
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            double v = fabs(A->values[j]);
+            vmax_all = fmax(vmax_all, v);
+            if (A->row_ptr[i+1] - A->row_ptr[i] > 1) vmax = fmax(vmax, v);
+        }
+    }
+    if (vmax == 0.0) vmax = vmax_all;
+    if (vmax == 0.0) return VALUES_FP64;
+
+    // AUTO means fp32: its conversion is free, while decoding the 2-byte
+    // formats costs more than their smaller loads save (see README)
+    ValuePrecision format = precision == VALUES_AUTO ? VALUES_FP32 : precision;
+    if (arena_init(&lp->arena, arena_size(A->nnz, lowprec_bytes(format))) == 0) {
+        lp->values = arena_alloc(&lp->arena, A->nnz, lowprec_bytes(format));
+        lp->precision = format;
+        lp->scale = vmax;
+        double error = encode_values(lp, A);
+        if (error <= LOWPREC_SAFETY * tol) {
+            lp->error = error;
+            return lp->precision;
+        }
+        arena_release(&lp->arena);
+    }
+    memset(lp, 0, sizeof(*lp));
+    lp->precision = VALUES_FP64;
+    lp->scale = 1.0;
+    return VALUES_FP64;
+}
+
+void lowprec_free(LowPrecValues *lp) {
+    arena_release(&lp->arena);
+    lp->values = NULL;
+    lp->precision = VALUES_FP64;
+}
+
+// Stored value j as double (unscaled)
+static inline double stored_value(const void *values, int j, ValuePrecision precision) {
+    if (precision == VALUES_FP32) return (double)((const float*)values)[j];
+    if (precision == VALUES_BF16) return (double)bf16_to_float(((const uint16_t*)values)[j]);
+    return (double)fp16_to_float(((const uint16_t*)values)[j]);
+}
+
+// Row loop with the conversion in the load; precision is a constant at each
+// call site below, so every format gets its own branch-free loop
+static inline __attribute__((always_inline))
+void rows_dot2(const LowPrecValues *lp, CSRMatrix *A, const double *x, double *y,
+               const double *w, int lo, int hi, double *wy, double *yy,
+               ValuePrecision precision) {
+    const void *values = lp->values;
+    const int *col = A->col_idx;
+    double scale = lp->scale;
+    double a = 0.0, c = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            sum += stored_value(values, j, precision) * x[col[j]];
+        }
+        sum *= scale;
+        y[i] = sum;
+        a += w[i] * sum;
+        c += sum * sum;
+    }
+    *wy = a;
+    *yy = c;
+}
+
+#ifdef LOWPREC_X86
+// fp16 rows with the F16C conversion instruction (reached only when the
+// CPU has it)
+__attribute__((target("f16c")))
+static void fp16_rows_f16c(const LowPrecValues *lp, CSRMatrix *A, const double *x, double *y,
+                           const double *w, int lo, int hi, double *wy, double *yy) {
+    const uint16_t *values = (const uint16_t*)lp->values;
+    const int *col = A->col_idx;
+    double scale = lp->scale;
+    double a = 0.0, c = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            sum += (double)_cvtsh_ss(values[j]) * x[col[j]];
+        }
+        sum *= scale;
+        y[i] = sum;
+        a += w[i] * sum;
+        c += sum * sum;
+    }
+    *wy = a;
+    *yy = c;
+}
+
+static int has_f16c(void) {
+    static int cached = -1;
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("f16c") ? 1 : 0;
+    }
+    return cached;
+}
+#endif
+
+void lowprec_csr_dot2(const LowPrecValues *lp, CSRMatrix *A, const double *x, double *y,
+                      const double *w, int lo, int hi, double *wy, double *yy) {
+    switch (lp->precision) {
+    case VALUES_FP32:
+        rows_dot2(lp, A, x, y, w, lo, hi, wy, yy, VALUES_FP32);
+        break;
+    case VALUES_BF16:
+        rows_dot2(lp, A, x, y, w, lo, hi, wy, yy, VALUES_BF16);
+        break;
+    default:
+#ifdef LOWPREC_X86
+        if (has_f16c()) {
+            fp16_rows_f16c(lp, A, x, y, w, lo, hi, wy, yy);
+            break;
+        }
+#endif
+        rows_dot2(lp, A, x, y, w, lo, hi, wy, yy, VALUES_FP16);
+        break;
+    }
+}
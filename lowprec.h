@@ -0,0 +1,58 @@
+// lowprec.h
+// Reduced-precision copies of CSR matrix values for SpMV
+//
+// Only the values are narrowed; x, y, the sums and every vector of the
+// Krylov recurrence stay double. Values are stored as v / scale, with
+// scale the largest |v| outside the identity rows: fp16's range fits, and
+// the constant-coefficient stencil (1 and -1/4 of the diagonal, identity
+// rows 3/2) is stored exactly. The row kernels convert each value to
+// double as it is loaded inside the ordinary CSR row loop (a widening load
+// for fp32, a shift for bf16, F16C or a shift and multiply for fp16) and
+// multiply each row sum by scale.
+//
+// A copy is only kept if ||A - A_stored||_inf / ||A||_inf is at most
+// LOWPREC_SAFETY * tol; otherwise the double values are used. The fp64
+// residual replacement and true-residual check still see the exact A
+
+#ifndef LOWPREC_H
+#define LOWPREC_H
+
+#include <stdint.h>
+#include "fem_matrix.h"
+
+typedef enum {
+    VALUES_FP64 = 0,        // A->values as is (default)
+    VALUES_AUTO,            // fp32 if it passes the error check, else fp64
+    VALUES_FP32,            // float
+    VALUES_BF16,            // bfloat16: 8-bit significand, float's exponent range
+    VALUES_FP16             // IEEE half: 11-bit significand
+} ValuePrecision;
+
+// Share of the solver tolerance the relative matrix error may use
+#define LOWPREC_SAFETY 0.1
+
+typedef struct {
+    ValuePrecision precision;   // Never VALUES_AUTO after lowprec_init; FP64 = no copy
+    double scale;               // Stored value = value / scale
+    double error;               // ||A - A_stored||_inf / ||A||_inf of the kept format
+    void *values;               // nnz float or uint16_t entries (NULL for FP64)
+    Arena arena;
+} LowPrecValues;
+
+// Narrows A's values to precision (VALUES_AUTO: fp32) and keeps them if
+// the relative error is within LOWPREC_SAFETY * tol.
+// Returns the precision in use (VALUES_FP64 when none passed)
+ValuePrecision lowprec_init(LowPrecValues *lp, CSRMatrix *A, ValuePrecision precision, double tol);
+void lowprec_free(LowPrecValues *lp);
+
+// Name for printing ("fp64", "auto", "fp32", "bf16", "fp16")
+const char* lowprec_name(ValuePrecision precision);
+
+// Bytes per stored value
+int lowprec_bytes(ValuePrecision precision);
+
+// y = A*x on rows lo..hi-1 from the stored values, *wy = w.y and *yy = y.y
+void lowprec_csr_dot2(const LowPrecValues *lp, CSRMatrix *A, const double *x, double *y,
+                      const double *w, int lo, int hi, double *wy, double *yy);
+
+#endif // LOWPREC_H
@@ -6,31 +6,45 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
 #include "fem_matrix.h"
-
-// External solver functions
-extern int bicgstab_serial(FEMSystem *sys, int max_iter, double tol, double *solve_time);
-extern int bicgstab_parallel(FEMSystem *sys, int max_iter, double tol, int num_threads, double *solve_time);
+#include "bicgstab.h"
+#include "nested_iteration.h"
+#include "heat_equation.h"
+#include "fem_assembly.h"
+#include "preconditioner.h"
+#include "highorder.h"
+#include "analytic_solution.h"
+#include "async_solver.h"
+#include "solver_daemon.h"
+#include "blas1.h"
+#include "csr5.h"
+#include "inspector.h"
+#include "tuner.h"
+#include "pcg.h"
 
 // Function to verify solution quality
 void verify_solution(FEMSystem *sys) {
     int n = sys->n;
-    double *Ax = (double*)malloc(n * sizeof(double));
-    
-    // Compute Ax
-    matvec_csr(&sys->A, sys->x, Ax);
+    double *r = (double*)malloc(n * sizeof(double));
     
     // Compute residual norm: ||b - Ax||
-    double residual = 0.0;
+    double residual = sqrt(residual_csr(&sys->A, sys->x, sys->b, r));
+    
+    // The solvers test ||r|| / ||b||, so report both
+    double bnorm = 0.0;
     for (int i = 0; i < n; i++) {
-        double diff = sys->b[i] - Ax[i];
-        residual += diff * diff;
+        bnorm += sys->b[i] * sys->b[i];
     }
-    residual = sqrt(residual);
+    bnorm = sqrt(bnorm);
     
-    printf("Final residual norm: %.6e\n", residual);
+    printf("Final residual norm: %.6e (relative: %.6e)\n", residual,
+           bnorm > 0.0 ? residual / bnorm : residual);
     
-    free(Ax);
+    free(r);
 }
 
 // Run benchmark for a given grid size
@@ -44,8 +58,10 @@ void run_benchmark(int nx, int ny) {
     FEMSystem *sys = create_fem_system(nx, ny);
     print_system_info(sys);
     
-    int max_iter = 10000;
-    double tol = 1e-8;
+    SolverOptions opts;
+    solver_default_options(&opts);
+    int max_iter = opts.max_iter;
+    double tol = opts.tol;
     
     // Serial solve
     printf("\n--- Serial BICGSTAB ---\n");
@@ -53,11 +69,13 @@ void run_benchmark(int nx, int ny) {
     memset(sys->x, 0, sys->n * sizeof(double));
     
     double serial_time;
-    int iter_serial = bicgstab_serial(sys, max_iter, tol, &serial_time);
+    SolverStats serial_stats;
+    int iter_serial = bicgstab_serial_ex(sys, &opts, &serial_stats, &serial_time);
     
     if (iter_serial > 0) {
         printf("Time: %.6f seconds\n", serial_time);
         verify_solution(sys);
+        print_solver_stats("serial", &serial_stats);
     }
     
     // Parallel solves with different thread counts
@@ -90,7 +108,1588 @@ void run_benchmark(int nx, int ny) {
     free_fem_system(sys);
 }
 
-int main() {
+// Compare a cold start (x = 0) against the nested-iteration warm start
+void run_nested_benchmark(int nx, int ny, int levels) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Nested iteration: %d x %d, %d coarse levels\n", nx, ny, levels);
+    printf("========================================\n");
+    
+    FEMSystem *sys = create_fem_system(nx, ny);
+    SolverOptions opts;
+    solver_default_options(&opts);
+    
+    // Cold start
+    memset(sys->x, 0, sys->n * sizeof(double));
+    double cold_time;
+    SolverStats cold_stats;
+    bicgstab_serial_ex(sys, &opts, &cold_stats, &cold_time);
+    
+    // Warm start from the coarse-grid hierarchy
+    memset(sys->x, 0, sys->n * sizeof(double));
+    NestedStats nested;
+    nested_initial_guess(sys, levels, bicgstab_serial_ex, &opts, 1e-6, &nested);
+    double warm_time;
+    SolverStats warm_stats;
+    bicgstab_serial_ex(sys, &opts, &warm_stats, &warm_time);
+    verify_solution(sys);
+    
+    printf("%-12s %-12s %-15s %-15s\n", "Start", "Fine iters", "Coarse time (s)", "Total time (s)");
+    printf("------------------------------------------------------\n");
+    printf("%-12s %-12d %-15.6f %-15.6f\n", "x = 0", cold_stats.iterations, 0.0, cold_time);
+    printf("%-12s %-12d %-15.6f %-15.6f\n", "nested", warm_stats.iterations,
+           nested.coarse_time, nested.coarse_time + warm_time);
+    printf("(%d coarse levels, %d coarse iterations in total)\n",
+           nested.levels_used, nested.coarse_iterations);
+    
+    free_fem_system(sys);
+}
+
+// Transient heat conduction: per-step latency with reused operator,
+// workspace and warm starts versus a cold solve of the same step system
+void run_heat_benchmark(int nx, int ny, int steps, double dt, double theta, int lumped) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Heat equation: %d x %d, %d steps\n", nx, ny, steps);
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    HeatSolver *hs = heat_solver_create(nx, ny, dt, theta, lumped, bicgstab_serial_ex, &opts);
+    
+    double first_time = 0.0, total_time = 0.0, steady_time = 0.0;
+    int total_iters = 0, steady_steps = 0;
+    for (int step = 0; step < steps; step++) {
+        double step_time;
+        SolverStats stats;
+        int iter = heat_solver_step(hs, &stats, &step_time);
+        if (iter < 0) {
+            printf("Step %d failed\n", step);
+            break;
+        }
+        if (step == 0) first_time = step_time;
+        if (step >= steps / 2) {
+            steady_time += step_time;
+            steady_steps++;
+        }
+        total_time += step_time;
+        total_iters += iter;
+    }
+    
+    // Cold reference: same (last) step system, x = 0, fresh work vectors
+    double cold_time;
+    SolverStats cold_stats;
+    memset(hs->step.x, 0, hs->step.n * sizeof(double));
+    bicgstab_serial_ex(&hs->step, &opts, &cold_stats, &cold_time);
+    
+    double steady_avg = steady_steps > 0 ? steady_time / steady_steps : 0.0;
+    printf("%-28s %-12s\n", "Measure", "Value");
+    printf("------------------------------------------------------\n");
+    printf("%-28s %-12.6f\n", "Cold solve time (s)", cold_time);
+    printf("%-28s %-12d\n", "Cold solve iterations", cold_stats.iterations);
+    printf("%-28s %-12.6f\n", "First step time (s)", first_time);
+    printf("%-28s %-12.6f\n", "Steady-state step time (s)", steady_avg);
+    printf("%-28s %-12.1f\n", "Average iterations/step", (double)total_iters / steps);
+    printf("%-28s %-12.1f%%\n", "Steady step / cold solve", 100.0 * steady_avg / cold_time);
+    printf("%-28s %-12.6f\n", "Total time (s)", total_time);
+    
+    heat_solver_free(hs);
+}
+
+// Source term for the assembly benchmark: f = 2*pi^2 sin(pi x) sin(pi y)
+static double source_sine(double x, double y, void *ctx) {
+    (void)ctx;
+    return 2.0 * M_PI * M_PI * sin(M_PI * x) * sin(M_PI * y);
+}
+
+// Variable-coefficient assembly: full rebuild vs numeric-only re-assembly,
+// then a Picard loop for k(T) = 1 + T^2
+void run_assembly_benchmark(int nx, int ny, int picard_iters) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Variable-coefficient assembly: %d x %d\n", nx, ny);
+    printf("========================================\n");
+    int reps = 10;
+    
+    double start = wall_time();
+    FEMSystem *ref = create_fem_system(nx, ny);
+    double rebuild_time = wall_time() - start;
+    free_fem_system(ref);
+    
+    start = wall_time();
+    FEMAssembly *plain = fem_assembly_create(nx, ny, 0);
+    double symbolic_time = wall_time() - start;
+    FEMAssembly *cached = fem_assembly_create(nx, ny, 1);
+    
+    FEMCoefficients coef = {NULL, NULL, source_sine, NULL, NULL};
+    start = wall_time();
+    for (int r = 0; r < reps; r++) fem_assemble(plain, &coef);
+    double plain_time = (wall_time() - start) / reps;
+    start = wall_time();
+    for (int r = 0; r < reps; r++) fem_assemble(cached, &coef);
+    double cached_time = (wall_time() - start) / reps;
+    
+    printf("%-34s %-12s\n", "Phase", "Time (s)");
+    printf("------------------------------------------------------\n");
+    printf("%-34s %-12.6f\n", "create_fem_system (full rebuild)", rebuild_time);
+    printf("%-34s %-12.6f\n", "Symbolic (pattern + element map)", symbolic_time);
+    printf("%-34s %-12.6f\n", "Numeric, geometry recomputed", plain_time);
+    printf("%-34s %-12.6f\n", "Numeric, geometry cached", cached_time);
+    
+    // Picard iteration: k = 1 + T^2 sampled at the nodes of the last iterate
+    FEMSystem *sys = cached->sys;
+    double *k_nodal = (double*)malloc(sys->n * sizeof(double));
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    printf("\n%-8s %-12s %-15s %-15s\n", "Picard", "Iterations", "Assembly (s)", "Solve (s)");
+    printf("------------------------------------------------------\n");
+    for (int it = 0; it < picard_iters; it++) {
+        for (int i = 0; i < sys->n; i++) {
+            k_nodal[i] = 1.0 + sys->x[i] * sys->x[i];
+        }
+        FEMCoefficients picard = {NULL, k_nodal, source_sine, NULL, NULL};
+        start = wall_time();
+        fem_assemble(cached, &picard);
+        double assembly_time = wall_time() - start;
+        
+        double solve_time;
+        SolverStats stats;
+        bicgstab_serial_ex(sys, &opts, &stats, &solve_time);
+        printf("%-8d %-12d %-15.6f %-15.6f\n", it + 1, stats.iterations,
+               assembly_time, solve_time);
+    }
+    
+    free(k_nodal);
+    fem_assembly_free(plain);
+    fem_assembly_free(cached);
+}
+
+// Conductivity for the refactorization benchmark: k = 1 + amplitude*T
+static void update_conductivity(double *k_nodal, const double *x, int n, double amplitude) {
+    for (int i = 0; i < n; i++) {
+        k_nodal[i] = 1.0 + amplitude * x[i];
+    }
+}
+
+// Coefficient updates: full rebuild (create_fem_system + new ILU(0))
+// versus numeric-only refill of the same pattern and preconditioner
+void run_refactor_benchmark(int nx, int ny, int updates) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Numeric refactorization: %d x %d, %d updates\n", nx, ny, updates);
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    double *k_nodal = (double*)malloc(nx * ny * sizeof(double));
+    double rebuild_setup = 0.0, refill_setup = 0.0;
+    double rebuild_solve = 0.0, refill_solve = 0.0;
+    int rebuild_iters = 0, refill_iters = 0;
+    
+    // Rebuild path: everything from scratch for every coefficient update
+    double *x_keep = (double*)calloc(nx * ny, sizeof(double));
+    for (int u = 0; u < updates; u++) {
+        update_conductivity(k_nodal, x_keep, nx * ny, 0.5);
+        double start = wall_time();
+        FEMSystem *sys = fem_system_symbolic(nx, ny);
+        fem_system_numeric(sys, k_nodal);
+        Preconditioner *pc = precond_create_ilu0(&sys->A);
+        rebuild_setup += wall_time() - start;
+        
+        opts.precond = pc;
+        double solve_time;
+        SolverStats stats;
+        bicgstab_serial_ex(sys, &opts, &stats, &solve_time);
+        rebuild_solve += solve_time;
+        rebuild_iters += stats.iterations;
+        memcpy(x_keep, sys->x, nx * ny * sizeof(double));
+        
+        precond_free(pc);
+        free_fem_system(sys);
+    }
+    
+    // Refill path: pattern and ILU structure built once
+    memset(x_keep, 0, nx * ny * sizeof(double));
+    FEMSystem *sys = fem_system_symbolic(nx, ny);
+    fem_system_numeric(sys, NULL);
+    Preconditioner *pc = precond_create_ilu0(&sys->A);
+    double symbolic_time = pc->symbolic_time;
+    opts.precond = pc;
+    for (int u = 0; u < updates; u++) {
+        update_conductivity(k_nodal, x_keep, nx * ny, 0.5);
+        double start = wall_time();
+        fem_system_numeric(sys, k_nodal);
+        precond_update_numeric(pc, &sys->A);
+        refill_setup += wall_time() - start;
+        
+        memset(sys->x, 0, sys->n * sizeof(double));
+        double solve_time;
+        SolverStats stats;
+        bicgstab_serial_ex(sys, &opts, &stats, &solve_time);
+        refill_solve += solve_time;
+        refill_iters += stats.iterations;
+        memcpy(x_keep, sys->x, nx * ny * sizeof(double));
+    }
+    
+    printf("%-22s %-15s %-15s %-10s\n", "Path", "Setup (s)", "Solve (s)", "Iters");
+    printf("------------------------------------------------------\n");
+    printf("%-22s %-15.6f %-15.6f %-10d\n", "Rebuild", rebuild_setup, rebuild_solve, rebuild_iters);
+    printf("%-22s %-15.6f %-15.6f %-10d\n", "Numeric refill", refill_setup, refill_solve, refill_iters);
+    printf("(one-time ILU(0) symbolic setup: %.6f s)\n", symbolic_time);
+    
+    precond_free(pc);
+    free_fem_system(sys);
+    free(x_keep);
+    free(k_nodal);
+}
+
+// Exact T(x, y) for the unit-square problem (T = 1 on top, 0 elsewhere):
+// T = sum over odd n of 4/(n pi) sin(n pi x) sinh(n pi y) / sinh(n pi)
+// (sinh ratio written with exponentials to avoid overflow)
+static double exact_point_value(double x, double y) {
+    double sum = 0.0;
+    for (int n = 1; n < 2000; n += 2) {
+        double a = n * M_PI;
+        double ratio = exp(a * (y - 1.0)) * (1.0 - exp(-2.0 * a * y)) / (1.0 - exp(-2.0 * a));
+        double term = 4.0 / a * sin(a * x) * ratio;
+        sum += term;
+        if (fabs(ratio) < 1e-17) break;
+    }
+    return sum;
+}
+
+// One time-to-accuracy row: error at (x, y) = (0.5, 0.75)
+static void print_accuracy_row(const char *method, FEMSystem *sys, int node,
+                               int iters, double time) {
+    printf("%-14s %-10d %-8d %-12.6f %-12.3e\n", method, sys->n, iters, time,
+           fabs(sys->x[node] - exact_point_value(0.5, 0.75)));
+}
+
+// Time-to-accuracy of assembled Q1 (CSR) versus matrix-free Q1/Q2/Q3
+// Error is measured at (0.5, 0.75) against the Fourier series solution
+void run_highorder_benchmark(int num_threads) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Higher-order elements: time to accuracy\n");
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.tol = 1e-10;
+    opts.num_threads = num_threads;
+    
+    int csr_sizes[] = {33, 65, 129, 257};
+    int elems[3][3] = {{32, 64, 128}, {16, 32, 64}, {8, 16, 32}};
+    char label[32];
+    
+    printf("%-14s %-10s %-8s %-12s %-12s\n", "Method", "DOFs", "Iters", "Time (s)", "Error");
+    printf("------------------------------------------------------------\n");
+    for (int k = 0; k < 4; k++) {
+        int nx = csr_sizes[k];
+        FEMSystem *sys = create_fem_system(nx, nx);
+        double time;
+        SolverStats stats;
+        bicgstab_parallel_ex(sys, &opts, &stats, &time);
+        print_accuracy_row("Q1 CSR", sys, (nx / 2) * nx + 3 * (nx - 1) / 4,
+                           stats.iterations, time);
+        free_fem_system(sys);
+    }
+    for (int p = 1; p <= 3; p++) {
+        for (int k = 0; k < 3; k++) {
+            HighOrderOperator *ho;
+            FEMSystem *sys = create_highorder_system(elems[p-1][k], elems[p-1][k], p, &ho);
+            SolverOptions ho_opts = opts;
+            ho_opts.op = &ho->op;
+            double time;
+            SolverStats stats;
+            bicgstab_parallel_ex(sys, &ho_opts, &stats, &time);
+            snprintf(label, sizeof(label), "Q%d matrix-free", p);
+            print_accuracy_row(label, sys, (sys->ny / 2) * sys->nx + 3 * (sys->nx - 1) / 4,
+                               stats.iterations, time);
+            free_highorder_system(sys, ho);
+        }
+    }
+}
+
+// Discretization vs algebraic error against the Fourier-series solution,
+// and the iterations saved by stopping at an error target
+void run_analytic_benchmark(int nx, int ny) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Discretization error report: %d x %d\n", nx, ny);
+    printf("========================================\n");
+    
+    FEMSystem *sys = create_fem_system(nx, ny);
+    int n = sys->n;
+    double *xs = (double*)malloc(ny * sizeof(double));
+    double *ys = (double*)malloc(nx * sizeof(double));
+    double *exact = (double*)malloc(n * sizeof(double));
+    double *converged = (double*)malloc(n * sizeof(double));
+    fem_grid_coordinates(nx, ny, xs, ys);
+    
+    double start = wall_time();
+    int terms = fourier_reference(xs, ny, ys, nx, 100000, 1e-15, exact);
+    printf("Reference solution: %d terms (max), %.6f s\n", terms, wall_time() - start);
+    
+    // Discrete solution to (near) machine precision
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.tol = 1e-13;
+    double time;
+    SolverStats stats;
+    bicgstab_serial_ex(sys, &opts, &stats, &time);
+    memcpy(converged, sys->x, n * sizeof(double));
+    ErrorNorms disc = error_norms(converged, exact, n);
+    printf("Discretization error: L2 = %.3e, Linf = %.3e\n\n", disc.l2, disc.linf);
+    
+    printf("%-16s %-8s %-12s %-12s %-12s\n", "Stopping", "Iters", "Alg. L2", "Total L2", "Total Linf");
+    printf("------------------------------------------------------------\n");
+    double tols[] = {1e-4, 1e-5, 1e-6, 1e-8, 1e-10};
+    char label[32];
+    for (int k = 0; k < 5; k++) {
+        opts.tol = tols[k];
+        memset(sys->x, 0, n * sizeof(double));
+        bicgstab_serial_ex(sys, &opts, &stats, &time);
+        ErrorNorms alg = error_norms(sys->x, converged, n);
+        ErrorNorms total = error_norms(sys->x, exact, n);
+        snprintf(label, sizeof(label), "tol = %.0e", tols[k]);
+        printf("%-16s %-8d %-12.3e %-12.3e %-12.3e\n", label, stats.iterations,
+               alg.l2, total.l2, total.linf);
+    }
+    
+    // Stop once the algebraic error bound is half the discretization error
+    // (the bound itself overestimates the true algebraic error)
+    opts.tol = 1e-13;
+    opts.error_target = 0.5 * disc.l2;
+    opts.inv_norm_estimate = fem_inverse_norm_estimate(sys);
+    memset(sys->x, 0, n * sizeof(double));
+    bicgstab_serial_ex(sys, &opts, &stats, &time);
+    ErrorNorms alg = error_norms(sys->x, converged, n);
+    ErrorNorms total = error_norms(sys->x, exact, n);
+    printf("%-16s %-8d %-12.3e %-12.3e %-12.3e\n", "error target", stats.iterations,
+           alg.l2, total.l2, total.linf);
+    
+    free(xs);
+    free(ys);
+    free(exact);
+    free(converged);
+    free_fem_system(sys);
+}
+
+// Iterations, time, true residual and algebraic error (against a tight
+// solve) for each stopping criterion at the same tolerance
+void run_stopping_benchmark(int nx, int ny, double tol) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Stopping criteria: %d x %d, tol = %.0e\n", nx, ny, tol);
+    printf("========================================\n");
+    
+    FEMSystem *sys = create_fem_system(nx, ny);
+    int n = sys->n;
+    double *reference = (double*)malloc(n * sizeof(double));
+    double *r = (double*)malloc(n * sizeof(double));
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.tol = 1e-13;
+    double time;
+    SolverStats stats;
+    bicgstab_serial_ex(sys, &opts, &stats, &time);
+    memcpy(reference, sys->x, n * sizeof(double));
+    double bnorm = 0.0;
+    for (int i = 0; i < n; i++) bnorm += sys->b[i] * sys->b[i];
+    bnorm = sqrt(bnorm);
+    
+    const char *names[] = {"||r||/||b||", "||r||/||r0||", "||r||", "backward", "energy est."};
+    StopCriterion criteria[] = {STOP_RELATIVE_B, STOP_RELATIVE_R0, STOP_ABSOLUTE,
+                                STOP_BACKWARD_ERROR, STOP_ENERGY_ESTIMATE};
+    
+    printf("%-14s %-8s %-12s %-12s %-12s %-12s\n", "Criterion", "Iters", "Time (s)",
+           "Value", "True res.", "Alg. L2");
+    printf("--------------------------------------------------------------------------\n");
+    opts.tol = tol;
+    for (int k = 0; k < 5; k++) {
+        opts.stop_criterion = criteria[k];
+        memset(sys->x, 0, n * sizeof(double));
+        bicgstab_serial_ex(sys, &opts, &stats, &time);
+        double res = sqrt(residual_csr(&sys->A, sys->x, sys->b, r)) / bnorm;
+        ErrorNorms alg = error_norms(sys->x, reference, n);
+        printf("%-14s %-8d %-12.6f %-12.3e %-12.3e %-12.3e\n", names[k], stats.iterations,
+               time, stats.stop_value, res, alg.l2);
+    }
+    
+    free(reference);
+    free(r);
+    free_fem_system(sys);
+}
+
+// Cost of convergence testing: separate norm passes every iteration or every
+// few iterations, vs norms fused into the s and r updates
+void run_check_benchmark(int nx, int ny, int num_threads) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Convergence checking: %d x %d, %d threads\n", nx, ny, num_threads);
+    printf("========================================\n");
+    
+    FEMSystem *sys = create_fem_system(nx, ny);
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.num_threads = num_threads;
+    opts.workspace = solver_workspace_create(sys->n);
+    
+    int fused[] = {0, 0, 0, 1};
+    int interval[] = {1, 2, 5, 1};
+    
+    printf("%-8s %-10s %-8s %-10s %-12s %-14s %-12s\n", "Fused", "Interval", "Iters", "vs k=1",
+           "Time (s)", "Passes/iter", "True res.");
+    printf("-------------------------------------------------------------------------------\n");
+    int iters_every = 0;    // Unfused, interval 1 (the reference sequence)
+    for (int k = 0; k < 4; k++) {
+        opts.fused_norms = fused[k];
+        opts.check_interval = interval[k];
+        
+        // Best of three to smooth out timer noise
+        double best = 1e30;
+        SolverStats stats;
+        for (int rep = 0; rep < 3; rep++) {
+            memset(sys->x, 0, sys->n * sizeof(double));
+            double time;
+            bicgstab_parallel_ex(sys, &opts, &stats, &time);
+            if (time < best) best = time;
+        }
+        int passes = stats.spmv_count + stats.dot_count + stats.axpy_count + stats.replace_count;
+        if (k == 0) iters_every = stats.iterations;
+        printf("%-8s %-10d %-8d %+-10d %-12.6f %-14.2f %-12.3e\n", fused[k] ? "yes" : "no",
+               interval[k], stats.iterations, stats.iterations - iters_every, best,
+               (double)passes / stats.iterations, stats.true_residual);
+    }
+    
+    solver_workspace_free(opts.workspace);
+    free_fem_system(sys);
+}
+
+// Thread-count dependence of the parallel solver with native OpenMP
+// reductions vs fixed-order (deterministic) reductions
+void run_reproducibility_benchmark(int nx, int ny) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Reproducible reductions: %d x %d\n", nx, ny);
+    printf("========================================\n");
+    
+    FEMSystem *sys = create_fem_system(nx, ny);
+    int n = sys->n;
+    double *x_one = (double*)malloc(n * sizeof(double));
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.workspace = solver_workspace_create(n);
+    
+    int threads[] = {1, 2, 4, 8};
+    printf("%-15s %-8s %-8s %-12s %-12s %-14s\n", "Reductions", "Threads", "Iters", "Time (s)",
+           "ms/iter", "Max |x - x_1|");
+    printf("-------------------------------------------------------------------------\n");
+    for (int det = 0; det <= 1; det++) {
+        opts.deterministic = det;
+        for (int k = 0; k < 4; k++) {
+            opts.num_threads = threads[k];
+            memset(sys->x, 0, n * sizeof(double));
+            double time;
+            SolverStats stats;
+            bicgstab_parallel_ex(sys, &opts, &stats, &time);
+            
+            // Difference to the single-thread solution of the same mode
+            if (k == 0) memcpy(x_one, sys->x, n * sizeof(double));
+            double diff = 0.0;
+            for (int i = 0; i < n; i++) {
+                double d = fabs(sys->x[i] - x_one[i]);
+                if (d > diff) diff = d;
+            }
+            printf("%-15s %-8d %-8d %-12.6f %-12.4f %-14.3e\n",
+                   det ? "fixed-order" : "OpenMP native", threads[k], stats.iterations, time,
+                   1e3 * time / stats.iterations, diff);
+        }
+    }
+    
+    solver_workspace_free(opts.workspace);
+    free(x_one);
+    free_fem_system(sys);
+}
+
+// Best-of-reps solve time for one solver (from a zero initial guess)
+static double best_solve_time(SolverFn solver, FEMSystem *sys, const SolverOptions *opts,
+                              int reps, int *iters) {
+    double best = 1e30;
+    for (int rep = 0; rep < reps; rep++) {
+        memset(sys->x, 0, sys->n * sizeof(double));
+        double time;
+        SolverStats stats;
+        solver(sys, opts, &stats, &time);
+        if (time < best) best = time;
+        *iters = stats.iterations;
+    }
+    return best;
+}
+
+// OpenMP vs persistent spin-barrier pool on small grids, where the
+// per-region overhead decides whether threads help at all
+void run_pool_benchmark(int num_threads) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Thread pool vs OpenMP: %d threads\n", num_threads);
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.num_threads = num_threads;
+    opts.pool = thread_pool_create(num_threads, 1);
+    
+    int sizes[] = {10, 14, 20, 32, 45, 64, 100};
+    printf("%-8s %-8s %-12s %-12s %-12s %-10s %-10s\n", "Nodes", "Iters", "Serial (s)",
+           "OpenMP (s)", "Pool (s)", "OpenMP x", "Pool x");
+    printf("------------------------------------------------------------------------------\n");
+    for (int k = 0; k < 7; k++) {
+        FEMSystem *sys = create_fem_system(sizes[k], sizes[k]);
+        opts.workspace = solver_workspace_create(sys->n);
+        int iters, omp_iters, pool_iters;
+        double serial = best_solve_time(bicgstab_serial_ex, sys, &opts, 5, &iters);
+        double omp = best_solve_time(bicgstab_parallel_ex, sys, &opts, 5, &omp_iters);
+        double pool = best_solve_time(bicgstab_pool_ex, sys, &opts, 5, &pool_iters);
+        printf("%-8d %-8d %-12.6f %-12.6f %-12.6f %-10.2f %-10.2f\n", sys->n, pool_iters,
+               serial, omp, pool, serial / omp, serial / pool);
+        solver_workspace_free(opts.workspace);
+        free_fem_system(sys);
+    }
+    
+    thread_pool_free(opts.pool);
+}
+
+// Loop-parallel (barrier per kernel) vs task-graph BICGSTAB
+// Iteration counts differ (summation order), so the speed ratio is per iteration
+void run_tasks_benchmark(int nx, int ny) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Task graph vs parallel loops: %d x %d\n", nx, ny);
+    printf("========================================\n");
+    
+    FEMSystem *sys = create_fem_system(nx, ny);
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.workspace = solver_workspace_create(sys->n);
+    
+    int threads[] = {1, 2, 4};
+    printf("%-8s %-10s %-12s %-10s %-12s %-10s\n", "Threads", "Loop it.", "Loop (s)",
+           "Task it.", "Tasks (s)", "Per-iter x");
+    printf("------------------------------------------------------------------\n");
+    for (int k = 0; k < 3; k++) {
+        opts.num_threads = threads[k];
+        int loop_iters, task_iters;
+        double loop = best_solve_time(bicgstab_parallel_ex, sys, &opts, 3, &loop_iters);
+        double tasks = best_solve_time(bicgstab_tasks_ex, sys, &opts, 3, &task_iters);
+        printf("%-8d %-10d %-12.6f %-10d %-12.6f %-10.2f\n", threads[k], loop_iters, loop,
+               task_iters, tasks, (loop / loop_iters) / (tasks / task_iters));
+    }
+    
+    solver_workspace_free(opts.workspace);
+    free_fem_system(sys);
+}
+
+// Separate work-vector arrays vs the interleaved (AoSoA) layout, up to
+// sizes where the vectors and the matrix no longer fit in the cache
+// Both solvers allocate their work vectors per solve; tol is loose since
+// only the time per iteration is compared
+void run_interleaved_benchmark(int num_threads) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Interleaved work vectors: %d threads\n", num_threads);
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.num_threads = num_threads;
+    opts.tol = 1e-4;
+    
+    int sizes[] = {129, 257, 513, 1025, 2049};
+    printf("%-10s %-12s %-10s %-14s %-10s %-14s %-10s\n", "Nodes", "Vectors (MB)", "Separate",
+           "ms/iter", "AoSoA", "ms/iter", "Speedup");
+    printf("------------------------------------------------------------------------------\n");
+    for (int k = 0; k < 5; k++) {
+        FEMSystem *sys = create_fem_system(sizes[k], sizes[k]);
+        int reps = sizes[k] <= 513 ? 3 : 1;
+        int sep_iters, il_iters;
+        double sep = best_solve_time(bicgstab_parallel_ex, sys, &opts, reps, &sep_iters);
+        double il = best_solve_time(bicgstab_interleaved_ex, sys, &opts, reps, &il_iters);
+        double sep_ms = 1e3 * sep / sep_iters, il_ms = 1e3 * il / il_iters;
+        printf("%-10d %-12.1f %-10d %-14.4f %-10d %-14.4f %-10.2f\n", sys->n,
+               6.0 * sys->n * sizeof(double) / 1e6, sep_iters, sep_ms, il_iters, il_ms,
+               sep_ms / il_ms);
+        free_fem_system(sys);
+    }
+}
+
+// BLAS-1 kernels of blas1.h by name, with the doubles each one moves per entry
+typedef struct {
+    const char *name;
+    int streams;        // Vectors read + vectors written
+    int can_stream;     // Output is write-only (streaming stores apply)
+} Blas1Bench;
+
+static const Blas1Bench blas1_benches[] = {
+    {"dot", 2, 0}, {"dot2", 4, 0}, {"copy", 2, 1}, {"axpy", 3, 0},
+    {"axpby", 3, 1}, {"axpby_norm", 3, 1}, {"direction", 4, 0}
+};
+
+// One call of kernel k on the vectors v[0..3]; returns any reduction result
+static double blas1_bench_call(int k, double **v, int n, int stream) {
+    double ab = 0.0, cd = 0.0;
+    switch (k) {
+    case 0: ab = blas1_dot(v[0], v[1], n); break;
+    case 1: blas1_dot2(v[0], v[1], v[2], v[3], n, &ab, &cd); break;
+    case 2: blas1_copy(v[0], v[3], n, stream); break;
+    case 3: blas1_axpy(1e-9, v[0], v[3], n); break;
+    case 4: blas1_axpby(1.0, v[0], -0.5, v[1], v[3], n, stream); break;
+    case 5: ab = blas1_axpby_norm(1.0, v[0], -0.5, v[1], v[3], n, stream); break;
+    default: blas1_direction(v[3], v[0], v[1], 0.5, 0.25, n); break;
+    }
+    return ab + cd;
+}
+
+// Bandwidth of each BLAS-1 kernel for every instruction set this CPU runs,
+// in cache (32 KB - 2 MB per vector) and from memory (64 MB per vector);
+// write-only outputs are also timed with streaming stores
+void run_blas1_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("BLAS-1 kernels (GB/s), default: %s\n", blas1_isa());
+    printf("========================================\n");
+    
+    const char *isas[] = {"scalar", "sse2", "avx2", "avx512"};
+    int nisa = 4;
+    int sizes[] = {4096, 262144, 8388608};
+    int max_n = sizes[2];
+    
+    Arena arena;
+    if (arena_init(&arena, 4 * arena_size(max_n, sizeof(double))) != 0) return;
+    double *v[4];
+    for (int j = 0; j < 4; j++) {
+        v[j] = (double*)arena_alloc(&arena, max_n, sizeof(double));
+        for (int i = 0; i < max_n; i++) v[j][i] = 1.0 + 1e-3 * ((i * (j + 3)) % 97);
+    }
+    
+    printf("%-12s %-8s %-10s", "Kernel", "Stream", "N");
+    for (int m = 0; m < nisa; m++) printf(" %-10s", isas[m]);
+    printf("\n");
+    printf("----------------------------------------------------------------------------\n");
+    
+    double sink = 0.0;
+    int nbench = (int)(sizeof(blas1_benches) / sizeof(blas1_benches[0]));
+    for (int k = 0; k < nbench; k++) {
+        for (int stream = 0; stream <= blas1_benches[k].can_stream; stream++) {
+            for (int z = 0; z < 3; z++) {
+                int n = sizes[z];
+                int reps = 1 + (1 << 25) / n;
+                printf("%-12s %-8s %-10d", blas1_benches[k].name, stream ? "yes" : "no", n);
+                for (int m = 0; m < nisa; m++) {
+                    if (blas1_select(isas[m]) != 0) {
+                        printf(" %-10s", "-");
+                        continue;
+                    }
+                    double best = 1e30;
+                    for (int trial = 0; trial < 3; trial++) {
+                        double t0 = wall_time();
+                        for (int rep = 0; rep < reps; rep++) {
+                            sink += blas1_bench_call(k, v, n, stream);
+                        }
+                        double dt = wall_time() - t0;
+                        if (dt < best) best = dt;
+                    }
+                    double bytes = (double)blas1_benches[k].streams * n * sizeof(double) * reps;
+                    printf(" %-10.2f", bytes / best / 1e9);
+                }
+                printf("\n");
+            }
+        }
+    }
+    
+    blas1_select(NULL);
+    arena_release(&arena);
+    if (sink == 42.0) printf("\n");   // Keeps the reductions from being optimized away
+}
+
+// Best-of-5 time of one full SpMV (with both dot epilogues) for a plan
+static double spmv_time(const SpmvPlan *plan, CSRMatrix *A, const double *x, double *y) {
+    double best = 1e30, wy, yy;
+    for (int trial = 0; trial < 5; trial++) {
+        double t0 = wall_time();
+        spmv_csr_dot2(plan, A, x, y, x, 0, A->n, &wy, &yy);
+        double dt = wall_time() - t0;
+        if (dt < best) best = dt;
+    }
+    return best;
+}
+
+// SpMV kernels on the grid-ordered FEM matrix and on a randomly permuted
+// copy (same matrix, x loads scattered), then what SPMV_AUTO picks and the
+// solve time per iteration it gives compared to the plain kernel
+void run_spmv_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("SpMV prefetch / gather kernels\n");
+    printf("========================================\n");
+    
+    int sizes[] = {513, 1025, 2049};
+    SpmvKernel kernels[] = {SPMV_PLAIN, SPMV_PREFETCH, SPMV_PREFETCH, SPMV_PREFETCH,
+                            SPMV_PREFETCH, SPMV_GATHER};
+    int distances[] = {0, 8, 16, 32, 64, 0};
+    const char *labels[] = {"plain", "pf 8", "pf 16", "pf 32", "pf 64", "gather"};
+    if (!spmv_gather_supported()) labels[5] = "gather*";
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.num_threads = 1;
+    opts.tol = 1e-4;
+    
+    for (int z = 0; z < 3; z++) {
+        FEMSystem *grid = create_fem_system(sizes[z], sizes[z]);
+        int n = grid->n;
+        
+        // Fisher-Yates with a fixed LCG, so runs are comparable
+        int *perm = (int*)malloc(n * sizeof(int));
+        for (int i = 0; i < n; i++) perm[i] = i;
+        unsigned long long seed = 12345;
+        for (int i = n - 1; i > 0; i--) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            int k = (int)((seed >> 33) % (unsigned long long)(i + 1));
+            int tmp = perm[i];
+            perm[i] = perm[k];
+            perm[k] = tmp;
+        }
+        FEMSystem *shuffled = fem_system_permute(grid, perm);
+        free(perm);
+        
+        double *x = (double*)malloc(n * sizeof(double));
+        double *y = (double*)malloc(n * sizeof(double));
+        for (int i = 0; i < n; i++) x[i] = 1.0 + 1e-3 * (i % 101);
+        
+        printf("\n%d nodes, SpMV time (ms)\n", n);
+        printf("%-10s", "Ordering");
+        for (int k = 0; k < 6; k++) printf(" %-9s", labels[k]);
+        printf(" %-10s %-10s %-12s %-12s\n", "far", "auto", "plain ms/it", "auto ms/it");
+        printf("------------------------------------------------------------------------------"
+               "--------------------------\n");
+        FEMSystem *systems[] = {grid, shuffled};
+        const char *names[] = {"grid", "random"};
+        for (int m = 0; m < 2; m++) {
+            CSRMatrix *A = &systems[m]->A;
+            printf("%-10s", names[m]);
+            for (int k = 0; k < 6; k++) {
+                SpmvPlan plan;
+                spmv_plan_init(&plan, A, kernels[k], distances[k]);
+                printf(" %-9.3f", 1e3 * spmv_time(&plan, A, x, y));
+            }
+            SpmvPlan chosen;
+            spmv_plan_init(&chosen, A, SPMV_AUTO, 0);
+            
+            // Whole solves: fixed plain kernel vs the automatic choice
+            int plain_iters, auto_iters;
+            opts.spmv_kernel = SPMV_PLAIN;
+            double plain = best_solve_time(bicgstab_parallel_ex, systems[m], &opts, 1, &plain_iters);
+            opts.spmv_kernel = SPMV_AUTO;
+            double automatic = best_solve_time(bicgstab_parallel_ex, systems[m], &opts, 1, &auto_iters);
+            char choice[32];
+            snprintf(choice, sizeof(choice), chosen.kernel == SPMV_PREFETCH ? "%s %d" : "%s",
+                     spmv_kernel_name(chosen.kernel), chosen.distance);
+            printf(" %-10.2f %-10s %-12.4f %-12.4f\n", chosen.far_fraction, choice,
+                   1e3 * plain / plain_iters, 1e3 * automatic / auto_iters);
+        }
+        free(x);
+        free(y);
+        free_fem_system(shuffled);
+        free_fem_system(grid);
+    }
+    if (!spmv_gather_supported()) printf("* no AVX-512 on this CPU: gather runs the plain kernel\n");
+}
+
+// Best-of-5 time of one CSR5 SpMV with both dot epilogues
+static double csr5_time(Csr5Matrix *m, const double *x, double *y, int parallel) {
+    double best = 1e30, dots[2];
+    for (int trial = 0; trial < 5; trial++) {
+        double t0 = wall_time();
+        if (parallel) {
+            csr5_matvec_parallel(m, x, y, x, dots);
+        } else {
+            csr5_matvec(m, x, y, x, dots);
+        }
+        double dt = wall_time() - t0;
+        if (dt < best) best = dt;
+    }
+    return best;
+}
+
+// CSR5 against the row-wise CSR kernel: SpMV time (serial and on the
+// OpenMP team), largest difference in y, and solve time per iteration
+// with the CSR5 operator plugged into the parallel solver
+void run_csr5_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("CSR5 tiled SpMV\n");
+    printf("========================================\n");
+    
+    int sizes[] = {257, 1025, 2049};
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.tol = 1e-4;
+    opts.spmv_kernel = SPMV_PLAIN;
+    
+    printf("\n%-10s %-8s %-10s %-10s %-10s %-10s %-12s %-12s\n", "Nodes", "Tiles", "CSR ms",
+           "CSR5 ms", "CSR5 par", "max |dy|", "CSR ms/it", "CSR5 ms/it");
+    printf("------------------------------------------------------------------------------------\n");
+    for (int z = 0; z < 3; z++) {
+        FEMSystem *sys = create_fem_system(sizes[z], sizes[z]);
+        CSRMatrix *A = &sys->A;
+        int n = sys->n;
+        Csr5Matrix *m = csr5_create(A);
+        
+        double *x = (double*)malloc(n * sizeof(double));
+        double *y = (double*)malloc(n * sizeof(double));
+        double *y5 = (double*)malloc(n * sizeof(double));
+        for (int i = 0; i < n; i++) x[i] = 1.0 + 1e-3 * (i % 101);
+        
+        SpmvPlan plan;
+        spmv_plan_init(&plan, A, SPMV_PLAIN, 0);
+        double csr = spmv_time(&plan, A, x, y);
+        double serial = csr5_time(m, x, y5, 0);
+        double parallel = csr5_time(m, x, y5, 1);
+        double diff = 0.0;
+        for (int i = 0; i < n; i++) diff = fmax(diff, fabs(y5[i] - y[i]));
+        
+        int csr_iters, csr5_iters;
+        opts.op = NULL;
+        double t_csr = best_solve_time(bicgstab_parallel_ex, sys, &opts, 1, &csr_iters);
+        opts.op = &m->op;
+        double t_csr5 = best_solve_time(bicgstab_parallel_ex, sys, &opts, 1, &csr5_iters);
+        opts.op = NULL;
+        
+        printf("%-10d %-8d %-10.3f %-10.3f %-10.3f %-10.1e %-12.4f %-12.4f\n", n, m->num_tiles,
+               1e3 * csr, 1e3 * serial, 1e3 * parallel, diff,
+               1e3 * t_csr / csr_iters, 1e3 * t_csr5 / csr5_iters);
+        free(x);
+        free(y);
+        free(y5);
+        csr5_free(m);
+        free_fem_system(sys);
+    }
+}
+
+// Best-of-5 time of one SpMV (with both dot epilogues) from narrowed values
+static double lowprec_time(const LowPrecValues *lp, CSRMatrix *A, const double *x, double *y) {
+    double best = 1e30, wy, yy;
+    for (int trial = 0; trial < 5; trial++) {
+        double t0 = wall_time();
+        lowprec_csr_dot2(lp, A, x, y, x, 0, A->n, &wy, &yy);
+        double dt = wall_time() - t0;
+        if (dt < best) best = dt;
+    }
+    return best;
+}
+
+// Matrix values stored as fp64, fp32, bf16 and fp16, on the constant
+// stencil and with a varying conductivity: relative error and SpMV time of
+// each format, whether a solve at tol = 1e-8 keeps it, and that solve's
+// iterations, time per iteration and true residual
+void run_lowprec_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Reduced-precision matrix values\n");
+    printf("========================================\n");
+    
+    int sizes[] = {257, 1025};
+    ValuePrecision formats[] = {VALUES_FP64, VALUES_FP32, VALUES_BF16, VALUES_FP16};
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.spmv_kernel = SPMV_PLAIN;
+    
+    for (int z = 0; z < 2; z++) {
+        FEMSystem *sys = create_fem_system(sizes[z], sizes[z]);
+        CSRMatrix *A = &sys->A;
+        int n = sys->n;
+        double *x = (double*)malloc(n * sizeof(double));
+        double *y = (double*)malloc(n * sizeof(double));
+        double *k_nodal = (double*)malloc(n * sizeof(double));
+        for (int i = 0; i < n; i++) {
+            x[i] = 1.0 + 1e-3 * (i % 101);
+            k_nodal[i] = 1.0 + 0.5 * sin(0.05 * (i / sys->nx)) * cos(0.05 * (i % sys->nx));
+        }
+        
+        for (int c = 0; c < 2; c++) {
+            if (c == 1) fem_system_numeric(sys, k_nodal);
+            printf("\n%d nodes, %s conductivity\n", n, c ? "varying" : "constant");
+            printf("%-8s %-6s %-10s %-9s %-6s %-7s %-9s %-10s\n", "Values", "Bytes", "Rel error",
+                   "SpMV ms", "Kept", "Iters", "ms/iter", "True res");
+            printf("------------------------------------------------------------------------\n");
+            for (int f = 0; f < 4; f++) {
+                // Error and SpMV time of the format itself (kept whatever the error)
+                LowPrecValues lp;
+                lowprec_init(&lp, A, formats[f], 1e30);
+                double spmv;
+                if (formats[f] == VALUES_FP64) {
+                    SpmvPlan plan;
+                    spmv_plan_init(&plan, A, SPMV_PLAIN, 0);
+                    spmv = spmv_time(&plan, A, x, y);
+                } else {
+                    spmv = lowprec_time(&lp, A, x, y);
+                }
+                
+                // What a solve at opts.tol keeps, and the solve with it
+                LowPrecValues check;
+                int kept = lowprec_init(&check, A, formats[f], opts.tol) == formats[f];
+                lowprec_free(&check);
+                opts.value_precision = formats[f];
+                memset(sys->x, 0, n * sizeof(double));
+                SolverStats stats;
+                double time;
+                bicgstab_parallel_ex(sys, &opts, &stats, &time);
+                
+                printf("%-8s %-6d %-10.2e %-9.3f %-6s %-7d %-9.4f %-10.2e\n",
+                       lowprec_name(formats[f]), lowprec_bytes(formats[f]), lp.error,
+                       1e3 * spmv, kept ? "yes" : "no", stats.iterations,
+                       1e3 * time / stats.iterations, stats.true_residual);
+                lowprec_free(&lp);
+            }
+        }
+        free(x);
+        free(y);
+        free(k_nodal);
+        free_fem_system(sys);
+    }
+}
+
+// Inspector-executor on three kinds of matrix: the grid-ordered FEM
+// matrix, a randomly permuted copy (unstructured numbering) and a varying
+// conductivity (no repeated values). Prints each inspection, then the
+// solve time per iteration on plain CSR and on the chosen operator
+void run_inspect_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("SpMV inspector-executor\n");
+    printf("========================================\n");
+    
+    int sizes[] = {257, 1025};
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.tol = 1e-6;
+    opts.spmv_kernel = SPMV_PLAIN;
+    
+    for (int z = 0; z < 2; z++) {
+        FEMSystem *grid = create_fem_system(sizes[z], sizes[z]);
+        int n = grid->n;
+        
+        // Fisher-Yates with a fixed LCG, so runs are comparable
+        int *perm = (int*)malloc(n * sizeof(int));
+        for (int i = 0; i < n; i++) perm[i] = i;
+        unsigned long long seed = 12345;
+        for (int i = n - 1; i > 0; i--) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            int k = (int)((seed >> 33) % (unsigned long long)(i + 1));
+            int tmp = perm[i];
+            perm[i] = perm[k];
+            perm[k] = tmp;
+        }
+        FEMSystem *shuffled = fem_system_permute(grid, perm);
+        free(perm);
+        
+        FEMSystem *varying = create_fem_system(sizes[z], sizes[z]);
+        double *k_nodal = (double*)malloc(n * sizeof(double));
+        for (int i = 0; i < n; i++) {
+            k_nodal[i] = 1.0 + 0.5 * sin(0.05 * (i / grid->nx)) * cos(0.05 * (i % grid->nx));
+        }
+        fem_system_numeric(varying, k_nodal);
+        free(k_nodal);
+        
+        FEMSystem *systems[] = {grid, shuffled, varying};
+        const char *names[] = {"grid order", "random order", "varying conductivity"};
+        for (int m = 0; m < 3; m++) {
+            printf("\n%d nodes, %s\n", n, names[m]);
+            SpmvHandle *h = spmv_inspect(&systems[m]->A, opts.tol, 1);
+            spmv_handle_print(h);
+            
+            int csr_iters, op_iters;
+            opts.op = NULL;
+            double t_csr = best_solve_time(bicgstab_parallel_ex, systems[m], &opts, 1, &csr_iters);
+            opts.op = spmv_handle_op(h);
+            double t_op = best_solve_time(bicgstab_parallel_ex, systems[m], &opts, 1, &op_iters);
+            opts.op = NULL;
+            printf("  Solve: csr %.4f ms/iter (%d iters), %s %.4f ms/iter (%d iters)\n",
+                   1e3 * t_csr / csr_iters, csr_iters, spmv_handle_report(h)->chosen,
+                   1e3 * t_op / op_iters, op_iters);
+            spmv_handle_free(h);
+        }
+        free_fem_system(varying);
+        free_fem_system(shuffled);
+        free_fem_system(grid);
+    }
+}
+
+// Auto-tuned solves: searches the sizes missing from the tuning file, then
+// sizes in between come from the stored decisions. A second run only reads
+void run_tune_benchmark(const char *path) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Solver auto-tuning (%s)\n", path);
+    printf("========================================\n");
+    
+    TuneMachine m;
+    tune_machine(&m);
+    printf("Machine %s: %s\n", m.id, m.desc);
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    TuneOptions topts;
+    tune_default_options(&topts);
+    topts.path = path;
+    topts.verbose = 1;
+    
+    // 65, 129, 257 are tuned; 181 lies between two of them, 321 beyond the last
+    int sizes[] = {65, 129, 257, 181, 321};
+    for (int z = 0; z < 5; z++) {
+        FEMSystem *sys = create_fem_system(sizes[z], sizes[z]);
+        printf("\n%d nodes\n", sys->n);
+        
+        TuneConfig config;
+        double start = wall_time();
+        TuneSource source = tune_select(sys, "laplace", &opts, &topts, &config);
+        double select = wall_time() - start;
+        printf("  %s in %.3f s: %s, %s, %s, %d threads (estimate %.4f s)\n",
+               tune_source_name(source), select, tune_solver_name(config.solver),
+               tune_precond_name(config.precond), tune_format_name(config.format),
+               config.threads, config.time);
+        
+        SolverStats stats;
+        double tuned = 1e30, time;
+        int tuned_iters = 0, default_iters;
+        for (int rep = 0; rep < 3; rep++) {
+            memset(sys->x, 0, sys->n * sizeof(double));
+            tuned_iters = tune_solve(sys, &config, &opts, &stats, &time);
+            if (time < tuned) tuned = time;
+        }
+        double plain = best_solve_time(bicgstab_parallel_ex, sys, &opts, 3, &default_iters);
+        printf("  Solve: tuned %.4f s (%d iters), default parallel %.4f s (%d iters)\n",
+               tuned, tuned_iters, plain, default_iters);
+        free_fem_system(sys);
+    }
+}
+
+// PCG on the Dirichlet-eliminated (symmetric) system against BICGSTAB on
+// the original one: same grids, same tolerance, same solution
+void run_pcg_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("IC(0)-PCG vs BICGSTAB\n");
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    
+    int sizes[] = {129, 257, 513};
+    for (int z = 0; z < 3; z++) {
+        FEMSystem *sys = create_fem_system(sizes[z], sizes[z]);
+        FEMSystem *spd = fem_system_eliminate_dirichlet(sys);
+        int n = sys->n;
+        printf("\n%d nodes (symmetric copy: %d non-zeros)\n", n, spd->A.nnz);
+        
+        // Reference solution from plain BICGSTAB
+        int iters;
+        opts.precond = NULL;
+        double t = best_solve_time(bicgstab_parallel_ex, sys, &opts, 3, &iters);
+        double *x_ref = (double*)malloc(n * sizeof(double));
+        memcpy(x_ref, sys->x, n * sizeof(double));
+        printf("  %-20s %5d iters  %8.4f s\n", "BICGSTAB", iters, t);
+        
+        const char *labels[] = {"BICGSTAB + ILU(0)", "CG", "PCG + Jacobi", "PCG + IC(0)"};
+        for (int m = 0; m < 4; m++) {
+            FEMSystem *target = m == 0 ? sys : spd;
+            double start = wall_time();
+            Preconditioner *pc = m == 0 ? precond_create_ilu0(&sys->A) :
+                                 m == 2 ? precond_create_jacobi(&spd->A) :
+                                 m == 3 ? precond_create_ic0(&spd->A) : NULL;
+            double setup = wall_time() - start;
+            if (m == 3 && !pc) {
+                printf("  %-20s failed\n", labels[m]);
+                continue;
+            }
+            opts.precond = pc;
+            t = best_solve_time(m == 0 ? bicgstab_parallel_ex : pcg_parallel_ex, target, &opts, 3, &iters);
+            
+            double diff = 0.0;
+            for (int i = 0; i < n; i++) diff = fmax(diff, fabs(target->x[i] - x_ref[i]));
+            printf("  %-20s %5d iters  %8.4f s  setup %.4f s  max|x - x_ref| %.1e\n",
+                   labels[m], iters, t, setup, diff);
+            if (m == 3) {
+                SolverStats stats;
+                double time;
+                memset(spd->x, 0, n * sizeof(double));
+                pcg_parallel_ex(spd, &opts, &stats, &time);
+                double shift;
+                int levels;
+                precond_ic0_info(pc, &shift, &levels);
+                printf("  IC(0): %d levels, shift %g, %.3f ms per apply (%.0f%% of the solve)\n",
+                       levels, shift, 1e3 * stats.precond_time / stats.precond_count,
+                       100.0 * stats.precond_time / time);
+            }
+            precond_free(pc);
+        }
+        opts.precond = NULL;
+        free(x_ref);
+        free_fem_system(spd);
+        free_fem_system(sys);
+    }
+}
+
+// One preconditioned solve for the approximate-inverse comparison: setup,
+// iterations, solve time and the cost of one apply
+static void ainv_report(const char *label, SolverFn solver, FEMSystem *sys,
+                        SolverOptions *opts, Preconditioner *pc, double setup, int nnz) {
+    opts->precond = pc;
+    int iters;
+    double t = best_solve_time(solver, sys, opts, 2, &iters);
+    SolverStats stats;
+    double time;
+    memset(sys->x, 0, sys->n * sizeof(double));
+    solver(sys, opts, &stats, &time);
+    opts->precond = NULL;
+    
+    printf("  %-18s %5d iters  %8.4f s", label, iters, t);
+    if (pc) {
+        printf("  setup %7.4f s  apply %6.3f ms  nnz %8d",
+               setup, 1e3 * stats.precond_time / stats.precond_count, nnz);
+    }
+    printf("\n");
+}
+
+// Approximate-inverse preconditioners (applied by SpMV only) against the
+// triangular-solve ones: SPAI for BICGSTAB, FSAI for PCG on the symmetric copy
+void run_ainv_benchmark(void) {
+    printf("\n");
+    printf("========================================\n");
+    printf("FSAI / SPAI approximate inverses\n");
+    printf("========================================\n");
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    
+    int sizes[] = {129, 257, 513};
+    for (int z = 0; z < 3; z++) {
+        FEMSystem *sys = create_fem_system(sizes[z], sizes[z]);
+        FEMSystem *spd = fem_system_eliminate_dirichlet(sys);
+        printf("\n%d nodes, BICGSTAB (A: %d non-zeros)\n", sys->n, sys->A.nnz);
+        ainv_report("none", bicgstab_parallel_ex, sys, &opts, NULL, 0.0, 0);
+        
+        double start = wall_time();
+        Preconditioner *pc = precond_create_ilu0(&sys->A);
+        ainv_report("ILU(0)", bicgstab_parallel_ex, sys, &opts, pc, wall_time() - start, 2 * sys->A.nnz);
+        precond_free(pc);
+        for (int power = 1; power <= 2; power++) {
+            start = wall_time();
+            pc = precond_create_spai(&sys->A, power);
+            char label[32];
+            snprintf(label, sizeof(label), "SPAI(A^%d)", power);
+            ainv_report(label, bicgstab_parallel_ex, sys, &opts, pc, wall_time() - start,
+                        precond_ainv_nnz(pc));
+            precond_free(pc);
+        }
+        
+        printf("%d nodes, PCG (symmetric copy)\n", spd->n);
+        ainv_report("none", pcg_parallel_ex, spd, &opts, NULL, 0.0, 0);
+        start = wall_time();
+        pc = precond_create_ic0(&spd->A);
+        if (pc) {
+            ainv_report("IC(0)", pcg_parallel_ex, spd, &opts, pc, wall_time() - start,
+                        2 * spd->A.nnz);
+            precond_free(pc);
+        }
+        for (int power = 1; power <= 2; power++) {
+            start = wall_time();
+            pc = precond_create_fsai(&spd->A, power);
+            char label[32];
+            snprintf(label, sizeof(label), "FSAI(A^%d)", power);
+            ainv_report(label, pcg_parallel_ex, spd, &opts, pc, wall_time() - start,
+                        precond_ainv_nnz(pc));
+            precond_free(pc);
+        }
+        free_fem_system(spd);
+        free_fem_system(sys);
+    }
+}
+
+// Throughput on a mixed batch of small and large solves: one blocking
+// parallel solve at a time vs the asynchronous service
+void run_async_benchmark(int num_workers, int large_team) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Async solve service: %d workers, team %d\n", num_workers, large_team);
+    printf("========================================\n");
+    
+    // 56 small (400 to 4096 nodes) and 8 large (16641 nodes) systems
+    int num_jobs = 64;
+    int small_sizes[] = {20, 32, 45, 64};
+    FEMSystem *systems[64];
+    for (int k = 0; k < num_jobs; k++) {
+        int nx = (k % 8 == 7) ? 129 : small_sizes[k % 4];
+        systems[k] = create_fem_system(nx, nx);
+    }
+    
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    
+    // Blocking: every solve takes the whole team in turn
+    opts.num_threads = num_workers;
+    long blocking_iters = 0;
+    double start = wall_time();
+    for (int k = 0; k < num_jobs; k++) {
+        memset(systems[k]->x, 0, systems[k]->n * sizeof(double));
+        double time;
+        SolverStats stats;
+        bicgstab_parallel_ex(systems[k], &opts, &stats, &time);
+        blocking_iters += stats.iterations;
+    }
+    double blocking = wall_time() - start;
+    
+    // Async: submit everything, then wait
+    SolveService *svc = solve_service_create(num_workers, 10000, large_team);
+    SolveJob *jobs[64];
+    long async_iters = 0;
+    start = wall_time();
+    for (int k = 0; k < num_jobs; k++) {
+        memset(systems[k]->x, 0, systems[k]->n * sizeof(double));
+        jobs[k] = solve_submit(svc, systems[k], &opts);
+    }
+    for (int k = 0; k < num_jobs; k++) {
+        solve_wait(jobs[k]);
+        async_iters += solve_job_stats(jobs[k])->iterations;
+        solve_job_free(jobs[k]);
+    }
+    double async = wall_time() - start;
+    solve_service_free(svc);
+    
+    printf("%-12s %-12s %-14s %-12s\n", "Mode", "Wall (s)", "Jobs/s", "Iterations");
+    printf("----------------------------------------------------\n");
+    printf("%-12s %-12.4f %-14.1f %-12ld\n", "Blocking", blocking, num_jobs / blocking, blocking_iters);
+    printf("%-12s %-12.4f %-14.1f %-12ld\n", "Async", async, num_jobs / async, async_iters);
+    
+    for (int k = 0; k < num_jobs; k++) free_fem_system(systems[k]);
+}
+
+// One load-generator client: its own connection and one shared segment per
+// system of the mix, reused across requests
+typedef struct {
+    const char *socket_path;
+    FEMSystem **systems;    // Request mix (copied into the client's segments)
+    int requests;
+    int first;              // Offset into the size rotation
+    double *latency;        // Round trip per request (s)
+    int failures;
+} LoadClient;
+
+static void* load_client_main(void *arg) {
+    LoadClient *lc = (LoadClient*)arg;
+    SolverClient *client = solver_client_connect(lc->socket_path);
+    if (!client) {
+        lc->failures = lc->requests;
+        return NULL;
+    }
+    
+    SolverShm *shm[4];
+    for (int k = 0; k < 4; k++) shm[k] = solver_shm_from_system(lc->systems[k]);
+    
+    for (int r = 0; r < lc->requests; r++) {
+        SolverShm *s = shm[(lc->first + r) % 4];
+        memset(s->sys.x, 0, s->sys.n * sizeof(double));
+        SolverReply reply;
+        double start = wall_time();
+        int err = solver_client_solve(client, s, 1e-8, 10000, &reply);
+        lc->latency[r] = wall_time() - start;
+        if (err != 0 || reply.status != SOLVER_OK) lc->failures++;
+    }
+    
+    for (int k = 0; k < 4; k++) solver_shm_close(shm[k]);
+    solver_client_close(client);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts latency[0..count) and prints one percentile row
+static void print_latency_row(const char *mode, int clients, double *latency, int count,
+                              double wall, int failures) {
+    qsort(latency, count, sizeof(double), compare_double);
+    printf("%-10s %-8d %-10.3f %-10.3f %-10.3f %-10.3f %-10.1f %-8d\n", mode, clients,
+           1e3 * latency[(int)(0.50 * (count - 1))], 1e3 * latency[(int)(0.90 * (count - 1))],
+           1e3 * latency[(int)(0.99 * (count - 1))], 1e3 * latency[count - 1],
+           count / wall, failures);
+}
+
+// Request latency through the solver daemon (forked, warm workers, systems
+// handed over in shared memory) vs calling the solver directly in-process
+void run_daemon_benchmark(int num_workers, int total_requests) {
+    printf("\n");
+    printf("========================================\n");
+    printf("Solver daemon: %d workers, %d requests\n", num_workers, total_requests);
+    printf("========================================\n");
+    
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bicgstab_solver_%d.sock", (int)getpid());
+    
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return;
+    }
+    if (pid == 0) {
+        _exit(solver_daemon_run(path, num_workers, 10000, 2) == 0 ? 0 : 1);
+    }
+    
+    // Wait until the daemon accepts connections
+    SolverClient *control = NULL;
+    for (int attempt = 0; attempt < 5000 && !control; attempt++) {
+        control = solver_client_connect(path);
+        if (!control) usleep(1000);
+    }
+    if (!control) {
+        fprintf(stderr, "run_daemon_benchmark: daemon did not start\n");
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return;
+    }
+    
+    // Request mix: 400 to 4096 nodes
+    int sizes[] = {20, 32, 45, 64};
+    FEMSystem *systems[4];
+    for (int k = 0; k < 4; k++) systems[k] = create_fem_system(sizes[k], sizes[k]);
+    
+    double *latency = (double*)malloc(total_requests * sizeof(double));
+    printf("%-10s %-8s %-10s %-10s %-10s %-10s %-10s %-8s\n", "Mode", "Clients", "p50 (ms)",
+           "p90 (ms)", "p99 (ms)", "max (ms)", "Req/s", "Failed");
+    printf("-------------------------------------------------------------------------------\n");
+    
+    // Direct: the same request mix solved in this process, one at a time
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.workspace = solver_workspace_create(systems[3]->n);
+    int failures = 0;
+    double start = wall_time();
+    for (int r = 0; r < total_requests; r++) {
+        FEMSystem *sys = systems[r % 4];
+        memset(sys->x, 0, sys->n * sizeof(double));
+        double t0 = wall_time(), time;
+        SolverStats stats;
+        if (bicgstab_serial_ex(sys, &opts, &stats, &time) < 0) failures++;
+        latency[r] = wall_time() - t0;
+    }
+    print_latency_row("Direct", 1, latency, total_requests, wall_time() - start, failures);
+    solver_workspace_free(opts.workspace);
+    
+    // Daemon: 1 and 4 concurrent clients sharing the request budget
+    int client_counts[] = {1, 4};
+    for (int c = 0; c < 2; c++) {
+        int clients = client_counts[c];
+        LoadClient lc[4];
+        pthread_t threads[4];
+        start = wall_time();
+        for (int k = 0; k < clients; k++) {
+            lc[k].socket_path = path;
+            lc[k].systems = systems;
+            lc[k].requests = total_requests / clients;
+            lc[k].first = k;
+            lc[k].latency = latency + k * (total_requests / clients);
+            lc[k].failures = 0;
+            pthread_create(&threads[k], NULL, load_client_main, &lc[k]);
+        }
+        failures = 0;
+        for (int k = 0; k < clients; k++) {
+            pthread_join(threads[k], NULL);
+            failures += lc[k].failures;
+        }
+        int count = clients * (total_requests / clients);
+        print_latency_row("Daemon", clients, latency, count, wall_time() - start, failures);
+    }
+    
+    solver_client_shutdown(control);
+    solver_client_close(control);
+    waitpid(pid, NULL, 0);
+    for (int k = 0; k < 4; k++) free_fem_system(systems[k]);
+    free(latency);
+}
+
+int main(int argc, char **argv) {
+    // Optional mode: "./bicgstab_solver nested" runs the warm-start comparison
+    if (argc > 1 && strcmp(argv[1], "nested") == 0) {
+        run_nested_benchmark(65, 65, 4);
+        run_nested_benchmark(129, 129, 5);
+        run_nested_benchmark(257, 257, 6);
+        return 0;
+    }
+    
+    // "./bicgstab_solver heat": implicit Euler and Crank-Nicolson time stepping
+    if (argc > 1 && strcmp(argv[1], "heat") == 0) {
+        run_heat_benchmark(129, 129, 200, 1e-3, 1.0, 1);
+        run_heat_benchmark(129, 129, 200, 1e-3, 0.5, 0);
+        return 0;
+    }
+    
+    // "./bicgstab_solver assembly": variable-coefficient (re-)assembly
+    if (argc > 1 && strcmp(argv[1], "assembly") == 0) {
+        run_assembly_benchmark(257, 257, 5);
+        return 0;
+    }
+    
+    // "./bicgstab_solver refactor": numeric-only updates of matrix and ILU(0)
+    if (argc > 1 && strcmp(argv[1], "refactor") == 0) {
+        run_refactor_benchmark(257, 257, 5);
+        return 0;
+    }
+    
+    // "./bicgstab_solver highorder": Q1 CSR vs matrix-free Q1/Q2/Q3
+    if (argc > 1 && strcmp(argv[1], "highorder") == 0) {
+        run_highorder_benchmark(4);
+        return 0;
+    }
+    
+    // "./bicgstab_solver analytic": discretization vs algebraic error
+    if (argc > 1 && strcmp(argv[1], "analytic") == 0) {
+        run_analytic_benchmark(65, 65);
+        run_analytic_benchmark(257, 257);
+        return 0;
+    }
+    
+    // "./bicgstab_solver stopping": compare stopping criteria
+    if (argc > 1 && strcmp(argv[1], "stopping") == 0) {
+        run_stopping_benchmark(129, 129, 1e-6);
+        run_stopping_benchmark(257, 257, 1e-6);
+        return 0;
+    }
+    
+    // "./bicgstab_solver checking": fused norms and reduced-frequency checks
+    if (argc > 1 && strcmp(argv[1], "checking") == 0) {
+        run_check_benchmark(257, 257, 1);
+        run_check_benchmark(513, 513, 1);
+        return 0;
+    }
+    
+    // "./bicgstab_solver reproducible": thread-count independent reductions
+    if (argc > 1 && strcmp(argv[1], "reproducible") == 0) {
+        run_reproducibility_benchmark(129, 129);
+        run_reproducibility_benchmark(257, 257);
+        return 0;
+    }
+    
+    // "./bicgstab_solver pool": spin-barrier thread pool vs OpenMP
+    if (argc > 1 && strcmp(argv[1], "pool") == 0) {
+        run_pool_benchmark(2);
+        run_pool_benchmark(4);
+        return 0;
+    }
+    
+    // "./bicgstab_solver tasks": task-graph BICGSTAB vs parallel loops
+    if (argc > 1 && strcmp(argv[1], "tasks") == 0) {
+        run_tasks_benchmark(129, 129);
+        run_tasks_benchmark(257, 257);
+        return 0;
+    }
+    
+    // "./bicgstab_solver interleaved": AoSoA vs separate work vectors
+    if (argc > 1 && strcmp(argv[1], "interleaved") == 0) {
+        run_interleaved_benchmark(1);
+        return 0;
+    }
+    
+    // "./bicgstab_solver blas1": per-ISA BLAS-1 kernel bandwidth
+    if (argc > 1 && strcmp(argv[1], "blas1") == 0) {
+        run_blas1_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver spmv": prefetch / gather SpMV on grid and random orderings
+    if (argc > 1 && strcmp(argv[1], "spmv") == 0) {
+        run_spmv_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver csr5": tiled CSR5 SpMV against row-wise CSR
+    if (argc > 1 && strcmp(argv[1], "csr5") == 0) {
+        run_csr5_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver lowprec": fp32 / bf16 / fp16 matrix values
+    if (argc > 1 && strcmp(argv[1], "lowprec") == 0) {
+        run_lowprec_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver inspect": per-matrix SpMV format selection
+    if (argc > 1 && strcmp(argv[1], "inspect") == 0) {
+        run_inspect_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver tune [file]": auto-tuned solver configuration per size
+    if (argc > 1 && strcmp(argv[1], "tune") == 0) {
+        run_tune_benchmark(argc > 2 ? argv[2] : TUNE_DEFAULT_FILE);
+        return 0;
+    }
+    
+    // "./bicgstab_solver pcg": IC(0)-PCG on the symmetric system vs BICGSTAB
+    if (argc > 1 && strcmp(argv[1], "pcg") == 0) {
+        run_pcg_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver ainv": FSAI / SPAI against IC(0) / ILU(0)
+    if (argc > 1 && strcmp(argv[1], "ainv") == 0) {
+        run_ainv_benchmark();
+        return 0;
+    }
+    
+    // "./bicgstab_solver async": job-queue solve service throughput
+    if (argc > 1 && strcmp(argv[1], "async") == 0) {
+        run_async_benchmark(4, 2);
+        return 0;
+    }
+    
+    // "./bicgstab_solver daemon": request latency through a forked solver daemon
+    if (argc > 1 && strcmp(argv[1], "daemon") == 0) {
+        run_daemon_benchmark(4, 400);
+        return 0;
+    }
+    
+    // "./bicgstab_solver serve <socket>": run the solver daemon until shut down
+    if (argc > 2 && strcmp(argv[1], "serve") == 0) {
+        return solver_daemon_run(argv[2], 4, 10000, 2) == 0 ? 0 : 1;
+    }
+    
     printf("===================================================\n");
     printf("     OpenMP Parallelized BICGSTAB Solver\n");
     printf("     2D Laplace Equation on Unit Square\n");
@@ -0,0 +1,105 @@
+// nested_iteration.c
+// Nested-iteration warm start: solve the same problem on coarser grids
+// and interpolate the result bilinearly to the fine grid as initial guess.
+// The coarse solutions already contain the smooth error components that
+// otherwise take the Krylov method most of its iterations to resolve.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "nested_iteration.h"
+
+// Smallest grid (nodes per direction) worth solving as a coarse level
+#define MIN_COARSE_NODES 5
+
+// Node count of the next coarser grid: halves the spacing count, so odd
+// sizes (2^k + 1) give exactly nested grids
+static int coarsen(int n) {
+    return (n - 1) / 2 + 1;
+}
+
+// Bilinear interpolation between structured grids
+// Node (i, j) sits at x = i/(ny-1), y = j/(nx-1) (see get_node_number)
+void interpolate_bilinear(const double *coarse, int cnx, int cny,
+                          double *fine, int fnx, int fny) {
+    for (int i = 0; i < fny; i++) {
+        // Position in coarse index space along i
+        double ci = (double)i * (cny - 1) / (fny - 1);
+        int i0 = (int)ci;
+        if (i0 > cny - 2) i0 = cny - 2;
+        double wi = ci - i0;
+        
+        for (int j = 0; j < fnx; j++) {
+            double cj = (double)j * (cnx - 1) / (fnx - 1);
+            int j0 = (int)cj;
+            if (j0 > cnx - 2) j0 = cnx - 2;
+            double wj = cj - j0;
+            
+            const double *c0 = coarse + i0 * cnx + j0;   // row i0
+            const double *c1 = c0 + cnx;                 // row i0+1
+            fine[i * fnx + j] = (1.0 - wi) * ((1.0 - wj) * c0[0] + wj * c0[1])
+                              + wi * ((1.0 - wj) * c1[0] + wj * c1[1]);
+        }
+    }
+}
+
+// Dirichlet rows are identity rows: their value is known exactly, so the
+// interpolated guess should not smear the corner discontinuities
+void apply_dirichlet_values(FEMSystem *sys, double *x) {
+    CSRMatrix *A = &sys->A;
+    for (int i = 0; i < A->n; i++) {
+        if (is_dirichlet_row(A, i)) {
+            x[i] = sys->b[i] / A->values[A->row_ptr[i]];
+        }
+    }
+}
+
+// Recursive part: fill sys->x from the next coarser level
+static int nested_level(FEMSystem *sys, int levels, SolverFn solver,
+                        const SolverOptions *coarse_opts, NestedStats *stats) {
+    int cnx = coarsen(sys->nx);
+    int cny = coarsen(sys->ny);
+    if (levels <= 0 || cnx < MIN_COARSE_NODES || cny < MIN_COARSE_NODES) {
+        return 0;
+    }
+    
+    FEMSystem *coarse = create_fem_system(cnx, cny);
+    
+    // Coarse level gets its own warm start from the levels below it
+    int used = nested_level(coarse, levels - 1, solver, coarse_opts, stats);
+    
+    double solve_time;
+    SolverStats coarse_stats;
+    solver(coarse, coarse_opts, &coarse_stats, &solve_time);
+    stats->coarse_iterations += coarse_stats.iterations;
+    
+    interpolate_bilinear(coarse->x, cnx, cny, sys->x, sys->nx, sys->ny);
+    apply_dirichlet_values(sys, sys->x);
+    free_fem_system(coarse);
+    return used + 1;
+}
+
+int nested_initial_guess(FEMSystem *sys, int levels, SolverFn solver,
+                         const SolverOptions *opts, double coarse_tol,
+                         NestedStats *stats) {
+    NestedStats local_stats;
+    NestedStats *st = stats ? stats : &local_stats;
+    st->levels_used = 0;
+    st->coarse_iterations = 0;
+    st->coarse_time = 0.0;
+    
+    // Coarse grids only need to be solved to their discretization error
+    SolverOptions coarse_opts = *opts;
+    coarse_opts.tol = coarse_tol;
+    coarse_opts.verbose = 0;
+    
+    // Operator, preconditioner and ||A^{-1}|| estimate belong to the fine
+    // matrix; the coarse solves use their own CSR matrices, unpreconditioned
+    coarse_opts.op = NULL;
+    coarse_opts.precond = NULL;
+    coarse_opts.error_target = 0.0;
+    
+    double start = wall_time();
+    st->levels_used = nested_level(sys, levels, solver, &coarse_opts, st);
+    st->coarse_time = wall_time() - start;
+    return st->levels_used;
+}
@@ -0,0 +1,35 @@
+// nested_iteration.h
+// Header file for the nested-iteration (full multigrid style) warm start
+// Solves on a hierarchy of coarser grids and interpolates upwards
+
+#ifndef NESTED_ITERATION_H
+#define NESTED_ITERATION_H
+
+#include "fem_matrix.h"
+#include "bicgstab.h"
+
+// Cost of building a warm start
+typedef struct {
+    int levels_used;        // Coarse levels actually solved
+    int coarse_iterations;  // Iterations summed over all coarse levels
+    double coarse_time;     // Assembly + solve + interpolation time (seconds)
+} NestedStats;
+
+// Bilinear interpolation of a nodal field between two structured grids
+// covering the unit square (grids need not be nested)
+void interpolate_bilinear(const double *coarse, int cnx, int cny,
+                          double *fine, int fnx, int fny);
+
+// Sets x[i] = b[i] / a_ii on Dirichlet rows (rows holding only a diagonal)
+void apply_dirichlet_values(FEMSystem *sys, double *x);
+
+// Fills sys->x with an initial guess obtained by solving on up to `levels`
+// successively coarsened grids (each to coarse_tol) and interpolating each
+// solution up as the next level's initial guess. The coarse solves take opts
+// without its op, precond and error_target, which describe the fine matrix
+// Returns the number of coarse levels used (0 = grid too small, x untouched)
+int nested_initial_guess(FEMSystem *sys, int levels, SolverFn solver,
+                         const SolverOptions *opts, double coarse_tol,
+                         NestedStats *stats);
+
+#endif // NESTED_ITERATION_H
@@ -0,0 +1,317 @@
+// parallel_kernels.c
+// OpenMP vector, reduction and SpMV kernels of the parallel solvers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "parallel_kernels.h"
+#include "blas1.h"
+
+ReduceBuffer *reduce_buffer_create(int n) {
+    ReduceBuffer *red = (ReduceBuffer*)malloc(sizeof(ReduceBuffer));
+    red->nblocks = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    red->partials = (double*)malloc(2 * (red->nblocks > 0 ? red->nblocks : 1) * sizeof(double));
+    return red;
+}
+
+void reduce_buffer_free(ReduceBuffer *red) {
+    if (!red) return;
+    free(red->partials);
+    free(red);
+}
+
+// End of block k (blocks start at k * REDUCE_BLOCK)
+int block_end(int k, int n) {
+    int hi = (k + 1) * REDUCE_BLOCK;
+    return hi < n ? hi : n;
+}
+
+// Pairwise sum in an order fixed by m alone
+double tree_sum(const double *v, int m) {
+    if (m <= 0) return 0.0;
+    if (m == 1) return v[0];
+    int half = m / 2;
+    return tree_sum(v, half) + tree_sum(v + half, m - half);
+}
+
+// This thread's slice [*lo, *hi) of 0..n inside a parallel region; slices
+// start on multiples of 8 entries so each one begins vector-aligned
+void thread_range(int n, int *lo, int *hi) {
+    int nt = omp_get_num_threads(), id = omp_get_thread_num();
+    int chunks = (n + 7) / 8;
+    int per = chunks / nt, extra = chunks % nt;
+    int first = id * per + (id < extra ? id : extra);
+    int count = per + (id < extra ? 1 : 0);
+    *lo = first * 8 < n ? first * 8 : n;
+    *hi = (first + count) * 8 < n ? (first + count) * 8 : n;
+}
+
+// Parallel vector dot product (blas1 kernel per slice or per block)
+double dot_product_parallel(double *a, double *b, int n, ReduceBuffer *red) {
+    if (red) {
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < red->nblocks; k++) {
+            int lo = k * REDUCE_BLOCK;
+            red->partials[k] = blas1_dot(a + lo, b + lo, block_end(k, n) - lo);
+        }
+        return tree_sum(red->partials, red->nblocks);
+    }
+    
+    double sum = 0.0;
+    // OpenMP reduction: each thread computes partial sum, then combines
+    #pragma omp parallel reduction(+:sum)
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        sum += blas1_dot(a + lo, b + lo, hi - lo);
+    }
+    return sum;
+}
+
+// Parallel vector copy
+void vector_copy_parallel(double *src, double *dst, int n, int stream) {
+    #pragma omp parallel
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        blas1_copy(src + lo, dst + lo, hi - lo, stream);
+    }
+}
+
+// Parallel y = a*x + y
+void vector_axpy_parallel(double a, double *x, double *y, int n) {
+    #pragma omp parallel
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        blas1_axpy(a, x + lo, y + lo, hi - lo);
+    }
+}
+
+// Parallel z = a*x + b*y
+void vector_axpby_parallel(double a, double *x, double b, double *y, double *z,
+                           int n, int stream) {
+    #pragma omp parallel
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        blas1_axpby(a, x + lo, b, y + lo, z + lo, hi - lo, stream);
+    }
+}
+
+// Parallel fused z = a*x + b*y, returns ||z||^2 (saves a pass for the norm)
+double vector_axpby_norm_parallel(double a, double *x, double b, double *y, double *z,
+                                  int n, int stream, ReduceBuffer *red) {
+    if (red) {
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < red->nblocks; k++) {
+            int lo = k * REDUCE_BLOCK;
+            red->partials[k] = blas1_axpby_norm(a, x + lo, b, y + lo, z + lo,
+                                                block_end(k, n) - lo, stream);
+        }
+        return tree_sum(red->partials, red->nblocks);
+    }
+    
+    double norm2 = 0.0;
+    #pragma omp parallel reduction(+:norm2)
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        norm2 += blas1_axpby_norm(a, x + lo, b, y + lo, z + lo, hi - lo, stream);
+    }
+    return norm2;
+}
+
+// Parallel fused pair of dot products a.b and c.d in one pass
+void dot_product_pair_parallel(double *a, double *b, double *c, double *d,
+                               double *ab_out, double *cd_out, int n, ReduceBuffer *red) {
+    if (red) {
+        int nb = red->nblocks;
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < nb; k++) {
+            int lo = k * REDUCE_BLOCK;
+            blas1_dot2(a + lo, b + lo, c + lo, d + lo, block_end(k, n) - lo,
+                       &red->partials[k], &red->partials[nb + k]);
+        }
+        *ab_out = tree_sum(red->partials, nb);
+        *cd_out = tree_sum(red->partials + nb, nb);
+        return;
+    }
+    
+    double ab = 0.0, cd = 0.0;
+    #pragma omp parallel reduction(+:ab, cd)
+    {
+        int lo, hi;
+        double ab_part, cd_part;
+        thread_range(n, &lo, &hi);
+        blas1_dot2(a + lo, b + lo, c + lo, d + lo, hi - lo, &ab_part, &cd_part);
+        ab += ab_part;
+        cd += cd_part;
+    }
+    *ab_out = ab;
+    *cd_out = cd;
+}
+
+// Parallel vector norm
+double vector_norm_parallel(double *x, int n, ReduceBuffer *red) {
+    return sqrt(dot_product_parallel(x, x, n, red));
+}
+
+// Parallel search direction update
+// p = r + beta*(p - omega*v)
+void update_direction_parallel(double *p, double *r, double *v, double beta, double omega, int n) {
+    #pragma omp parallel
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        blas1_direction(p + lo, r + lo, v + lo, beta, omega, hi - lo);
+    }
+}
+
+// Parallel CSR SpMV y = A*x with w.y fused into the row loop
+// (fixed-order: one partial per block of rows)
+double matvec_csr_dot_parallel(CSRMatrix *A, const SpmvPlan *plan, double *x, double *y,
+                               const double *w, ReduceBuffer *red) {
+    int n = A->n;
+    if (red) {
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < red->nblocks; k++) {
+            red->partials[k] = spmv_csr_dot(plan, A, x, y, w, k * REDUCE_BLOCK, block_end(k, n));
+        }
+        return tree_sum(red->partials, red->nblocks);
+    }
+    
+    double dot = 0.0;
+    #pragma omp parallel reduction(+:dot)
+    {
+        int lo, hi;
+        thread_range(n, &lo, &hi);
+        dot += spmv_csr_dot(plan, A, x, y, w, lo, hi);
+    }
+    return dot;
+}
+
+// Parallel CSR SpMV y = A*x with w.y and y.y fused into the row loop
+void matvec_csr_dot2_parallel(CSRMatrix *A, const SpmvPlan *plan, double *x, double *y,
+                              const double *w, double *wy_out, double *yy_out,
+                              ReduceBuffer *red) {
+    int n = A->n;
+    if (red) {
+        int nb = red->nblocks;
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < nb; k++) {
+            spmv_csr_dot2(plan, A, x, y, w, k * REDUCE_BLOCK, block_end(k, n),
+                          &red->partials[k], &red->partials[nb + k]);
+        }
+        *wy_out = tree_sum(red->partials, nb);
+        *yy_out = tree_sum(red->partials + nb, nb);
+        return;
+    }
+    
+    double wy = 0.0, yy = 0.0;
+    #pragma omp parallel reduction(+:wy, yy)
+    {
+        int lo, hi;
+        double wy_part, yy_part;
+        thread_range(n, &lo, &hi);
+        spmv_csr_dot2(plan, A, x, y, w, lo, hi, &wy_part, &yy_part);
+        wy += wy_part;
+        yy += yy_part;
+    }
+    *wy_out = wy;
+    *yy_out = yy;
+}
+
+// Parallel fused residual: r = b - A*x, returns ||r||^2
+double residual_csr_parallel(CSRMatrix *A, double *x, double *b, double *r,
+                             ReduceBuffer *red) {
+    int n = A->n;
+    if (red) {
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < red->nblocks; k++) {
+            double part = 0.0;
+            for (int i = k * REDUCE_BLOCK; i < block_end(k, n); i++) {
+                double sum = b[i];
+                for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+                    sum -= A->values[j] * x[A->col_idx[j]];
+                }
+                r[i] = sum;
+                part += sum * sum;
+            }
+            red->partials[k] = part;
+        }
+        return tree_sum(red->partials, red->nblocks);
+    }
+    
+    double norm2 = 0.0;
+    #pragma omp parallel for reduction(+:norm2)
+    for (int i = 0; i < n; i++) {
+        double sum = b[i];
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            sum -= A->values[j] * x[A->col_idx[j]];
+        }
+        r[i] = sum;
+        norm2 += sum * sum;
+    }
+    return norm2;
+}
+
+// y = A*x with the solver's operator (opts->op if given, else the CSR matrix),
+// returning w.y from the same pass (operators without apply_dots reduce after)
+double apply_matrix_dot_parallel(const SolverOptions *opts, CSRMatrix *A,
+                                 const SpmvPlan *plan, double *x, double *y, double *w,
+                                 ReduceBuffer *red) {
+    LinearOperator *op = opts->op;
+    if (!op) return matvec_csr_dot_parallel(A, plan, x, y, w, red);
+    if (op->apply_dots && !red) {
+        double dots[2];
+        op->apply_dots(op, x, y, w, dots, 1);
+        return dots[0];
+    }
+    op->apply(op, x, y, 1);
+    return dot_product_parallel(w, y, op->n, red);
+}
+
+// y = A*x with w.y and y.y from the same pass
+void apply_matrix_dot2_parallel(const SolverOptions *opts, CSRMatrix *A,
+                                const SpmvPlan *plan, double *x, double *y, double *w,
+                                double *wy, double *yy, ReduceBuffer *red) {
+    LinearOperator *op = opts->op;
+    if (!op) {
+        matvec_csr_dot2_parallel(A, plan, x, y, w, wy, yy, red);
+        return;
+    }
+    if (op->apply_dots && !red) {
+        double dots[2];
+        op->apply_dots(op, x, y, w, dots, 1);
+        *wy = dots[0];
+        *yy = dots[1];
+        return;
+    }
+    op->apply(op, x, y, 1);
+    dot_product_pair_parallel(w, y, y, y, wy, yy, op->n, red);
+}
+
+// r = b - A*x, returns ||r||^2
+// CSR uses the fused kernel; other operators need tmp for A*x
+double compute_residual_parallel(const SolverOptions *opts, CSRMatrix *A, double *x,
+                                 double *b, double *r, double *tmp, ReduceBuffer *red) {
+    if (!opts->op) {
+        return residual_csr_parallel(A, x, b, r, red);
+    }
+    int n = opts->op->n;
+    opts->op->apply(opts->op, x, tmp, 1);
+    return vector_axpby_norm_parallel(1.0, b, -1.0, tmp, r, n, 0, red);
+}
+
+// Residual replacement: r = b - A*x (fused SpMV + AXPY)
+// Returns the true relative residual ||b - Ax|| / ||b||
+double replace_residual(const SolverOptions *opts, CSRMatrix *A, double *x,
+                        double *b, double *r, double *tmp,
+                        double bnorm, SolverStats *st, ReduceBuffer *red) {
+    double norm2;
+    STATS_TIME(st, replace, norm2 = compute_residual_parallel(opts, A, x, b, r, tmp, red));
+    st->true_residual = sqrt(norm2) / bnorm;
+    return st->true_residual;
+}
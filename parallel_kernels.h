@@ -0,0 +1,102 @@
+// parallel_kernels.h
+// OpenMP kernel layer shared by the parallel solvers (bicgstab_parallel.c,
+// pcg_parallel.c): vector updates and reductions on per-thread slices, CSR
+// SpMV with fused dot products, and residual replacement. Each kernel opens
+// its own parallel region on the current team; with a ReduceBuffer the
+// reductions run in fixed order (opts->deterministic)
+
+#ifndef PARALLEL_KERNELS_H
+#define PARALLEL_KERNELS_H
+
+#include "bicgstab.h"
+
+// Fixed-order reductions (opts->deterministic): vectors are cut into blocks
+// of REDUCE_BLOCK entries, each block is summed sequentially and the block
+// partials are combined in a fixed pairwise tree, so results are bitwise
+// identical for any number of threads
+#define REDUCE_BLOCK 1024
+
+typedef struct {
+    int nblocks;
+    double *partials;       // 2 * nblocks (room for a pair of sums)
+} ReduceBuffer;
+
+// Partials for fixed-order reductions over n entries (free accepts NULL)
+ReduceBuffer *reduce_buffer_create(int n);
+void reduce_buffer_free(ReduceBuffer *red);
+
+// End of block k (blocks start at k * REDUCE_BLOCK)
+int block_end(int k, int n);
+
+// Pairwise sum in an order fixed by m alone
+double tree_sum(const double *v, int m);
+
+// This thread's slice [*lo, *hi) of 0..n inside a parallel region; slices
+// start on multiples of 8 entries so each one begins vector-aligned
+void thread_range(int n, int *lo, int *hi);
+
+// Parallel vector dot product (blas1 kernel per slice or per block)
+double dot_product_parallel(double *a, double *b, int n, ReduceBuffer *red);
+
+// Parallel vector copy
+void vector_copy_parallel(double *src, double *dst, int n, int stream);
+
+// Parallel y = a*x + y
+void vector_axpy_parallel(double a, double *x, double *y, int n);
+
+// Parallel z = a*x + b*y
+void vector_axpby_parallel(double a, double *x, double b, double *y, double *z,
+                           int n, int stream);
+
+// Parallel fused z = a*x + b*y, returns ||z||^2 (saves a pass for the norm)
+double vector_axpby_norm_parallel(double a, double *x, double b, double *y, double *z,
+                                  int n, int stream, ReduceBuffer *red);
+
+// Parallel fused pair of dot products a.b and c.d in one pass
+void dot_product_pair_parallel(double *a, double *b, double *c, double *d,
+                               double *ab_out, double *cd_out, int n, ReduceBuffer *red);
+
+// Parallel vector norm
+double vector_norm_parallel(double *x, int n, ReduceBuffer *red);
+
+// Parallel BICGSTAB search direction update
+// p = r + beta*(p - omega*v)
+void update_direction_parallel(double *p, double *r, double *v, double beta, double omega, int n);
+
+// Parallel CSR SpMV y = A*x with w.y fused into the row loop
+// (fixed-order: one partial per block of rows)
+double matvec_csr_dot_parallel(CSRMatrix *A, const SpmvPlan *plan, double *x, double *y,
+                               const double *w, ReduceBuffer *red);
+
+// Parallel CSR SpMV y = A*x with w.y and y.y fused into the row loop
+void matvec_csr_dot2_parallel(CSRMatrix *A, const SpmvPlan *plan, double *x, double *y,
+                              const double *w, double *wy_out, double *yy_out,
+                              ReduceBuffer *red);
+
+// Parallel fused residual: r = b - A*x, returns ||r||^2
+double residual_csr_parallel(CSRMatrix *A, double *x, double *b, double *r,
+                             ReduceBuffer *red);
+
+// y = A*x with the solver's operator (opts->op if given, else the CSR matrix),
+// returning w.y from the same pass (operators without apply_dots reduce after)
+double apply_matrix_dot_parallel(const SolverOptions *opts, CSRMatrix *A,
+                                 const SpmvPlan *plan, double *x, double *y, double *w,
+                                 ReduceBuffer *red);
+
+// y = A*x with w.y and y.y from the same pass
+void apply_matrix_dot2_parallel(const SolverOptions *opts, CSRMatrix *A,
+                                const SpmvPlan *plan, double *x, double *y, double *w,
+                                double *wy, double *yy, ReduceBuffer *red);
+
+// r = b - A*x, returns ||r||^2
+// CSR uses the fused kernel; other operators need tmp for A*x
+double compute_residual_parallel(const SolverOptions *opts, CSRMatrix *A, double *x,
+                                 double *b, double *r, double *tmp, ReduceBuffer *red);
+
+// Residual replacement: r = b - A*x (fused SpMV + AXPY)
+// Returns the true relative residual ||b - Ax|| / ||b||
+double replace_residual(const SolverOptions *opts, CSRMatrix *A, double *x,
+                        double *b, double *r, double *tmp,
+                        double bnorm, SolverStats *st, ReduceBuffer *red);
+
+#endif // PARALLEL_KERNELS_H
@@ -0,0 +1,22 @@
+// pcg.h
+// Preconditioned conjugate gradients for symmetric positive definite systems
+//
+// The FEM matrix itself is not symmetric (Dirichlet rows are identity rows
+// while the free rows keep their Dirichlet columns); CG needs the copy from
+// fem_system_eliminate_dirichlet. The solver runs on the OpenMP kernel layer
+// of the parallel BICGSTAB solver (parallel_kernels.h) and takes the same
+// SolverOptions: precond must be symmetric positive definite (Jacobi, IC(0)),
+// op must be symmetric
+
+#ifndef PCG_H
+#define PCG_H
+
+#include "bicgstab.h"
+
+// OpenMP parallel PCG; opts->num_threads selects the team size.
+// fused_norms and check_interval do not apply (||r|| is fused into the r
+// update every iteration). Returns: number of iterations, or -1 if failed
+int pcg_parallel_ex(FEMSystem *sys, const SolverOptions *opts,
+                    SolverStats *stats, double *solve_time);
+
+#endif // PCG_H
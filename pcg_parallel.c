@@ -0,0 +1,166 @@
+// pcg_parallel.c
+// OpenMP parallel preconditioned conjugate gradients
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <omp.h>
+#include "pcg.h"
+#include "parallel_kernels.h"
+#include "blas1.h"
+
+// Parallel PCG solver
+// Starts from the guess in sys->x
+// Returns: number of iterations, or -1 if failed
+int pcg_parallel_ex(FEMSystem *sys, const SolverOptions *opts,
+                    SolverStats *stats, double *solve_time) {
+    int n = sys->n;
+    CSRMatrix *A = &sys->A;
+    double *b = sys->b;
+    double *x = sys->x;
+    int max_iter = opts->max_iter;
+    
+    SolverStats local_stats;
+    SolverStats *st = stats ? stats : &local_stats;
+    solver_stats_reset(st);
+    
+    int num_threads = opts->num_threads > 0 ? opts->num_threads : omp_get_max_threads();
+    omp_set_num_threads(num_threads);
+    
+    // Working vectors: caller's workspace if given, otherwise allocate
+    SolverWorkspace *ws = opts->workspace;
+    int own_ws = (ws == NULL || ws->n < n);
+    if (own_ws) ws = solver_workspace_create(n);
+    if (!ws) {
+        *solve_time = 0.0;
+        return -1;
+    }
+    double *r = ws->r;      // residual
+    double *p = ws->p;      // search direction
+    double *q = ws->v;      // A*p
+    double *tmp = ws->t;    // A*x for operator residuals
+    
+    // Without a preconditioner z is r itself, and r.z is the fused ||r||^2
+    Preconditioner *pc = opts->precond;
+    double *z = pc ? ws->s_hat : r;     // M^{-1} r
+    
+    ReduceBuffer *red = opts->deterministic ? reduce_buffer_create(n) : NULL;
+    int stream = blas1_stream(n);
+    
+    SpmvPlan plan;
+    spmv_plan_init(&plan, A, solver_spmv_kernel(opts), opts->prefetch_distance);
+    spmv_plan_set_values(&plan, A, opts->op ? VALUES_FP64 : opts->value_precision, opts->tol);
+    
+    double start = omp_get_wtime();
+    
+    double bnorm;
+    STATS_TIME(st, dot, bnorm = vector_norm_parallel(b, n, red));
+    if (bnorm == 0.0) bnorm = 1.0;
+    
+    double r_norm2;
+    STATS_TIME(st, spmv, r_norm2 = compute_residual_parallel(opts, A, x, b, r, tmp, red));
+    double r_norm = sqrt(r_norm2);
+    double r_norm_ref = r_norm;     // ||r|| at the last replacement
+    
+    StopState stop;
+    double anorm = 0.0;
+    if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+        anorm = opts->op ? operator_norm_estimate(opts->op, q, tmp) : csr_norm_inf(A);
+    }
+    stop_state_init(&stop, bnorm, r_norm, anorm);
+    int check_true = opts->confirm_converged;
+    
+    double rho = 1.0, rho_prev;
+    int restart = 1;    // 1 = take p = z (first iteration or after a replacement)
+    int converged = 0;
+    
+    int iter;
+    for (iter = 0; iter < max_iter; iter++) {
+        // z = M^{-1} r, rho = r.z
+        rho_prev = rho;
+        if (pc) {
+            STATS_TIME(st, precond, precond_apply(pc, r, z, 1));
+            STATS_TIME(st, dot, rho = dot_product_parallel(r, z, n, red));
+        } else {
+            rho = r_norm2;
+        }
+        
+        if (rho <= 0.0) {
+            printf("PCG (parallel): preconditioner not positive definite at iteration %d\n", iter);
+            break;
+        }
+        
+        // p = z + beta*p
+        if (restart) {
+            STATS_TIME(st, axpy, vector_copy_parallel(z, p, n, stream));
+            restart = 0;
+        } else {
+            double beta = rho / rho_prev;
+            STATS_TIME(st, axpy, vector_axpby_parallel(1.0, z, beta, p, p, n, 0));
+        }
+        
+        // q = A*p with p.q fused into the SpMV
+        double pq;
+        STATS_TIME(st, spmv, pq = apply_matrix_dot_parallel(opts, A, &plan, p, q, p, red));
+        if (pq <= 0.0) {
+            printf("PCG (parallel): matrix not positive definite at iteration %d\n", iter);
+            break;
+        }
+        double alpha = rho / pq;
+        
+        // x = x + alpha*p (update energy alpha^2 p.Ap = alpha*rho)
+        STATS_TIME(st, axpy, vector_axpy_parallel(alpha, p, x, n));
+        if (opts->stop_criterion == STOP_ENERGY_ESTIMATE) stop_record_energy(&stop, alpha * rho);
+        
+        // r = r - alpha*q with ||r||^2 folded in
+        STATS_TIME(st, axpy, r_norm2 = vector_axpby_norm_parallel(1.0, r, -alpha, q, r, n, 0, red));
+        r_norm = sqrt(r_norm2);
+        
+        st->recursive_residual = r_norm / bnorm;
+        if (opts->stop_criterion == STOP_BACKWARD_ERROR) {
+            STATS_TIME(st, dot, stop.xnorm = vector_norm_parallel(x, n, red));
+        }
+        if (stop_check(opts, &stop, r_norm, n)) {
+            double res = r_norm / bnorm;
+            if (check_true) {
+                res = replace_residual(opts, A, x, b, r, tmp, bnorm, st, red);
+            }
+            if (!check_true || stop_confirm(opts, &stop, res * bnorm, n)) {
+                if (opts->verbose) {
+                    printf("PCG (parallel, %d threads) converged at iteration %d (residual: %.2e)\n",
+                           num_threads, iter+1, res);
+                }
+                converged = 1;
+                iter++;
+                break;
+            }
+            r_norm2 = res * bnorm * res * bnorm;
+            r_norm_ref = res * bnorm;
+            restart = 1;
+            continue;
+        }
+        
+        // Periodic or drift-triggered residual replacement
+        if ((opts->replace_interval > 0 && (iter+1) % opts->replace_interval == 0) ||
+            (opts->replace_drift > 0.0 && r_norm < opts->replace_drift * r_norm_ref)) {
+            r_norm_ref = replace_residual(opts, A, x, b, r, tmp, bnorm, st, red) * bnorm;
+            r_norm2 = r_norm_ref * r_norm_ref;
+        }
+    }
+    
+    *solve_time = omp_get_wtime() - start;
+    st->iterations = iter;
+    st->stop_value = stop.value;
+    
+    spmv_plan_free(&plan);
+    if (own_ws) solver_workspace_free(ws);
+    reduce_buffer_free(red);
+    
+    if (!converged && iter >= max_iter) {
+        printf("PCG (parallel) did not converge within %d iterations\n", max_iter);
+        return -1;
+    }
+    
+    return iter;
+}
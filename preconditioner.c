@@ -0,0 +1,883 @@
+// preconditioner.c
+// Jacobi, ILU(0), IC(0), FSAI and SPAI preconditioners with symbolic /
+// numeric phases
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "preconditioner.h"
+#include "bicgstab.h"
+
+// ---------------------------------------------------------------
+// Jacobi
+// ---------------------------------------------------------------
+
+typedef struct {
+    int *diag_pos;          // CSR position of a_ii (symbolic)
+    double *inv_diag;       // 1 / a_ii (numeric)
+} JacobiData;
+
+static void jacobi_update(Preconditioner *pc, CSRMatrix *A) {
+    JacobiData *d = (JacobiData*)pc->data;
+    #pragma omp parallel for
+    for (int i = 0; i < pc->n; i++) {
+        double diag = d->diag_pos[i] >= 0 ? A->values[d->diag_pos[i]] : 0.0;
+        d->inv_diag[i] = diag != 0.0 ? 1.0 / diag : 1.0;
+    }
+}
+
+static void jacobi_apply(Preconditioner *pc, const double *r, double *z, int parallel) {
+    JacobiData *d = (JacobiData*)pc->data;
+    #pragma omp parallel for if (parallel)
+    for (int i = 0; i < pc->n; i++) {
+        z[i] = d->inv_diag[i] * r[i];
+    }
+}
+
+static void jacobi_destroy(Preconditioner *pc) {
+    JacobiData *d = (JacobiData*)pc->data;
+    free(d->diag_pos);
+    free(d->inv_diag);
+    free(d);
+}
+
+// Position of the diagonal entry in each row (-1 if structurally zero)
+static int* find_diagonal(CSRMatrix *A) {
+    int *diag_pos = (int*)malloc(A->n * sizeof(int));
+    for (int i = 0; i < A->n; i++) {
+        diag_pos[i] = -1;
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            if (A->col_idx[k] == i) diag_pos[i] = k;
+        }
+    }
+    return diag_pos;
+}
+
+Preconditioner* precond_create_jacobi(CSRMatrix *A) {
+    Preconditioner *pc = (Preconditioner*)calloc(1, sizeof(Preconditioner));
+    JacobiData *d = (JacobiData*)malloc(sizeof(JacobiData));
+    pc->name = "Jacobi";
+    pc->n = A->n;
+    pc->data = d;
+    pc->update_numeric = jacobi_update;
+    pc->apply = jacobi_apply;
+    pc->destroy = jacobi_destroy;
+    
+    double start = wall_time();
+    d->diag_pos = find_diagonal(A);
+    d->inv_diag = (double*)malloc(A->n * sizeof(double));
+    pc->symbolic_time = wall_time() - start;
+    
+    precond_update_numeric(pc, A);
+    return pc;
+}
+
+// ---------------------------------------------------------------
+// ILU(0)
+// ---------------------------------------------------------------
+
+typedef struct {
+    CSRMatrix LU;           // Factors on the pattern of A (L unit lower, U upper)
+    int *diag_pos;          // Diagonal position per row
+    int *lower_ptr;         // Row i eliminates entries lower_pos[lower_ptr[i]..lower_ptr[i+1])
+    int *lower_pos;         // Position of l_ik, in increasing k
+    int *update_ptr;        // Updates for each lower entry: update_ptr[m]..update_ptr[m+1]
+    int *update_src;        // Position of u_kj
+    int *update_dst;        // Position of a_ij (j in row i, j > k)
+} ILU0Data;
+
+// Numeric factorization: a flat replay of the recorded updates
+//   l_ik = a_ik / u_kk,  a_ij -= l_ik * u_kj
+// Rows depend on earlier rows, so this phase runs sequentially
+static void ilu0_update(Preconditioner *pc, CSRMatrix *A) {
+    ILU0Data *d = (ILU0Data*)pc->data;
+    double *lu = d->LU.values;
+    memcpy(lu, A->values, A->nnz * sizeof(double));
+    
+    for (int i = 0; i < pc->n; i++) {
+        for (int m = d->lower_ptr[i]; m < d->lower_ptr[i+1]; m++) {
+            int pos_ik = d->lower_pos[m];
+            int k = d->LU.col_idx[pos_ik];
+            double l_ik = lu[pos_ik] / lu[d->diag_pos[k]];
+            lu[pos_ik] = l_ik;
+            for (int u = d->update_ptr[m]; u < d->update_ptr[m+1]; u++) {
+                lu[d->update_dst[u]] -= l_ik * lu[d->update_src[u]];
+            }
+        }
+    }
+}
+
+// Forward (L y = r) and backward (U z = y) substitution
+static void ilu0_apply(Preconditioner *pc, const double *r, double *z, int parallel) {
+    (void)parallel;     // Triangular solves are sequential
+    ILU0Data *d = (ILU0Data*)pc->data;
+    CSRMatrix *LU = &d->LU;
+    
+    for (int i = 0; i < pc->n; i++) {
+        double sum = r[i];
+        for (int k = LU->row_ptr[i]; k < LU->row_ptr[i+1]; k++) {
+            if (LU->col_idx[k] < i) sum -= LU->values[k] * z[LU->col_idx[k]];
+        }
+        z[i] = sum;
+    }
+    for (int i = pc->n - 1; i >= 0; i--) {
+        double sum = z[i];
+        for (int k = LU->row_ptr[i]; k < LU->row_ptr[i+1]; k++) {
+            if (LU->col_idx[k] > i) sum -= LU->values[k] * z[LU->col_idx[k]];
+        }
+        z[i] = sum / LU->values[d->diag_pos[i]];
+    }
+}
+
+static void ilu0_destroy(Preconditioner *pc) {
+    ILU0Data *d = (ILU0Data*)pc->data;
+    free_csr_matrix(&d->LU);
+    free(d->diag_pos);
+    free(d->lower_ptr);
+    free(d->lower_pos);
+    free(d->update_ptr);
+    free(d->update_src);
+    free(d->update_dst);
+    free(d);
+}
+
+Preconditioner* precond_create_ilu0(CSRMatrix *A) {
+    Preconditioner *pc = (Preconditioner*)calloc(1, sizeof(Preconditioner));
+    ILU0Data *d = (ILU0Data*)malloc(sizeof(ILU0Data));
+    pc->name = "ILU(0)";
+    pc->n = A->n;
+    pc->data = d;
+    pc->update_numeric = ilu0_update;
+    pc->apply = ilu0_apply;
+    pc->destroy = ilu0_destroy;
+    
+    double start = wall_time();
+    int n = A->n;
+    
+    // Factors share the pattern of A
+    d->LU.n = n;
+    d->LU.nnz = A->nnz;
+    d->LU.row_ptr = (int*)malloc((n + 1) * sizeof(int));
+    d->LU.col_idx = (int*)malloc(A->nnz * sizeof(int));
+    d->LU.values = (double*)malloc(A->nnz * sizeof(double));
+    memcpy(d->LU.row_ptr, A->row_ptr, (n + 1) * sizeof(int));
+    memcpy(d->LU.col_idx, A->col_idx, A->nnz * sizeof(int));
+    d->diag_pos = find_diagonal(A);
+    
+    // Lower entries per row, sorted by column (rows need not be sorted)
+    d->lower_ptr = (int*)malloc((n + 1) * sizeof(int));
+    d->lower_pos = (int*)malloc(A->nnz * sizeof(int));
+    int num_lower = 0;
+    d->lower_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        int first = num_lower;
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            if (A->col_idx[k] >= i) continue;
+            // Insertion sort by column
+            int m = num_lower++;
+            while (m > first && A->col_idx[d->lower_pos[m-1]] > A->col_idx[k]) {
+                d->lower_pos[m] = d->lower_pos[m-1];
+                m--;
+            }
+            d->lower_pos[m] = k;
+        }
+        d->lower_ptr[i + 1] = num_lower;
+    }
+    
+    // Updates a_ij -= l_ik * u_kj for j > k present in row i (ILU(0) drops the rest)
+    int *pos_in_row = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) pos_in_row[i] = -1;
+    int capacity = A->nnz;
+    d->update_ptr = (int*)malloc((num_lower + 1) * sizeof(int));
+    d->update_src = (int*)malloc(capacity * sizeof(int));
+    d->update_dst = (int*)malloc(capacity * sizeof(int));
+    int num_updates = 0;
+    d->update_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            pos_in_row[A->col_idx[k]] = k;
+        }
+        for (int m = d->lower_ptr[i]; m < d->lower_ptr[i+1]; m++) {
+            int k = A->col_idx[d->lower_pos[m]];
+            for (int q = A->row_ptr[k]; q < A->row_ptr[k+1]; q++) {
+                int j = A->col_idx[q];
+                if (j <= k || pos_in_row[j] < 0) continue;
+                if (num_updates == capacity) {
+                    capacity *= 2;
+                    d->update_src = (int*)realloc(d->update_src, capacity * sizeof(int));
+                    d->update_dst = (int*)realloc(d->update_dst, capacity * sizeof(int));
+                }
+                d->update_src[num_updates] = q;
+                d->update_dst[num_updates] = pos_in_row[j];
+                num_updates++;
+            }
+            d->update_ptr[m + 1] = num_updates;
+        }
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            pos_in_row[A->col_idx[k]] = -1;
+        }
+    }
+    free(pos_in_row);
+    pc->symbolic_time = wall_time() - start;
+    
+    precond_update_numeric(pc, A);
+    return pc;
+}
+
+// ---------------------------------------------------------------
+// IC(0)
+// ---------------------------------------------------------------
+
+// Rows of one triangular solve grouped by level: a row depends only on rows
+// of earlier levels, so the rows of a level can be solved in any order
+typedef struct {
+    int num_levels;
+    int *level_ptr;         // Level l holds rows[level_ptr[l]..level_ptr[l+1])
+    int *rows;
+} LevelSchedule;
+
+typedef struct {
+    CSRMatrix L;            // Lower factor, columns sorted, diagonal last in each row
+    CSRMatrix U;            // L^T by rows, diagonal first
+    int *src;               // Position in A of each L entry (-1: diagonal A lacks)
+    int *upper_pos;         // Position in U of each L entry
+    double *inv_diag;       // 1 / l_ii
+    LevelSchedule lower, upper;
+    double shift;           // Diagonal shift of the last factorization (-1: failed)
+} IC0Data;
+
+// Shift of the first retry and the largest one tried. A matrix with a
+// positive diagonal is diagonally dominant long before the cap; past it (or
+// with a diagonal that is not positive, which no shift fixes) IC(0) fails
+#define IC0_FIRST_SHIFT 1e-3
+#define IC0_MAX_SHIFT 1e3
+
+// Pattern of T^T by rows in Tt (values allocated, not filled); returns the
+// position in Tt of each entry of T. Row j of Tt lists the rows of T that
+// hold column j, in increasing order
+static int* transpose_pattern(const CSRMatrix *T, CSRMatrix *Tt) {
+    int n = T->n, nnz = T->nnz;
+    Tt->n = n;
+    Tt->nnz = nnz;
+    Tt->row_ptr = (int*)calloc(n + 1, sizeof(int));
+    Tt->col_idx = (int*)malloc(nnz * sizeof(int));
+    Tt->values = (double*)malloc(nnz * sizeof(double));
+    int *pos = (int*)malloc(nnz * sizeof(int));
+    for (int k = 0; k < nnz; k++) Tt->row_ptr[T->col_idx[k] + 1]++;
+    for (int i = 0; i < n; i++) Tt->row_ptr[i + 1] += Tt->row_ptr[i];
+    int *fill = (int*)malloc(n * sizeof(int));
+    memcpy(fill, Tt->row_ptr, n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        for (int k = T->row_ptr[i]; k < T->row_ptr[i+1]; k++) {
+            int p = fill[T->col_idx[k]]++;
+            Tt->col_idx[p] = i;
+            pos[k] = p;
+        }
+    }
+    free(fill);
+    return pos;
+}
+
+// Levels of a triangular solve: level(i) = 1 + max level of the rows it uses
+// (rows visited from first to last, or from last to first for L^T)
+static void level_schedule_build(LevelSchedule *ls, CSRMatrix *T, int backward) {
+    int n = T->n;
+    int *level = (int*)malloc(n * sizeof(int));
+    ls->num_levels = 0;
+    for (int step = 0; step < n; step++) {
+        int i = backward ? n - 1 - step : step;
+        int l = 0;
+        for (int k = T->row_ptr[i]; k < T->row_ptr[i+1]; k++) {
+            int j = T->col_idx[k];
+            if (j != i && level[j] + 1 > l) l = level[j] + 1;
+        }
+        level[i] = l;
+        if (l + 1 > ls->num_levels) ls->num_levels = l + 1;
+    }
+    
+    // Counting sort of the rows by level (ascending row order within a level)
+    ls->level_ptr = (int*)calloc(ls->num_levels + 1, sizeof(int));
+    ls->rows = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) ls->level_ptr[level[i] + 1]++;
+    for (int l = 0; l < ls->num_levels; l++) ls->level_ptr[l + 1] += ls->level_ptr[l];
+    int *fill = (int*)malloc(ls->num_levels * sizeof(int));
+    memcpy(fill, ls->level_ptr, ls->num_levels * sizeof(int));
+    for (int i = 0; i < n; i++) ls->rows[fill[level[i]]++] = i;
+    free(fill);
+    free(level);
+}
+
+static void level_schedule_free(LevelSchedule *ls) {
+    free(ls->level_ptr);
+    free(ls->rows);
+}
+
+// One IC(0) factorization of A + shift * diag(A) (row by row:
+//   l_ik = (a_ik - sum_{j<k} l_ij l_kj) / l_kk,  l_ii = sqrt(a_ii - sum_{j<i} l_ij^2)
+// with the sums over the pattern). Returns 0 if a pivot was not positive
+static int ic0_factor(IC0Data *d, CSRMatrix *A, double shift) {
+    CSRMatrix *L = &d->L;
+    for (int i = 0; i < L->n; i++) {
+        int first = L->row_ptr[i], diag = L->row_ptr[i+1] - 1;
+        for (int m = first; m <= diag; m++) {
+            L->values[m] = d->src[m] >= 0 ? A->values[d->src[m]] : 0.0;
+        }
+        L->values[diag] *= 1.0 + shift;
+        double a_ii = L->values[diag];
+        
+        for (int m = first; m < diag; m++) {
+            // Sparse dot of row i and row k over columns below k (both sorted)
+            int k = L->col_idx[m];
+            int p = first, q = L->row_ptr[k], q_end = L->row_ptr[k+1] - 1;
+            double sum = L->values[m];
+            while (p < m && q < q_end) {
+                if (L->col_idx[p] < L->col_idx[q]) p++;
+                else if (L->col_idx[p] > L->col_idx[q]) q++;
+                else sum -= L->values[p++] * L->values[q++];
+            }
+            L->values[m] = sum * d->inv_diag[k];
+        }
+        double pivot = a_ii;
+        for (int m = first; m < diag; m++) pivot -= L->values[m] * L->values[m];
+        if (!(pivot > 1e-12 * fabs(a_ii))) return 0;
+        L->values[diag] = sqrt(pivot);
+        d->inv_diag[i] = 1.0 / L->values[diag];
+    }
+    return 1;
+}
+
+// Numeric factorization; a pivot that is not positive restarts it with a
+// diagonal shift of IC0_FIRST_SHIFT * diag(A), doubled until every pivot is
+// or the shift passes IC0_MAX_SHIFT. On failure shift is -1 and the apply
+// is the identity
+static void ic0_update(Preconditioner *pc, CSRMatrix *A) {
+    IC0Data *d = (IC0Data*)pc->data;
+    int positive = 1;
+    for (int i = 0; i < pc->n && positive; i++) {
+        int diag = d->L.row_ptr[i+1] - 1;
+        positive = d->src[diag] >= 0 && A->values[d->src[diag]] > 0.0;
+    }
+    d->shift = 0.0;
+    while (positive && !ic0_factor(d, A, d->shift)) {
+        d->shift = d->shift > 0.0 ? 2.0 * d->shift : IC0_FIRST_SHIFT;
+        if (d->shift > IC0_MAX_SHIFT) positive = 0;
+    }
+    if (!positive) {
+        d->shift = -1.0;
+        return;
+    }
+    for (int m = 0; m < d->L.nnz; m++) {
+        d->U.values[d->upper_pos[m]] = d->L.values[m];
+    }
+}
+
+// Forward (L y = r) and backward (L^T z = y) substitution. In parallel the
+// rows of each level are shared by the team, one barrier per level
+static void ic0_apply(Preconditioner *pc, const double *r, double *z, int parallel) {
+    IC0Data *d = (IC0Data*)pc->data;
+    CSRMatrix *L = &d->L, *U = &d->U;
+    const double *inv_diag = d->inv_diag;
+    
+    if (d->shift < 0.0) {
+        memcpy(z, r, pc->n * sizeof(double));
+        return;
+    }
+    if (!parallel || omp_get_max_threads() == 1) {
+        for (int i = 0; i < pc->n; i++) {
+            double sum = r[i];
+            for (int k = L->row_ptr[i]; k < L->row_ptr[i+1] - 1; k++) {
+                sum -= L->values[k] * z[L->col_idx[k]];
+            }
+            z[i] = sum * inv_diag[i];
+        }
+        for (int i = pc->n - 1; i >= 0; i--) {
+            double sum = z[i];
+            for (int k = U->row_ptr[i] + 1; k < U->row_ptr[i+1]; k++) {
+                sum -= U->values[k] * z[U->col_idx[k]];
+            }
+            z[i] = sum * inv_diag[i];
+        }
+        return;
+    }
+    
+    #pragma omp parallel
+    {
+        for (int l = 0; l < d->lower.num_levels; l++) {
+            #pragma omp for schedule(static)
+            for (int m = d->lower.level_ptr[l]; m < d->lower.level_ptr[l+1]; m++) {
+                int i = d->lower.rows[m];
+                double sum = r[i];
+                for (int k = L->row_ptr[i]; k < L->row_ptr[i+1] - 1; k++) {
+                    sum -= L->values[k] * z[L->col_idx[k]];
+                }
+                z[i] = sum * inv_diag[i];
+            }
+        }
+        for (int l = 0; l < d->upper.num_levels; l++) {
+            #pragma omp for schedule(static)
+            for (int m = d->upper.level_ptr[l]; m < d->upper.level_ptr[l+1]; m++) {
+                int i = d->upper.rows[m];
+                double sum = z[i];
+                for (int k = U->row_ptr[i] + 1; k < U->row_ptr[i+1]; k++) {
+                    sum -= U->values[k] * z[U->col_idx[k]];
+                }
+                z[i] = sum * inv_diag[i];
+            }
+        }
+    }
+}
+
+static void ic0_destroy(Preconditioner *pc) {
+    IC0Data *d = (IC0Data*)pc->data;
+    free_csr_matrix(&d->L);
+    free_csr_matrix(&d->U);
+    free(d->src);
+    free(d->upper_pos);
+    free(d->inv_diag);
+    level_schedule_free(&d->lower);
+    level_schedule_free(&d->upper);
+    free(d);
+}
+
+Preconditioner* precond_create_ic0(CSRMatrix *A) {
+    Preconditioner *pc = (Preconditioner*)calloc(1, sizeof(Preconditioner));
+    IC0Data *d = (IC0Data*)calloc(1, sizeof(IC0Data));
+    pc->name = "IC(0)";
+    pc->n = A->n;
+    pc->data = d;
+    pc->update_numeric = ic0_update;
+    pc->apply = ic0_apply;
+    pc->destroy = ic0_destroy;
+    
+    double start = wall_time();
+    int n = A->n;
+    
+    // L: the entries of A with col < row sorted by column, then the diagonal
+    // (always present in the pattern, even where A has none)
+    int nnz = n;
+    for (int i = 0; i < n; i++) {
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            if (A->col_idx[k] < i) nnz++;
+        }
+    }
+    CSRMatrix *L = &d->L;
+    L->n = n;
+    L->nnz = nnz;
+    L->row_ptr = (int*)malloc((n + 1) * sizeof(int));
+    L->col_idx = (int*)malloc(nnz * sizeof(int));
+    L->values = (double*)malloc(nnz * sizeof(double));
+    d->src = (int*)malloc(nnz * sizeof(int));
+    int m = 0;
+    L->row_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        int first = m, diag_src = -1;
+        for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+            int c = A->col_idx[k];
+            if (c == i) diag_src = k;
+            if (c >= i) continue;
+            // Insertion sort by column
+            int q = m++;
+            while (q > first && L->col_idx[q-1] > c) {
+                L->col_idx[q] = L->col_idx[q-1];
+                d->src[q] = d->src[q-1];
+                q--;
+            }
+            L->col_idx[q] = c;
+            d->src[q] = k;
+        }
+        L->col_idx[m] = i;
+        d->src[m] = diag_src;
+        m++;
+        L->row_ptr[i + 1] = m;
+    }
+    
+    // U = L^T, diagonal first since the rows of L are visited in increasing order
+    d->upper_pos = transpose_pattern(L, &d->U);
+    
+    d->inv_diag = (double*)malloc(n * sizeof(double));
+    level_schedule_build(&d->lower, L, 0);
+    level_schedule_build(&d->upper, &d->U, 1);
+    pc->symbolic_time = wall_time() - start;
+    
+    precond_update_numeric(pc, A);
+    if (d->shift < 0.0) {
+        fprintf(stderr, "precond_create_ic0: no positive factorization (diagonal not positive, "
+                "or shift above %g)\n", IC0_MAX_SHIFT);
+        precond_free(pc);
+        return NULL;
+    }
+    return pc;
+}
+
+void precond_ic0_info(const Preconditioner *pc, double *shift, int *levels) {
+    const IC0Data *d = (const IC0Data*)pc->data;
+    *shift = d->shift;
+    *levels = d->lower.num_levels;
+}
+
+// ---------------------------------------------------------------
+// Approximate inverses: FSAI and SPAI
+// ---------------------------------------------------------------
+
+// FSAI computes the rows of G and copies them into G^T; SPAI computes the
+// columns of M (rows of M^T, from the rows of A^T) and copies them into M
+typedef struct {
+    CSRMatrix M;            // Applied first: SPAI M ~ A^{-1}, FSAI G (lower triangular)
+    CSRMatrix Mt;           // M^T by rows
+    CSRMatrix At;           // SPAI: A^T by rows
+    int *at_pos;            // SPAI: position in At of each entry of A
+    int *copy_pos;          // FSAI: position in Mt of each G entry; SPAI: in M of each Mt entry
+    double *tmp;            // FSAI: G r
+    int factorized;         // 1 = FSAI (z = G^T G r), 0 = SPAI (z = M r)
+    int max_cols;           // Longest computed pattern row
+    int max_rows;           // SPAI: longest least-squares column
+} AinvData;
+
+// Pattern of A^power (plus the diagonal) with sorted columns; lower = 1
+// keeps only columns <= row. Values are allocated, not filled
+static CSRMatrix pattern_power(CSRMatrix *A, int power, int lower) {
+    int n = A->n;
+    CSRMatrix P;
+    P.n = n;
+    P.row_ptr = (int*)malloc((n + 1) * sizeof(int));
+    int capacity = 2 * A->nnz + n;
+    P.col_idx = (int*)malloc(capacity * sizeof(int));
+    int *mark = (int*)malloc(n * sizeof(int));
+    int *list = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) mark[i] = -1;
+    
+    int nnz = 0;
+    P.row_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        // Row i of A^p: columns reachable from i in at most p steps
+        int count = 0;
+        mark[i] = i;
+        list[count++] = i;
+        for (int step = 0; step < power; step++) {
+            int end = count;
+            for (int t = 0; t < end; t++) {
+                int c = list[t];
+                for (int k = A->row_ptr[c]; k < A->row_ptr[c+1]; k++) {
+                    int q = A->col_idx[k];
+                    if (mark[q] != i) {
+                        mark[q] = i;
+                        list[count++] = q;
+                    }
+                }
+            }
+        }
+        if (nnz + count > capacity) {
+            capacity = 2 * (nnz + count);
+            P.col_idx = (int*)realloc(P.col_idx, capacity * sizeof(int));
+        }
+        int first = nnz;
+        for (int t = 0; t < count; t++) {
+            int c = list[t];
+            if (lower && c > i) continue;
+            // Insertion sort by column
+            int q = nnz++;
+            while (q > first && P.col_idx[q-1] > c) {
+                P.col_idx[q] = P.col_idx[q-1];
+                q--;
+            }
+            P.col_idx[q] = c;
+        }
+        P.row_ptr[i + 1] = nnz;
+    }
+    free(mark);
+    free(list);
+    P.nnz = nnz;
+    P.col_idx = (int*)realloc(P.col_idx, (nnz > 0 ? nnz : 1) * sizeof(int));
+    P.values = (double*)malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+    return P;
+}
+
+// Least squares min ||B x - rhs|| by Householder QR (B is rows x cols,
+// column-major, rows >= cols; B and rhs are overwritten, x = rhs[0..cols)).
+// rdiag holds cols scratch entries. Returns 0 if B is (nearly) rank deficient
+static int dense_least_squares(double *B, int rows, int cols, double *rhs, double *rdiag) {
+    double bmax = 0.0;
+    for (long e = 0; e < (long)rows * cols; e++) bmax = fmax(bmax, fabs(B[e]));
+    for (int c = 0; c < cols; c++) {
+        double *v = B + (long)c * rows;
+        double norm2 = 0.0;
+        for (int r = c; r < rows; r++) norm2 += v[r] * v[r];
+        double norm = sqrt(norm2);
+        if (norm <= 1e-12 * bmax) return 0;
+        
+        // Reflector v = x - alpha e_c maps column c to alpha e_c
+        double alpha = v[c] > 0.0 ? -norm : norm;
+        double vv = norm2 - v[c] * v[c];
+        v[c] -= alpha;
+        vv += v[c] * v[c];
+        rdiag[c] = alpha;
+        for (int k = c + 1; k < cols; k++) {
+            double *b = B + (long)k * rows;
+            double f = 0.0;
+            for (int r = c; r < rows; r++) f += v[r] * b[r];
+            f *= 2.0 / vv;
+            for (int r = c; r < rows; r++) b[r] -= f * v[r];
+        }
+        double f = 0.0;
+        for (int r = c; r < rows; r++) f += v[r] * rhs[r];
+        f *= 2.0 / vv;
+        for (int r = c; r < rows; r++) rhs[r] -= f * v[r];
+    }
+    // R x = Q^T rhs
+    for (int c = cols - 1; c >= 0; c--) {
+        double sum = rhs[c];
+        for (int k = c + 1; k < cols; k++) sum -= B[(long)k * rows + c] * rhs[k];
+        rhs[c] = sum / rdiag[c];
+    }
+    return 1;
+}
+
+// Diagonal entry of row i (0 if absent)
+static double diagonal_value(CSRMatrix *A, int i) {
+    for (int k = A->row_ptr[i]; k < A->row_ptr[i+1]; k++) {
+        if (A->col_idx[k] == i) return A->values[k];
+    }
+    return 0.0;
+}
+
+// Per-thread scratch for the row problems
+typedef struct {
+    int *where;             // Column -> local index (-1 = not in the set), size n
+    int *set;               // Columns of the current local set
+    double *B, *rhs, *rdiag;
+} AinvScratch;
+
+// SPAI column i: m_i minimizes ||A m_i - e_i|| with m_i on the pattern J
+// (row i of Mt). Only the rows I of A that columns J touch are nonzero, so
+// the problem is the |I| x |J| block B[r][c] = A(I_r, J_c) = At(J_c, I_r)
+static void spai_column(AinvData *d, CSRMatrix *At, int i, AinvScratch *w) {
+    CSRMatrix *Mt = &d->Mt;
+    const int *J = &Mt->col_idx[Mt->row_ptr[i]];
+    int nj = Mt->row_ptr[i+1] - Mt->row_ptr[i];
+    double *m = &Mt->values[Mt->row_ptr[i]];
+    
+    int ni = 0;
+    for (int c = 0; c < nj; c++) {
+        for (int k = At->row_ptr[J[c]]; k < At->row_ptr[J[c]+1]; k++) {
+            int q = At->col_idx[k];
+            if (w->where[q] < 0) {
+                w->where[q] = ni;
+                w->set[ni++] = q;
+            }
+        }
+    }
+    memset(w->B, 0, (long)ni * nj * sizeof(double));
+    memset(w->rhs, 0, ni * sizeof(double));
+    for (int c = 0; c < nj; c++) {
+        for (int k = At->row_ptr[J[c]]; k < At->row_ptr[J[c]+1]; k++) {
+            w->B[(long)c * ni + w->where[At->col_idx[k]]] += At->values[k];
+        }
+    }
+    int ok = ni >= nj && w->where[i] >= 0;
+    if (ok) {
+        w->rhs[w->where[i]] = 1.0;
+        ok = dense_least_squares(w->B, ni, nj, w->rhs, w->rdiag);
+    }
+    for (int r = 0; r < ni; r++) w->where[w->set[r]] = -1;
+    
+    // Singular block: Jacobi column instead
+    double diag = diagonal_value(At, i);
+    for (int c = 0; c < nj; c++) {
+        m[c] = ok ? w->rhs[c] : (J[c] == i && diag != 0.0 ? 1.0 / diag : 0.0);
+    }
+}
+
+// FSAI row i: solve A(J,J) y = e_i on the lower pattern row J (i last),
+// then g_i = y / sqrt(y_i), which makes diag(G A G^T) = 1
+static void fsai_row(AinvData *d, CSRMatrix *A, int i, AinvScratch *w) {
+    CSRMatrix *G = &d->M;
+    const int *J = &G->col_idx[G->row_ptr[i]];
+    int nj = G->row_ptr[i+1] - G->row_ptr[i];
+    double *g = &G->values[G->row_ptr[i]];
+    
+    for (int c = 0; c < nj; c++) w->where[J[c]] = c;
+    memset(w->B, 0, (long)nj * nj * sizeof(double));
+    for (int r = 0; r < nj; r++) {
+        for (int k = A->row_ptr[J[r]]; k < A->row_ptr[J[r]+1]; k++) {
+            int c = w->where[A->col_idx[k]];
+            if (c >= 0) w->B[(long)c * nj + r] += A->values[k];
+        }
+        w->rhs[r] = 0.0;
+    }
+    w->rhs[nj - 1] = 1.0;
+    int ok = dense_least_squares(w->B, nj, nj, w->rhs, w->rdiag) && w->rhs[nj - 1] > 0.0;
+    for (int c = 0; c < nj; c++) w->where[J[c]] = -1;
+    
+    // Not positive definite on J: scaled identity row instead
+    double diag = fabs(diagonal_value(A, i));
+    double scale = ok ? 1.0 / sqrt(w->rhs[nj - 1]) : 0.0;
+    for (int c = 0; c < nj; c++) {
+        g[c] = ok ? w->rhs[c] * scale : (J[c] == i ? 1.0 / sqrt(diag > 0.0 ? diag : 1.0) : 0.0);
+    }
+}
+
+// Numeric phase: one small dense problem per row, rows shared by the team
+static void ainv_update(Preconditioner *pc, CSRMatrix *A) {
+    AinvData *d = (AinvData*)pc->data;
+    int n = pc->n;
+    int rows = d->factorized ? d->max_cols : d->max_rows;
+    if (!d->factorized) {
+        for (int k = 0; k < A->nnz; k++) d->At.values[d->at_pos[k]] = A->values[k];
+    }
+    
+    #pragma omp parallel
+    {
+        AinvScratch w;
+        w.where = (int*)malloc(n * sizeof(int));
+        w.set = (int*)malloc((rows > 0 ? rows : 1) * sizeof(int));
+        w.B = (double*)malloc(((long)rows * d->max_cols + 1) * sizeof(double));
+        w.rhs = (double*)malloc((rows + 1) * sizeof(double));
+        w.rdiag = (double*)malloc((d->max_cols + 1) * sizeof(double));
+        for (int i = 0; i < n; i++) w.where[i] = -1;
+        
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < n; i++) {
+            if (d->factorized) fsai_row(d, A, i, &w);
+            else spai_column(d, &d->At, i, &w);
+        }
+        free(w.where);
+        free(w.set);
+        free(w.B);
+        free(w.rhs);
+        free(w.rdiag);
+    }
+    
+    CSRMatrix *from = d->factorized ? &d->M : &d->Mt;
+    CSRMatrix *to = d->factorized ? &d->Mt : &d->M;
+    for (int k = 0; k < from->nnz; k++) to->values[d->copy_pos[k]] = from->values[k];
+}
+
+// z = M r (SPAI) or z = G^T (G r) (FSAI): sparse products only
+static void ainv_apply(Preconditioner *pc, const double *r, double *z, int parallel) {
+    AinvData *d = (AinvData*)pc->data;
+    CSRMatrix *M = &d->M;
+    double *y = d->factorized ? d->tmp : z;
+    
+    #pragma omp parallel if (parallel)
+    {
+        #pragma omp for schedule(static)
+        for (int i = 0; i < pc->n; i++) {
+            double sum = 0.0;
+            for (int k = M->row_ptr[i]; k < M->row_ptr[i+1]; k++) {
+                sum += M->values[k] * r[M->col_idx[k]];
+            }
+            y[i] = sum;
+        }
+        if (d->factorized) {
+            CSRMatrix *Mt = &d->Mt;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < pc->n; i++) {
+                double sum = 0.0;
+                for (int k = Mt->row_ptr[i]; k < Mt->row_ptr[i+1]; k++) {
+                    sum += Mt->values[k] * y[Mt->col_idx[k]];
+                }
+                z[i] = sum;
+            }
+        }
+    }
+}
+
+static void ainv_destroy(Preconditioner *pc) {
+    AinvData *d = (AinvData*)pc->data;
+    free_csr_matrix(&d->M);
+    free_csr_matrix(&d->Mt);
+    if (!d->factorized) free_csr_matrix(&d->At);
+    free(d->at_pos);
+    free(d->copy_pos);
+    free(d->tmp);
+    free(d);
+}
+
+static Preconditioner* ainv_create(CSRMatrix *A, int power, int factorized) {
+    Preconditioner *pc = (Preconditioner*)calloc(1, sizeof(Preconditioner));
+    AinvData *d = (AinvData*)calloc(1, sizeof(AinvData));
+    pc->name = factorized ? "FSAI" : "SPAI";
+    pc->n = A->n;
+    pc->data = d;
+    pc->update_numeric = ainv_update;
+    pc->apply = ainv_apply;
+    pc->destroy = ainv_destroy;
+    
+    double start = wall_time();
+    int n = A->n;
+    d->factorized = factorized;
+    if (factorized) {
+        d->M = pattern_power(A, power < 1 ? 1 : power, 1);
+        d->copy_pos = transpose_pattern(&d->M, &d->Mt);
+        d->tmp = (double*)malloc(n * sizeof(double));
+    } else {
+        d->at_pos = transpose_pattern(A, &d->At);
+        d->Mt = pattern_power(&d->At, power < 1 ? 1 : power, 0);
+        d->copy_pos = transpose_pattern(&d->Mt, &d->M);
+    }
+    CSRMatrix *P = factorized ? &d->M : &d->Mt;
+    for (int i = 0; i < n; i++) {
+        int len = P->row_ptr[i+1] - P->row_ptr[i];
+        if (len > d->max_cols) d->max_cols = len;
+    }
+    
+    if (!factorized) {
+        // Longest least-squares column: rows of A touched by a pattern column
+        int *mark = (int*)malloc(n * sizeof(int));
+        for (int i = 0; i < n; i++) mark[i] = -1;
+        for (int i = 0; i < n; i++) {
+            int count = 0;
+            for (int p = P->row_ptr[i]; p < P->row_ptr[i+1]; p++) {
+                int c = P->col_idx[p];
+                for (int k = d->At.row_ptr[c]; k < d->At.row_ptr[c+1]; k++) {
+                    if (mark[d->At.col_idx[k]] != i) {
+                        mark[d->At.col_idx[k]] = i;
+                        count++;
+                    }
+                }
+            }
+            if (count > d->max_rows) d->max_rows = count;
+        }
+        free(mark);
+    }
+    pc->symbolic_time = wall_time() - start;
+    
+    precond_update_numeric(pc, A);
+    return pc;
+}
+
+Preconditioner* precond_create_fsai(CSRMatrix *A, int power) {
+    return ainv_create(A, power, 1);
+}
+
+Preconditioner* precond_create_spai(CSRMatrix *A, int power) {
+    return ainv_create(A, power, 0);
+}
+
+int precond_ainv_nnz(const Preconditioner *pc) {
+    const AinvData *d = (const AinvData*)pc->data;
+    return d->factorized ? 2 * d->M.nnz : d->M.nnz;
+}
+
+// ---------------------------------------------------------------
+// Common entry points
+// ---------------------------------------------------------------
+
+void precond_update_numeric(Preconditioner *pc, CSRMatrix *A) {
+    double start = wall_time();
+    pc->update_numeric(pc, A);
+    pc->numeric_time = wall_time() - start;
+}
+
+void precond_apply(Preconditioner *pc, const double *r, double *z, int parallel) {
+    pc->apply(pc, r, z, parallel);
+}
+
+void precond_free(Preconditioner *pc) {
+    if (pc) {
+        pc->destroy(pc);
+        free(pc);
+    }
+}
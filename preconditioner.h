@@ -0,0 +1,74 @@
+// preconditioner.h
+// Header file for preconditioners used by the BICGSTAB solvers
+// Each preconditioner has a symbolic setup (structure, done once) and a
+// numeric update (values only), so a changed matrix with the same pattern
+// does not rebuild the structure
+
+#ifndef PRECONDITIONER_H
+#define PRECONDITIONER_H
+
+#include "fem_matrix.h"
+
+typedef struct Preconditioner Preconditioner;
+
+struct Preconditioner {
+    const char *name;
+    int n;
+    void *data;             // Preconditioner-specific structure
+    
+    // Recompute numeric values for a matrix with the original pattern
+    void (*update_numeric)(Preconditioner *pc, CSRMatrix *A);
+    // z = M^{-1} r (parallel = 1: may use the current OpenMP team)
+    void (*apply)(Preconditioner *pc, const double *r, double *z, int parallel);
+    void (*destroy)(Preconditioner *pc);
+    
+    double symbolic_time;   // Structure setup (seconds)
+    double numeric_time;    // Last numeric update (seconds)
+};
+
+// Jacobi (diagonal scaling)
+Preconditioner* precond_create_jacobi(CSRMatrix *A);
+
+// ILU(0): incomplete LU on the pattern of A
+// The symbolic phase records every elimination update (i,k,j) as CSR
+// positions, so the numeric phase is a flat loop over that list
+Preconditioner* precond_create_ilu0(CSRMatrix *A);
+
+// IC(0): incomplete Cholesky A ~ L L^T on the lower pattern of a symmetric
+// positive definite A (e.g. fem_system_eliminate_dirichlet). A pivot that is
+// not positive restarts the factorization on A + shift * diag(A), with the
+// shift doubled up to a cap. The triangular solves run level-scheduled on
+// the OpenMP team when parallel. Returns NULL if no factorization succeeds
+// (a diagonal entry that is not positive, or the cap reached)
+Preconditioner* precond_create_ic0(CSRMatrix *A);
+
+// Diagonal shift of the last IC(0) factorization (0 = none, -1 = a numeric
+// update failed and the apply is the identity) and the level count of its
+// forward solve
+void precond_ic0_info(const Preconditioner *pc, double *shift, int *levels);
+
+// Approximate inverses, applied with sparse products only (no triangular
+// solves, so the apply parallelizes like an SpMV). The pattern is that of
+// A^power (power 1 or 2); the numeric phase solves one small dense
+// least-squares problem per row, rows shared by the OpenMP team.
+// FSAI: G lower triangular with G^T G ~ A^{-1}, for symmetric positive
+// definite A (PCG); z = G^T (G r)
+Preconditioner* precond_create_fsai(CSRMatrix *A, int power);
+
+// SPAI: M ~ A^{-1} minimizing ||A M - I||_F column by column (the right
+// preconditioner BICGSTAB applies), for any A; z = M r
+Preconditioner* precond_create_spai(CSRMatrix *A, int power);
+
+// Stored entries an FSAI / SPAI apply reads (G and G^T, or M)
+int precond_ainv_nnz(const Preconditioner *pc);
+
+// Refresh values after A changed (same pattern); times the update
+void precond_update_numeric(Preconditioner *pc, CSRMatrix *A);
+
+// z = M^{-1} r
+void precond_apply(Preconditioner *pc, const double *r, double *z, int parallel);
+
+// Frees the preconditioner
+void precond_free(Preconditioner *pc);
+
+#endif // PRECONDITIONER_H
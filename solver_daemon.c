@@ -0,0 +1,242 @@
+// solver_daemon.c
+// Unix-socket solver daemon and its client
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "solver_daemon.h"
+#include "async_solver.h"
+
+// Pending connections the kernel queues for accept
+#define DAEMON_BACKLOG 64
+
+typedef struct Connection Connection;
+
+typedef struct {
+    SolveService *service;
+    int listen_fd;
+    atomic_int active;      // Open connection threads
+    atomic_int stopping;    // Set by a SHUTDOWN request
+    pthread_mutex_t lock;   // Guards connections
+    Connection *connections;    // Open connections (to end their reads on shutdown)
+} DaemonState;
+
+struct Connection {
+    DaemonState *state;
+    int fd;
+    Connection *prev, *next;
+};
+
+struct SolverClient {
+    int fd;
+};
+
+static int fill_address(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// Maps the segment, runs the solve on the service and fills the reply
+static void serve_solve(DaemonState *state, const SolverRequest *req, int shm_fd,
+                        SolverReply *reply) {
+    memset(reply, 0, sizeof(*reply));
+    SolverShm *shm = shm_fd >= 0 ? solver_shm_map(shm_fd) : NULL;
+    if (!shm || !(req->tol > 0.0) || req->max_iter <= 0) {
+        solver_shm_close(shm);
+        reply->status = SOLVER_BAD_REQUEST;
+        return;
+    }
+
+    SolverOptions opts;
+    solver_default_options(&opts);
+    opts.verbose = 0;
+    opts.tol = req->tol;
+    opts.max_iter = req->max_iter;
+
+    SolveJob *job = solve_submit(state->service, &shm->sys, &opts);
+    int result = solve_wait(job);
+    const SolverStats *stats = solve_job_stats(job);
+    reply->status = result >= 0 ? SOLVER_OK : SOLVER_NOT_CONVERGED;
+    reply->iterations = stats->iterations;
+    reply->true_residual = stats->true_residual;
+    reply->solve_time = solve_job_time(job);
+    solve_job_free(job);
+    solver_shm_close(shm);
+}
+
+// Adds conn to the open connections. One accepted while a shutdown was
+// under way is ended right away, since the sweep may already have passed
+static void connection_register(DaemonState *state, Connection *conn) {
+    pthread_mutex_lock(&state->lock);
+    conn->prev = NULL;
+    conn->next = state->connections;
+    if (conn->next) conn->next->prev = conn;
+    state->connections = conn;
+    if (atomic_load(&state->stopping)) shutdown(conn->fd, SHUT_RD);
+    pthread_mutex_unlock(&state->lock);
+}
+
+static void connection_unregister(DaemonState *state, Connection *conn) {
+    pthread_mutex_lock(&state->lock);
+    if (conn->prev) conn->prev->next = conn->next;
+    else state->connections = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    pthread_mutex_unlock(&state->lock);
+}
+
+// Stops taking connections and ends the read side of every open one: a
+// thread idle in solver_ipc_recv sees end of stream and exits, one in the
+// middle of a solve still sends its reply first
+static void daemon_stop(DaemonState *state) {
+    pthread_mutex_lock(&state->lock);
+    atomic_store(&state->stopping, 1);
+    shutdown(state->listen_fd, SHUT_RDWR);
+    for (Connection *c = state->connections; c; c = c->next) shutdown(c->fd, SHUT_RD);
+    pthread_mutex_unlock(&state->lock);
+}
+
+static void* connection_main(void *arg) {
+    Connection *conn = (Connection*)arg;
+    DaemonState *state = conn->state;
+
+    SolverRequest req;
+    int shm_fd;
+    while (solver_ipc_recv(conn->fd, &req, sizeof(req), &shm_fd) == 0) {
+        if (req.magic != SOLVER_IPC_MAGIC) {
+            if (shm_fd >= 0) close(shm_fd);
+            break;
+        }
+        SolverReply reply;
+        if (req.type == SOLVER_REQ_SOLVE) {
+            serve_solve(state, &req, shm_fd, &reply);
+        } else {
+            if (shm_fd >= 0) close(shm_fd);
+            memset(&reply, 0, sizeof(reply));
+            if (req.type == SOLVER_REQ_SHUTDOWN) {
+                daemon_stop(state);
+            } else {
+                reply.status = SOLVER_BAD_REQUEST;
+            }
+        }
+        if (solver_ipc_send(conn->fd, &reply, sizeof(reply), -1) != 0) break;
+    }
+
+    connection_unregister(state, conn);
+    close(conn->fd);
+    free(conn);
+    atomic_fetch_sub(&state->active, 1);
+    return NULL;
+}
+
+int solver_daemon_run(const char *socket_path, int num_workers,
+                      int large_threshold, int large_team) {
+    struct sockaddr_un addr;
+    if (fill_address(&addr, socket_path) != 0) {
+        fprintf(stderr, "solver_daemon_run: socket path too long\n");
+        return -1;
+    }
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("solver_daemon_run: socket");
+        return -1;
+    }
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, DAEMON_BACKLOG) != 0) {
+        perror("solver_daemon_run: bind");
+        close(listen_fd);
+        return -1;
+    }
+
+    DaemonState state;
+    state.service = solve_service_create(num_workers, large_threshold, large_team);
+    state.listen_fd = listen_fd;
+    atomic_init(&state.active, 0);
+    atomic_init(&state.stopping, 0);
+    pthread_mutex_init(&state.lock, NULL);
+    state.connections = NULL;
+
+    while (!atomic_load(&state.stopping)) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // Listening socket shut down (or broken)
+        }
+        solver_ipc_nosigpipe(fd);
+        Connection *conn = (Connection*)malloc(sizeof(Connection));
+        conn->state = &state;
+        conn->fd = fd;
+        atomic_fetch_add(&state.active, 1);
+        connection_register(&state, conn);
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, connection_main, conn) != 0) {
+            connection_unregister(&state, conn);
+            atomic_fetch_sub(&state.active, 1);
+            close(fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    // Let open connections finish their requests before stopping the workers
+    // (daemon_stop ended their reads, so idle clients do not hold this up)
+    while (atomic_load(&state.active) > 0) usleep(1000);
+    pthread_mutex_destroy(&state.lock);
+    solve_service_free(state.service);
+    close(listen_fd);
+    unlink(socket_path);
+    return 0;
+}
+
+SolverClient* solver_client_connect(const char *socket_path) {
+    struct sockaddr_un addr;
+    if (fill_address(&addr, socket_path) != 0) return NULL;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return NULL;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    solver_ipc_nosigpipe(fd);
+    SolverClient *client = (SolverClient*)malloc(sizeof(SolverClient));
+    client->fd = fd;
+    return client;
+}
+
+int solver_client_solve(SolverClient *client, SolverShm *shm, double tol, int max_iter,
+                        SolverReply *reply) {
+    SolverRequest req;
+    memset(&req, 0, sizeof(req));
+    req.magic = SOLVER_IPC_MAGIC;
+    req.type = SOLVER_REQ_SOLVE;
+    req.tol = tol;
+    req.max_iter = max_iter;
+    if (solver_ipc_send(client->fd, &req, sizeof(req), shm->fd) != 0) return -1;
+    return solver_ipc_recv(client->fd, reply, sizeof(*reply), NULL);
+}
+
+int solver_client_shutdown(SolverClient *client) {
+    SolverRequest req;
+    memset(&req, 0, sizeof(req));
+    req.magic = SOLVER_IPC_MAGIC;
+    req.type = SOLVER_REQ_SHUTDOWN;
+    SolverReply reply;
+    if (solver_ipc_send(client->fd, &req, sizeof(req), -1) != 0) return -1;
+    return solver_ipc_recv(client->fd, &reply, sizeof(reply), NULL);
+}
+
+void solver_client_close(SolverClient *client) {
+    if (!client) return;
+    close(client->fd);
+    free(client);
+}
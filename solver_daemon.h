@@ -0,0 +1,40 @@
+// solver_daemon.h
+// Local solver daemon: a long-running process that accepts solve requests
+// over a Unix domain socket and runs them on a warm SolveService
+//
+// Each client connection gets a thread that reads requests in order. A
+// SOLVE request carries the fd of a shared-memory segment (solver_ipc.h);
+// the daemon maps it, queues the solve on its workers, writes the solution
+// into the segment's x and replies with the iteration count and residual.
+// The process, the workers and their workspaces persist across requests, so
+// a request pays neither process startup nor a copy of the system
+
+#ifndef SOLVER_DAEMON_H
+#define SOLVER_DAEMON_H
+
+#include "solver_ipc.h"
+
+// Serves on socket_path until a SHUTDOWN request arrives (replaces a stale
+// socket file). num_workers, large_threshold and large_team configure the
+// SolveService. Returns 0 on clean shutdown, -1 if the socket cannot be set up
+int solver_daemon_run(const char *socket_path, int num_workers,
+                      int large_threshold, int large_team);
+
+// Client side of the protocol
+typedef struct SolverClient SolverClient;
+
+// Connects to a daemon (NULL if nothing is listening)
+SolverClient* solver_client_connect(const char *socket_path);
+
+// Solves the system in shm through the daemon; the solution lands in
+// shm->sys.x. Returns 0 and fills reply, or -1 on a transport error
+int solver_client_solve(SolverClient *client, SolverShm *shm, double tol, int max_iter,
+                        SolverReply *reply);
+
+// Asks the daemon to exit: solves in progress still get their replies,
+// other connections (including idle ones) are ended by the daemon
+int solver_client_shutdown(SolverClient *client);
+
+void solver_client_close(SolverClient *client);
+
+#endif // SOLVER_DAEMON_H
@@ -0,0 +1,307 @@
+// solver_ipc.c
+// Shared-memory segments and fd-passing messages for the solver daemon
+
+#ifdef __linux__
+#define _GNU_SOURCE     // memfd_create
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "solver_ipc.h"
+
+// A peer that has gone away must fail the send (EPIPE), not raise SIGPIPE
+// and kill the process. Where sendmsg has no such flag, the socket carries
+// SO_NOSIGPIPE instead (solver_ipc_nosigpipe)
+#ifdef MSG_NOSIGNAL
+#define IPC_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define IPC_SEND_FLAGS 0
+#endif
+
+static uint64_t align_up(uint64_t off) {
+    return (off + SOLVER_IPC_ALIGN - 1) / SOLVER_IPC_ALIGN * SOLVER_IPC_ALIGN;
+}
+
+// Seals a segment must carry: its size is fixed, so the daemon's mapping
+// cannot be cut short under it (SIGBUS)
+#ifdef __linux__
+#define SHM_REQUIRED_SEALS (F_SEAL_SHRINK | F_SEAL_GROW)
+#endif
+
+// Anonymous shared-memory file of the given size (size sealed where the
+// platform can)
+static int shm_anonymous(size_t size) {
+#ifdef __linux__
+    int fd = memfd_create("bicgstab_system", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    // No memfd: create a uniquely named object and unlink it right away
+    static int counter = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "/bicgstab_%d_%d", (int)getpid(), __sync_fetch_and_add(&counter, 1));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+#endif
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+#ifdef __linux__
+    if (fcntl(fd, F_ADD_SEALS, SHM_REQUIRED_SEALS | F_SEAL_SEAL) != 0) {
+        close(fd);
+        return -1;
+    }
+#endif
+    return fd;
+}
+
+// Points sys at the arrays of a mapped segment laid out as h says
+static void shm_bind_system(SolverShm *shm, const SolverShmHeader *h) {
+    char *base = (char*)shm->base;
+    memset(&shm->sys, 0, sizeof(FEMSystem));   // No arena: the mapping owns the arrays
+    shm->sys.n = h->n;
+    shm->sys.nx = h->nx;
+    shm->sys.ny = h->ny;
+    shm->sys.A.n = h->n;
+    shm->sys.A.nnz = h->nnz;
+    shm->sys.A.row_ptr = (int*)(base + h->row_ptr_off);
+    shm->sys.A.col_idx = (int*)(base + h->col_idx_off);
+    shm->sys.A.values = (double*)(base + h->values_off);
+    shm->sys.b = (double*)(base + h->b_off);
+    shm->sys.x = (double*)(base + h->x_off);
+}
+
+SolverShm* solver_shm_create(int n, int nnz, int nx, int ny) {
+    SolverShmHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = SOLVER_IPC_MAGIC;
+    h.version = SOLVER_IPC_VERSION;
+    h.n = n;
+    h.nnz = nnz;
+    h.nx = nx;
+    h.ny = ny;
+    h.row_ptr_off = align_up(sizeof(SolverShmHeader));
+    h.col_idx_off = align_up(h.row_ptr_off + (uint64_t)(n + 1) * sizeof(int32_t));
+    h.values_off = align_up(h.col_idx_off + (uint64_t)nnz * sizeof(int32_t));
+    h.b_off = align_up(h.values_off + (uint64_t)nnz * sizeof(double));
+    h.x_off = align_up(h.b_off + (uint64_t)n * sizeof(double));
+    h.size = align_up(h.x_off + (uint64_t)n * sizeof(double));
+
+    int fd = shm_anonymous(h.size);
+    if (fd < 0) {
+        perror("solver_shm_create");
+        return NULL;
+    }
+    void *base = mmap(NULL, h.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("solver_shm_create: mmap");
+        close(fd);
+        return NULL;
+    }
+    memcpy(base, &h, sizeof(h));
+
+    SolverShm *shm = (SolverShm*)malloc(sizeof(SolverShm));
+    shm->fd = fd;
+    shm->size = h.size;
+    shm->base = base;
+    shm->header = (SolverShmHeader*)base;
+    shm->index = NULL;
+    shm_bind_system(shm, &h);
+    return shm;
+}
+
+SolverShm* solver_shm_from_system(const FEMSystem *sys) {
+    SolverShm *shm = solver_shm_create(sys->n, sys->A.nnz, sys->nx, sys->ny);
+    if (!shm) return NULL;
+    
+    // A system from fem_system_alloc has the segment's array layout after the
+    // header (same order, same 64-byte padding): one copy moves everything
+    const SolverShmHeader *h = shm->header;
+    const char *src = (const char*)sys->A.row_ptr;
+    if (sys->arena.base == src && SOLVER_IPC_ALIGN == ARENA_ALIGN &&
+        (const char*)sys->A.col_idx - src == (ptrdiff_t)(h->col_idx_off - h->row_ptr_off) &&
+        (const char*)sys->A.values - src == (ptrdiff_t)(h->values_off - h->row_ptr_off) &&
+        (const char*)sys->b - src == (ptrdiff_t)(h->b_off - h->row_ptr_off) &&
+        (const char*)sys->x - src == (ptrdiff_t)(h->x_off - h->row_ptr_off)) {
+        memcpy(shm->sys.A.row_ptr, src, h->x_off + sys->n * sizeof(double) - h->row_ptr_off);
+        return shm;
+    }
+    memcpy(shm->sys.A.row_ptr, sys->A.row_ptr, (sys->n + 1) * sizeof(int));
+    memcpy(shm->sys.A.col_idx, sys->A.col_idx, sys->A.nnz * sizeof(int));
+    memcpy(shm->sys.A.values, sys->A.values, sys->A.nnz * sizeof(double));
+    memcpy(shm->sys.b, sys->b, sys->n * sizeof(double));
+    memcpy(shm->sys.x, sys->x, sys->n * sizeof(double));
+    return shm;
+}
+
+// 1 if an array of count elements of elem bytes at off fits in the segment
+static int shm_array_fits(const SolverShmHeader *h, uint64_t off, uint64_t count, uint64_t elem) {
+    return off % SOLVER_IPC_ALIGN == 0 && off <= h->size && count <= (h->size - off) / elem;
+}
+
+SolverShm* solver_shm_map(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SolverShmHeader)) {
+        close(fd);
+        return NULL;
+    }
+#ifdef __linux__
+    // Without the size seals the sender could truncate the file mid-solve
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & SHM_REQUIRED_SEALS) != SHM_REQUIRED_SEALS) {
+        close(fd);
+        return NULL;
+    }
+#endif
+    size_t size = (size_t)st.st_size;
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    // Never trust the sender, who can still write the pages: the header and
+    // the index arrays are copied to private memory, then checked there, so
+    // nothing that steers memory accesses can change after validation.
+    // Every array must lie inside the mapping
+    SolverShmHeader local;
+    memcpy(&local, base, sizeof(local));
+    const SolverShmHeader *h = &local;
+    int32_t *index = NULL;
+    int valid = h->magic == SOLVER_IPC_MAGIC && h->version == SOLVER_IPC_VERSION &&
+                h->size == size && h->n > 0 && h->nnz >= 0 &&
+                shm_array_fits(h, h->row_ptr_off, (uint64_t)h->n + 1, sizeof(int32_t)) &&
+                shm_array_fits(h, h->col_idx_off, (uint64_t)h->nnz, sizeof(int32_t)) &&
+                shm_array_fits(h, h->values_off, (uint64_t)h->nnz, sizeof(double)) &&
+                shm_array_fits(h, h->b_off, (uint64_t)h->n, sizeof(double)) &&
+                shm_array_fits(h, h->x_off, (uint64_t)h->n, sizeof(double));
+    if (valid) {
+        index = (int32_t*)malloc(((size_t)h->n + 1 + (size_t)h->nnz) * sizeof(int32_t));
+        valid = index != NULL;
+    }
+    if (valid) {
+        // Row pointers and column indices must stay in range for the SpMV
+        int32_t *row_ptr = index;
+        int32_t *col_idx = index + h->n + 1;
+        memcpy(row_ptr, (const char*)base + h->row_ptr_off, ((size_t)h->n + 1) * sizeof(int32_t));
+        memcpy(col_idx, (const char*)base + h->col_idx_off, (size_t)h->nnz * sizeof(int32_t));
+        valid = row_ptr[0] == 0 && row_ptr[h->n] == h->nnz;
+        for (int i = 0; valid && i < h->n; i++) {
+            valid = row_ptr[i] <= row_ptr[i+1];
+        }
+        for (int k = 0; valid && k < h->nnz; k++) {
+            valid = col_idx[k] >= 0 && col_idx[k] < h->n;
+        }
+    }
+    if (!valid) {
+        free(index);
+        munmap(base, size);
+        close(fd);
+        return NULL;
+    }
+
+    SolverShm *shm = (SolverShm*)malloc(sizeof(SolverShm));
+    shm->fd = fd;
+    shm->size = size;
+    shm->base = base;
+    shm->header = (SolverShmHeader*)base;
+    shm->index = index;
+    shm_bind_system(shm, h);
+    shm->sys.A.row_ptr = index;
+    shm->sys.A.col_idx = index + h->n + 1;
+    return shm;
+}
+
+void solver_shm_close(SolverShm *shm) {
+    if (!shm) return;
+    free(shm->index);
+    munmap(shm->base, shm->size);
+    close(shm->fd);
+    free(shm);
+}
+
+void solver_ipc_nosigpipe(int sock) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)sock;
+#endif
+}
+
+int solver_ipc_send(int sock, const void *msg, size_t len, int fd) {
+    struct iovec iov;
+    iov.iov_base = (void*)msg;
+    iov.iov_len = len;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    if (fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        mh.msg_control = control.buf;
+        mh.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    }
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(sock, &mh, IPC_SEND_FLAGS);
+    } while (sent < 0 && errno == EINTR);
+    return sent == (ssize_t)len ? 0 : -1;
+}
+
+int solver_ipc_recv(int sock, void *msg, size_t len, int *fd) {
+    struct iovec iov;
+    iov.iov_base = msg;
+    iov.iov_len = len;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control.buf;
+    mh.msg_controllen = sizeof(control.buf);
+
+    ssize_t got;
+    do {
+        got = recvmsg(sock, &mh, MSG_WAITALL);
+    } while (got < 0 && errno == EINTR);
+
+    int received_fd = -1;
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+            memcpy(&received_fd, CMSG_DATA(cm), sizeof(int));
+        }
+    }
+    if (got != (ssize_t)len) {
+        if (received_fd >= 0) close(received_fd);
+        return -1;
+    }
+    if (fd) {
+        *fd = received_fd;
+    } else if (received_fd >= 0) {
+        close(received_fd);
+    }
+    return 0;
+}
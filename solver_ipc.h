@@ -0,0 +1,107 @@
+// solver_ipc.h
+// Wire protocol and shared-memory system layout for the solver daemon
+//
+// A system travels as one shared-memory segment (memfd on Linux, an
+// unlinked POSIX shm object elsewhere): a SolverShmHeader followed by the
+// CSR arrays, b and x at 64-byte aligned offsets. The client passes the
+// segment's file descriptor with each request (SCM_RIGHTS); the daemon maps
+// it, solves in place and writes x back into the same pages, so neither side
+// copies the values or the vectors.
+//
+// The sender keeps write access to the pages while the daemon solves, so
+// the daemon copies the header, row_ptr and col_idx to private memory and
+// validates the copies. On Linux segments are created with their size
+// sealed (F_SEAL_SHRINK | F_SEAL_GROW), and the daemon rejects unsealed
+// ones, so a client cannot truncate the mapping under a solve. Elsewhere
+// POSIX shm cannot be sealed, and clients must be trusted not to resize a
+// segment in flight
+
+#ifndef SOLVER_IPC_H
+#define SOLVER_IPC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fem_matrix.h"
+
+#define SOLVER_IPC_MAGIC 0x42435347u    // "GSCB"
+#define SOLVER_IPC_VERSION 1
+#define SOLVER_IPC_ALIGN 64
+
+// Segment header (offsets are bytes from the segment start)
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t n, nnz;
+    int32_t nx, ny;
+    uint64_t size;          // Segment size in bytes
+    uint64_t row_ptr_off;   // int32[n + 1]
+    uint64_t col_idx_off;   // int32[nnz]
+    uint64_t values_off;    // double[nnz]
+    uint64_t b_off;         // double[n]
+    uint64_t x_off;         // double[n], initial guess in, solution out
+} SolverShmHeader;
+
+// Request types
+enum {
+    SOLVER_REQ_SOLVE = 1,       // Carries the segment fd
+    SOLVER_REQ_SHUTDOWN = 2     // Stop accepting connections and exit
+};
+
+// Reply status
+enum {
+    SOLVER_OK = 0,
+    SOLVER_NOT_CONVERGED = -1,
+    SOLVER_BAD_REQUEST = -2
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    double tol;
+    int32_t max_iter;
+    int32_t reserved;
+} SolverRequest;
+
+typedef struct {
+    int32_t status;
+    int32_t iterations;
+    double true_residual;   // ||b - Ax|| / ||b|| at exit
+    double solve_time;      // Solver time in the daemon (seconds)
+} SolverReply;
+
+// A mapped segment; sys points into the mapping (never free_fem_system it)
+typedef struct {
+    int fd;
+    size_t size;
+    void *base;
+    SolverShmHeader *header;
+    int32_t *index;         // Private row_ptr + col_idx of a mapped segment (else NULL)
+    FEMSystem sys;
+} SolverShm;
+
+// New zeroed segment for an n x n system with nnz entries
+SolverShm* solver_shm_create(int n, int nnz, int nx, int ny);
+
+// New segment holding a copy of sys (x included)
+SolverShm* solver_shm_from_system(const FEMSystem *sys);
+
+// Maps a received segment; checks the seals, the header, offsets and the
+// private copies of row_ptr / col_idx (NULL if invalid). Takes ownership of fd
+SolverShm* solver_shm_map(int fd);
+
+// Unmaps the segment and closes its fd
+void solver_shm_close(SolverShm *shm);
+
+// Keeps sends on sock from raising SIGPIPE on systems without MSG_NOSIGNAL
+// (a closed peer then only fails the send); a no-op elsewhere
+void solver_ipc_nosigpipe(int sock);
+
+// Fixed-size message with an optional fd (fd < 0: none); 0 on success, -1
+// on error or a closed peer (never SIGPIPE)
+int solver_ipc_send(int sock, const void *msg, size_t len, int fd);
+
+// Receives a fixed-size message and an fd if one was attached (else -1)
+// Returns 0 on success, -1 on error or closed connection
+int solver_ipc_recv(int sock, void *msg, size_t len, int *fd);
+
+#endif // SOLVER_IPC_H
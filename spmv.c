@@ -0,0 +1,287 @@
+// spmv.c
+// Prefetching and gathering CSR SpMV kernels and their selection
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "spmv.h"
+#include "bicgstab.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SPMV_X86 1
+#include <immintrin.h>
+#endif
+
+// Locality scan: every SPMV_SCAN_STRIDE-th row is sampled; an x load counts
+// as far when it lies more than SPMV_NEAR_BYTES from the row's own entry
+// (about what an L2 keeps of x while the rows stream by)
+#define SPMV_SCAN_STRIDE 16
+#define SPMV_NEAR_BYTES (256 << 10)
+#define SPMV_FAR_THRESHOLD 0.2
+
+// Timing probe: rows per trial, trials per candidate, and the time ratio
+// to plain a variant must beat
+#define SPMV_PROBE_ROWS (1 << 18)
+#define SPMV_PROBE_TRIALS 5
+#define SPMV_PROBE_MARGIN 0.95
+
+// Timed SPMV_AUTO choices kept for reuse, keyed by the matrix's pattern
+// arrays and size (a freed matrix whose arrays are reused by another one
+// can inherit its choice; that costs speed at worst, never correctness)
+#define SPMV_CACHE_SIZE 8
+
+typedef struct {
+    const int *row_ptr, *col_idx;
+    int n, nnz, distance;   // distance: the one requested (0 = any)
+    SpmvKernel kernel;
+    int chosen_distance;
+    double far_fraction;
+} SpmvCacheEntry;
+
+static SpmvCacheEntry spmv_cache[SPMV_CACHE_SIZE];
+static int spmv_cache_next;
+static pthread_mutex_t spmv_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef void (*RowKernel)(CSRMatrix *A, const double *x, double *y, const double *w,
+                          int lo, int hi, int distance, double *wy, double *yy);
+
+static void plain_rows(CSRMatrix *A, const double *x, double *y, const double *w,
+                       int lo, int hi, int distance, double *wy, double *yy) {
+    (void)distance;
+    matvec_csr_dot2(A, x, y, w, lo, hi, wy, yy);
+}
+
+// The prefetch for x[col_idx[j + d]] runs in the same loop, so it crosses
+// row boundaries and keeps d loads in flight through short rows
+static void prefetch_rows(CSRMatrix *A, const double *x, double *y, const double *w,
+                          int lo, int hi, int distance, double *wy, double *yy) {
+    const int *col = A->col_idx;
+    const double *val = A->values;
+    int end = A->row_ptr[hi];
+    double a = 0.0, c = 0.0;
+    for (int i = lo; i < hi; i++) {
+        double sum = 0.0;
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            if (j + distance < end) __builtin_prefetch(&x[col[j + distance]], 0, 3);
+            sum += val[j] * x[col[j]];
+        }
+        y[i] = sum;
+        a += w[i] * sum;
+        c += sum * sum;
+    }
+    *wy = a;
+    *yy = c;
+}
+
+#ifdef SPMV_X86
+// Up to 8 entries of a row per step: masked index and value loads, one
+// gather for the x entries; the mask covers the row tail
+// (only reached through a plan, which checked the CPU)
+__attribute__((target("avx512f")))
+static void gather_rows(CSRMatrix *A, const double *x, double *y, const double *w,
+                        int lo, int hi, int distance, double *wy, double *yy) {
+    (void)distance;
+    const int *col = A->col_idx;
+    const double *val = A->values;
+    double a = 0.0, c = 0.0;
+    for (int i = lo; i < hi; i++) {
+        __m512d acc = _mm512_setzero_pd();
+        int end = A->row_ptr[i+1];
+        for (int j = A->row_ptr[i]; j < end; j += 8) {
+            int len = end - j;
+            __mmask8 m = len >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << len) - 1);
+            __m256i idx = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32((__mmask16)m, col + j));
+            __m512d xv = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, idx, x, 8);
+            acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, val + j), xv, acc);
+        }
+        double sum = _mm512_reduce_add_pd(acc);
+        y[i] = sum;
+        a += w[i] * sum;
+        c += sum * sum;
+    }
+    *wy = a;
+    *yy = c;
+}
+#endif
+
+int spmv_gather_supported(void) {
+#ifdef SPMV_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#else
+    return 0;
+#endif
+}
+
+static RowKernel row_kernel(SpmvKernel kernel) {
+    switch (kernel) {
+    case SPMV_PREFETCH:
+        return prefetch_rows;
+#ifdef SPMV_X86
+    case SPMV_GATHER:
+        return gather_rows;
+#endif
+    default:
+        return plain_rows;
+    }
+}
+
+const char* spmv_kernel_name(SpmvKernel kernel) {
+    switch (kernel) {
+    case SPMV_PLAIN:    return "plain";
+    case SPMV_PREFETCH: return "prefetch";
+    case SPMV_GATHER:   return "gather";
+    case SPMV_AUTO_FIXED: return "auto-fixed";
+    default:            return "auto";
+    }
+}
+
+// Share of sampled x loads more than SPMV_NEAR_BYTES away from the diagonal
+static double far_fraction(CSRMatrix *A) {
+    long far = 0, total = 0;
+    long near = SPMV_NEAR_BYTES / (long)sizeof(double);
+    for (int i = 0; i < A->n; i += SPMV_SCAN_STRIDE) {
+        for (int j = A->row_ptr[i]; j < A->row_ptr[i+1]; j++) {
+            long d = (long)A->col_idx[j] - i;
+            if (d > near || d < -near) far++;
+            total++;
+        }
+    }
+    return total > 0 ? (double)far / total : 0.0;
+}
+
+// Time of one kernel over the probe rows
+static double probe_time(SpmvKernel kernel, int distance, CSRMatrix *A, const double *x,
+                         double *y, int rows) {
+    double wy, yy;
+    double t0 = wall_time();
+    row_kernel(kernel)(A, x, y, x, 0, rows, distance, &wy, &yy);
+    return wall_time() - t0;
+}
+
+// Copies a cached SPMV_AUTO choice for A into plan; 1 if there was one
+static int cache_lookup(SpmvPlan *plan, const CSRMatrix *A, int distance) {
+    int found = 0;
+    pthread_mutex_lock(&spmv_cache_lock);
+    for (int k = 0; k < SPMV_CACHE_SIZE && !found; k++) {
+        const SpmvCacheEntry *e = &spmv_cache[k];
+        if (e->row_ptr == A->row_ptr && e->col_idx == A->col_idx && e->n == A->n &&
+            e->nnz == A->nnz && e->distance == distance) {
+            plan->kernel = e->kernel;
+            plan->distance = e->chosen_distance;
+            plan->far_fraction = e->far_fraction;
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&spmv_cache_lock);
+    return found;
+}
+
+static void cache_store(const SpmvPlan *plan, const CSRMatrix *A, int distance) {
+    pthread_mutex_lock(&spmv_cache_lock);
+    SpmvCacheEntry *e = &spmv_cache[spmv_cache_next];
+    spmv_cache_next = (spmv_cache_next + 1) % SPMV_CACHE_SIZE;
+    e->row_ptr = A->row_ptr;
+    e->col_idx = A->col_idx;
+    e->n = A->n;
+    e->nnz = A->nnz;
+    e->distance = distance;
+    e->kernel = plan->kernel;
+    e->chosen_distance = plan->distance;
+    e->far_fraction = plan->far_fraction;
+    pthread_mutex_unlock(&spmv_cache_lock);
+}
+
+void spmv_plan_init(SpmvPlan *plan, CSRMatrix *A, SpmvKernel kernel, int distance) {
+    plan->kernel = kernel;
+    plan->distance = distance > 0 ? distance : SPMV_DEFAULT_DISTANCE;
+    plan->far_fraction = 0.0;
+    lowprec_init(&plan->values, A, VALUES_FP64, 0.0);
+    if (kernel == SPMV_GATHER && !spmv_gather_supported()) plan->kernel = SPMV_PLAIN;
+    if (kernel != SPMV_AUTO && kernel != SPMV_AUTO_FIXED) return;
+
+    // x within the near window, or mostly near loads: nothing to hide
+    plan->kernel = SPMV_PLAIN;
+    if ((long)A->n * (long)sizeof(double) <= SPMV_NEAR_BYTES) return;
+    if (kernel == SPMV_AUTO && cache_lookup(plan, A, distance)) return;
+    plan->far_fraction = far_fraction(A);
+    if (plan->far_fraction < SPMV_FAR_THRESHOLD) {
+        if (kernel == SPMV_AUTO) cache_store(plan, A, distance);
+        return;
+    }
+
+    // No timing: prefetch sums each row in the same order as plain
+    if (kernel == SPMV_AUTO_FIXED) {
+        plan->kernel = SPMV_PREFETCH;
+        return;
+    }
+
+    // Irregular: time the candidates on the leading rows (x spans all columns).
+    // Trials go round-robin over the candidates so drift in the machine's
+    // load hits all of them; leaving plain needs a SPMV_PROBE_MARGIN gain
+    int rows = A->n < SPMV_PROBE_ROWS ? A->n : SPMV_PROBE_ROWS;
+    double *x = (double*)malloc(A->n * sizeof(double));
+    double *y = (double*)malloc(rows * sizeof(double));
+    for (int i = 0; i < A->n; i++) x[i] = 1.0;
+
+    SpmvKernel kernels[6] = {SPMV_PLAIN};
+    int distances[6] = {0};
+    int count = 1;
+    int tries[] = {8, 16, 32, 64};
+    for (int k = 0; k < 4; k++) {
+        if (distance > 0 && tries[k] != distance) continue;
+        kernels[count] = SPMV_PREFETCH;
+        distances[count++] = tries[k];
+    }
+    if (spmv_gather_supported()) kernels[count++] = SPMV_GATHER;
+
+    double best[6];
+    for (int c = 0; c < count; c++) best[c] = 1e30;
+    for (int trial = 0; trial < SPMV_PROBE_TRIALS; trial++) {
+        for (int c = 0; c < count; c++) {
+            double t = probe_time(kernels[c], distances[c], A, x, y, rows);
+            if (t < best[c]) best[c] = t;
+        }
+    }
+    int pick = 0;
+    for (int c = 1; c < count; c++) {
+        if (best[c] < best[pick]) pick = c;
+    }
+    if (pick > 0 && best[pick] < SPMV_PROBE_MARGIN * best[0]) {
+        plan->kernel = kernels[pick];
+        if (kernels[pick] == SPMV_PREFETCH) plan->distance = distances[pick];
+    }
+    free(x);
+    free(y);
+    cache_store(plan, A, distance);
+}
+
+ValuePrecision spmv_plan_set_values(SpmvPlan *plan, CSRMatrix *A, ValuePrecision precision,
+                                    double tol) {
+    lowprec_free(&plan->values);
+    return lowprec_init(&plan->values, A, precision, tol);
+}
+
+void spmv_plan_free(SpmvPlan *plan) {
+    lowprec_free(&plan->values);
+}
+
+double spmv_csr_dot(const SpmvPlan *plan, CSRMatrix *A, const double *x, double *y,
+                    const double *w, int lo, int hi) {
+    double wy, yy;
+    if (plan->values.precision != VALUES_FP64) {
+        lowprec_csr_dot2(&plan->values, A, x, y, w, lo, hi, &wy, &yy);
+        return wy;
+    }
+    if (plan->kernel == SPMV_PLAIN) return matvec_csr_dot(A, x, y, w, lo, hi);
+    row_kernel(plan->kernel)(A, x, y, w, lo, hi, plan->distance, &wy, &yy);
+    return wy;
+}
+
+void spmv_csr_dot2(const SpmvPlan *plan, CSRMatrix *A, const double *x, double *y,
+                   const double *w, int lo, int hi, double *wy, double *yy) {
+    if (plan->values.precision != VALUES_FP64) {
+        lowprec_csr_dot2(&plan->values, A, x, y, w, lo, hi, wy, yy);
+        return;
+    }
+    row_kernel(plan->kernel)(A, x, y, w, lo, hi, plan->distance, wy, yy);
+}
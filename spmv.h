@@ -0,0 +1,72 @@
+// spmv.h
+// CSR SpMV row kernels for matrices with irregular column access
+//
+// Variants of matvec_csr_dot2 (fem_matrix.h), selectable per solve:
+//   SPMV_PLAIN      the row loop as is (hardware prefetchers follow x only
+//                   when the columns of consecutive rows are close)
+//   SPMV_PREFETCH   software prefetch of x[col_idx[j + d]], d entries ahead
+//   SPMV_GATHER     AVX-512 masked gather of up to 8 x entries per step
+//                   (x86 with AVX-512F only, otherwise plain)
+//   SPMV_AUTO       picks one from the matrix: a sampled scan estimates how
+//                   many x loads miss the cache; only if many do, the
+//                   variants (and prefetch distances) are timed on it. The
+//                   timed choice is kept per matrix, so later plans for the
+//                   same matrix skip the probe
+//   SPMV_AUTO_FIXED the same scan without timing: plain, or prefetch at the
+//                   default distance if many loads are far. Both sum each
+//                   row in order, so the choice never changes the results
+//                   (what deterministic solves use)
+// A plan may also carry reduced-precision values (lowprec.h); its rows then
+// run the convert-on-load kernel instead
+
+#ifndef SPMV_H
+#define SPMV_H
+
+#include "fem_matrix.h"
+#include "lowprec.h"
+
+typedef enum {
+    SPMV_AUTO = 0,
+    SPMV_PLAIN,
+    SPMV_PREFETCH,
+    SPMV_GATHER,
+    SPMV_AUTO_FIXED
+} SpmvKernel;
+
+// Prefetch distance (entries ahead) when none is given
+#define SPMV_DEFAULT_DISTANCE 32
+
+// Kernel chosen for one matrix
+typedef struct {
+    SpmvKernel kernel;      // Never SPMV_AUTO(_FIXED) after spmv_plan_init
+    int distance;           // Prefetch distance (SPMV_PREFETCH)
+    double far_fraction;    // Sampled share of x loads far from the row (AUTO only)
+    LowPrecValues values;   // Narrowed values (VALUES_FP64 = A->values are used)
+} SpmvPlan;
+
+// Resolves the kernel for A; SPMV_AUTO measures, distance 0 = default or tuned
+void spmv_plan_init(SpmvPlan *plan, CSRMatrix *A, SpmvKernel kernel, int distance);
+
+// Stores A's values at reduced precision if they pass the check against
+// tol (see lowprec_init); returns the precision in use
+ValuePrecision spmv_plan_set_values(SpmvPlan *plan, CSRMatrix *A, ValuePrecision precision,
+                                    double tol);
+
+// Releases the plan's narrowed values (plans without them need no call)
+void spmv_plan_free(SpmvPlan *plan);
+
+// Name for printing ("plain", "prefetch", "gather", "auto", "auto-fixed")
+const char* spmv_kernel_name(SpmvKernel kernel);
+
+// 1 if SPMV_GATHER runs as a real gather on this CPU
+int spmv_gather_supported(void);
+
+// y = A*x on rows lo..hi-1 with the planned kernel, returns w.y
+double spmv_csr_dot(const SpmvPlan *plan, CSRMatrix *A, const double *x, double *y,
+                    const double *w, int lo, int hi);
+
+// Same, with *wy = w.y and *yy = y.y
+void spmv_csr_dot2(const SpmvPlan *plan, CSRMatrix *A, const double *x, double *y,
+                   const double *w, int lo, int hi, double *wy, double *yy);
+
+#endif // SPMV_H
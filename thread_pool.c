@@ -0,0 +1,246 @@
+// thread_pool.c
+// Persistent thread pool with sense-reversing spin barriers and padded
+// reduction slots
+
+#ifdef __linux__
+#define _GNU_SOURCE     // pthread_setaffinity_np
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpu_relax() _mm_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield")
+#else
+#define cpu_relax() ((void)0)
+#endif
+
+#define CACHE_LINE 64
+
+// Spins before yielding the core; a pool larger than the machine yields on
+// every check, since the thread it waits for may need this core to run
+#define POOL_SPIN_LIMIT 4096
+
+// Spins before an idle worker sleeps until the next task
+#define POOL_IDLE_SPINS 200000
+
+// Per-thread state, one cache line each so threads never share a line
+typedef struct {
+    _Alignas(CACHE_LINE) double values[2][POOL_MAX_REDUCE];  // Double-buffered reduction slot
+    int parity;             // Slot buffer used by the next reduction
+    int sense;              // Local barrier sense
+} PoolSlot;
+
+struct ThreadPool {
+    int num_threads;
+    int spin_limit;         // Spins between sched_yield calls
+    pthread_t *threads;
+    PoolSlot *slots;
+
+    // Barrier state (own cache lines)
+    _Alignas(CACHE_LINE) atomic_int arrived;
+    _Alignas(CACHE_LINE) atomic_int sense;
+
+    // Dispatch: workers wait for generation to change
+    _Alignas(CACHE_LINE) atomic_int generation;
+    PoolTask task;
+    void *ctx;
+    int shutdown;
+    int pin;                // Pin the workers, and the caller while it runs a task
+    pthread_mutex_t lock;   // Only used by workers that went to sleep
+    pthread_cond_t wake;
+};
+
+typedef struct {
+    ThreadPool *pool;
+    int tid;
+    int pin;
+} WorkerArgs;
+
+static void pin_to_core(pthread_t thread, int core) {
+#ifdef __linux__
+    long ncores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncores < 1) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % ncores, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+#else
+    // No portable affinity API (e.g. macOS); rely on the scheduler
+    (void)thread;
+    (void)core;
+#endif
+}
+
+// Pins the calling thread to core 0 for one task, saving its mask in
+// *saved; returns 1 if there is a mask to restore
+#ifdef __linux__
+static int pin_caller(cpu_set_t *saved) {
+    if (pthread_getaffinity_np(pthread_self(), sizeof(*saved), saved) != 0) return 0;
+    pin_to_core(pthread_self(), 0);
+    return 1;
+}
+#endif
+
+static void* worker_main(void *arg) {
+    WorkerArgs args = *(WorkerArgs*)arg;
+    free(arg);
+    ThreadPool *pool = args.pool;
+    if (args.pin) pin_to_core(pthread_self(), args.tid);
+
+    int seen = 0;
+    for (;;) {
+        // Spin for the next task, then sleep
+        int spins = 0;
+        while (atomic_load_explicit(&pool->generation, memory_order_acquire) == seen) {
+            if (++spins < POOL_IDLE_SPINS) {
+                if (spins % pool->spin_limit == 0) sched_yield();
+                cpu_relax();
+                continue;
+            }
+            pthread_mutex_lock(&pool->lock);
+            while (atomic_load_explicit(&pool->generation, memory_order_acquire) == seen) {
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+        seen = atomic_load_explicit(&pool->generation, memory_order_acquire);
+        if (pool->shutdown) break;
+
+        pool->task(pool->ctx, args.tid, pool->num_threads);
+        thread_pool_barrier(pool, args.tid);
+    }
+    return NULL;
+}
+
+ThreadPool* thread_pool_create(int num_threads, int pin) {
+    if (num_threads < 1) num_threads = 1;
+    ThreadPool *pool = (ThreadPool*)aligned_alloc(CACHE_LINE,
+        (sizeof(ThreadPool) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+    memset(pool, 0, sizeof(ThreadPool));
+    pool->num_threads = num_threads;
+    long ncores = sysconf(_SC_NPROCESSORS_ONLN);
+    pool->spin_limit = (ncores > 0 && num_threads > ncores) ? 1 : POOL_SPIN_LIMIT;
+    pool->slots = (PoolSlot*)aligned_alloc(CACHE_LINE, num_threads * sizeof(PoolSlot));
+    memset(pool->slots, 0, num_threads * sizeof(PoolSlot));
+    atomic_init(&pool->arrived, 0);
+    atomic_init(&pool->sense, 0);
+    atomic_init(&pool->generation, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    pool->pin = pin;
+    pool->threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    for (int t = 1; t < num_threads; t++) {
+        WorkerArgs *args = (WorkerArgs*)malloc(sizeof(WorkerArgs));
+        args->pool = pool;
+        args->tid = t;
+        args->pin = pin;
+        pthread_create(&pool->threads[t], NULL, worker_main, args);
+    }
+    return pool;
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool->num_threads;
+}
+
+// Publishes a new generation and wakes sleeping workers
+static void dispatch(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->generation, 1, memory_order_release);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_run(ThreadPool *pool, PoolTask task, void *ctx) {
+    if (pool->num_threads == 1) {
+        task(ctx, 0, 1);
+        return;
+    }
+    // The caller is pinned only while it works as thread 0: a pin that
+    // outlived the task would be inherited by threads it creates later
+    // (e.g. the OpenMP team), stacking them all on core 0
+#ifdef __linux__
+    cpu_set_t saved;
+    int restore = pool->pin && pin_caller(&saved);
+#endif
+    pool->task = task;
+    pool->ctx = ctx;
+    dispatch(pool);
+    task(ctx, 0, pool->num_threads);
+    thread_pool_barrier(pool, 0);
+#ifdef __linux__
+    if (restore) pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+#endif
+}
+
+void thread_pool_barrier(ThreadPool *pool, int tid) {
+    if (pool->num_threads == 1) return;
+    PoolSlot *me = &pool->slots[tid];
+    int my_sense = !me->sense;
+    me->sense = my_sense;
+
+    // Last thread to arrive resets the count and flips the shared sense
+    if (atomic_fetch_add_explicit(&pool->arrived, 1, memory_order_acq_rel) == pool->num_threads - 1) {
+        atomic_store_explicit(&pool->arrived, 0, memory_order_relaxed);
+        atomic_store_explicit(&pool->sense, my_sense, memory_order_release);
+        return;
+    }
+    int spins = 0;
+    while (atomic_load_explicit(&pool->sense, memory_order_acquire) != my_sense) {
+        if (++spins % pool->spin_limit == 0) sched_yield();
+        cpu_relax();
+    }
+}
+
+// Slots alternate between two buffers: a thread can only write the buffer
+// of reduction k+2 after the barrier of reduction k+1, by which time every
+// thread has finished reading reduction k
+void thread_pool_allreduce(ThreadPool *pool, int tid, double *values, int count) {
+    if (pool->num_threads == 1) return;
+    PoolSlot *me = &pool->slots[tid];
+    int buf = me->parity;
+    me->parity ^= 1;
+    for (int k = 0; k < count; k++) me->values[buf][k] = values[k];
+
+    thread_pool_barrier(pool, tid);
+
+    for (int k = 0; k < count; k++) {
+        double sum = 0.0;
+        for (int t = 0; t < pool->num_threads; t++) {
+            sum += pool->slots[t].values[buf][k];
+        }
+        values[k] = sum;
+    }
+}
+
+void thread_pool_range(int n, int tid, int num_threads, int *lo, int *hi) {
+    int chunk = n / num_threads;
+    int extra = n % num_threads;
+    *lo = tid * chunk + (tid < extra ? tid : extra);
+    *hi = *lo + chunk + (tid < extra ? 1 : 0);
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    if (!pool) return;
+    pool->shutdown = 1;
+    dispatch(pool);
+    for (int t = 1; t < pool->num_threads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->threads);
+    free(pool->slots);
+    free(pool);
+}
@@ -0,0 +1,48 @@
+// thread_pool.h
+// Persistent spin-barrier thread pool: an alternative to OpenMP for the
+// small solves, where a parallel region and its barriers cost as much as
+// the kernels themselves
+//
+// Workers are created once (optionally pinned to a core) and stay alive
+// between solves. Inside a task the threads synchronize with a
+// sense-reversing spin barrier, and reductions go through cache-line padded
+// per-thread slots summed in thread order (bitwise reproducible for a given
+// thread count)
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+typedef struct ThreadPool ThreadPool;
+
+// Task body, run by every pool thread (tid 0 is the calling thread)
+typedef void (*PoolTask)(void *ctx, int tid, int num_threads);
+
+// Maximum number of values combined by one thread_pool_allreduce
+#define POOL_MAX_REDUCE 4
+
+// Creates a pool of num_threads threads (the caller counts as thread 0)
+// pin = 1 binds thread i to core i where the platform supports it (the
+// caller only for the duration of each thread_pool_run; its own mask is
+// restored afterwards)
+ThreadPool* thread_pool_create(int num_threads, int pin);
+
+// Runs task on all threads and returns once every thread has finished
+void thread_pool_run(ThreadPool *pool, PoolTask task, void *ctx);
+
+// Number of threads in the pool
+int thread_pool_size(const ThreadPool *pool);
+
+// Spin barrier across the pool (only valid inside a task)
+void thread_pool_barrier(ThreadPool *pool, int tid);
+
+// Sums values[0..count-1] over all threads; every thread gets the same
+// totals back in values (implies a barrier; count <= POOL_MAX_REDUCE)
+void thread_pool_allreduce(ThreadPool *pool, int tid, double *values, int count);
+
+// Static block partition of [0, n): this thread's range [*lo, *hi)
+void thread_pool_range(int n, int tid, int num_threads, int *lo, int *hi);
+
+// Stops and joins the workers
+void thread_pool_free(ThreadPool *pool);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,396 @@
+// tuner.c
+// Configuration search, tuning file lookup and interpolation
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <omp.h>
+#include "tuner.h"
+#include "blas1.h"
+#include "inspector.h"
+
+// One stored decision of this machine for the requested class and tolerance
+typedef struct {
+    int n;
+    TuneConfig config;
+} TuneEntry;
+
+// Preconditioners and SpMV operator shared by all trials of one search,
+// with what each cost to build
+typedef struct {
+    Preconditioner *pc[TUNE_NUM_PRECONDS];      // NULL for TUNE_PC_NONE
+    double pc_time[TUNE_NUM_PRECONDS];
+    SpmvHandle *handle;
+    double inspect_time;
+} TuneSetup;
+
+static const char *const solver_names[TUNE_NUM_SOLVERS] = {
+    "serial", "parallel", "pool", "tasks", "interleaved"
+};
+static const char *const precond_names[TUNE_NUM_PRECONDS] = { "none", "jacobi", "ilu0" };
+static const char *const format_names[TUNE_NUM_FORMATS] = { "csr", "inspected" };
+
+static const SolverFn solver_fns[TUNE_NUM_SOLVERS] = {
+    bicgstab_serial_ex, bicgstab_parallel_ex, bicgstab_pool_ex,
+    bicgstab_tasks_ex, bicgstab_interleaved_ex
+};
+
+const char* tune_solver_name(TuneSolver solver) { return solver_names[solver]; }
+const char* tune_precond_name(TunePrecond precond) { return precond_names[precond]; }
+const char* tune_format_name(TuneFormat format) { return format_names[format]; }
+
+const char* tune_source_name(TuneSource source) {
+    switch (source) {
+    case TUNE_FROM_CACHE:   return "cached";
+    case TUNE_INTERPOLATED: return "interpolated";
+    default:                return "searched";
+    }
+}
+
+void tune_default_options(TuneOptions *topts) {
+    topts->path = TUNE_DEFAULT_FILE;
+    topts->max_threads = 0;
+    topts->force_search = 0;
+    topts->verbose = 0;
+}
+
+// ============================================================================
+// Machine fingerprint
+// ============================================================================
+
+// FNV-1a
+static unsigned long long hash_string(const char *s) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void tune_machine(TuneMachine *m) {
+    char model[128] = "unknown cpu";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f) {
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            char *colon = strchr(line, ':');
+            if (strncmp(line, "model name", 10) == 0 && colon) {
+                char *s = colon + 1;
+                while (*s == ' ') s++;
+                s[strcspn(s, "\n")] = '\0';
+                snprintf(model, sizeof(model), "%s", s);
+                break;
+            }
+        }
+        fclose(f);
+    }
+    long l3 = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    snprintf(m->desc, sizeof(m->desc), "%s, %d cpus, L3 %ld KB, %s",
+             model, omp_get_num_procs(), l3 > 0 ? l3 / 1024 : 0, blas1_isa());
+    snprintf(m->id, sizeof(m->id), "%016llx", hash_string(m->desc));
+}
+
+// ============================================================================
+// Tuning file
+// ============================================================================
+
+static int name_index(const char *const *names, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+// Tolerance as written to the file (compared as text, so it round-trips)
+static void format_tol(double tol, char *buf, size_t len) {
+    snprintf(buf, len, "%.3g", tol);
+}
+
+// Reads this machine's decisions for class / tol, one per n (the last line
+// for an n wins). *machine_seen = 1 if the file has any line of this machine
+static int load_entries(const char *path, const TuneMachine *m, const char *problem_class,
+                        const char *tol, TuneEntry **entries, int *machine_seen) {
+    *entries = NULL;
+    *machine_seen = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    int count = 0, capacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char id[32], cls[64], t[32], solver[32], precond[32], format[32];
+        int n, threads;
+        double time;
+        if (line[0] == '#') {
+            if (sscanf(line, "# %31s", id) == 1 && strncmp(id, m->id, 16) == 0) *machine_seen = 1;
+            continue;
+        }
+        if (sscanf(line, "%31s %63s %d %31s %31s %31s %31s %d %lf",
+                   id, cls, &n, t, solver, precond, format, &threads, &time) != 9) continue;
+        if (strcmp(id, m->id) != 0) continue;
+        *machine_seen = 1;
+        if (strcmp(cls, problem_class) != 0 || strcmp(t, tol) != 0) continue;
+
+        TuneConfig c;
+        int s = name_index(solver_names, TUNE_NUM_SOLVERS, solver);
+        int p = name_index(precond_names, TUNE_NUM_PRECONDS, precond);
+        int fmt = name_index(format_names, TUNE_NUM_FORMATS, format);
+        if (s < 0 || p < 0 || fmt < 0 || threads < 1) continue;
+        c.solver = (TuneSolver)s;
+        c.precond = (TunePrecond)p;
+        c.format = (TuneFormat)fmt;
+        c.threads = threads;
+        c.time = time;
+
+        int k = 0;
+        while (k < count && (*entries)[k].n != n) k++;
+        if (k == count) {
+            if (count == capacity) {
+                capacity = capacity ? 2 * capacity : 16;
+                *entries = (TuneEntry*)realloc(*entries, capacity * sizeof(TuneEntry));
+            }
+            count++;
+        }
+        (*entries)[k].n = n;
+        (*entries)[k].config = c;
+    }
+    fclose(f);
+    return count;
+}
+
+static void store_entry(const char *path, const TuneMachine *m, int machine_seen,
+                        const char *problem_class, int n, const char *tol, const TuneConfig *c) {
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        perror("tune_select: cannot write tuning file");
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 0) {
+        fprintf(f, "# BICGSTAB tuning file: fingerprint class n tol solver precond format threads seconds\n");
+    }
+    if (!machine_seen) fprintf(f, "# %s %s\n", m->id, m->desc);
+    fprintf(f, "%s %s %d %s %s %s %s %d %.6g\n", m->id, problem_class, n, tol,
+            solver_names[c->solver], precond_names[c->precond], format_names[c->format],
+            c->threads, c->time);
+    fclose(f);
+}
+
+// Decision for size n from decisions for other sizes; 0 if none is close enough
+static int interpolate(const TuneEntry *entries, int count, int n, int max_threads, TuneConfig *config) {
+    const TuneEntry *lo = NULL, *hi = NULL;
+    for (int k = 0; k < count; k++) {
+        const TuneEntry *e = &entries[k];
+        if (e->n <= n && (!lo || e->n > lo->n)) lo = e;
+        if (e->n >= n && (!hi || e->n < hi->n)) hi = e;
+    }
+    if (lo && lo->n == n) {
+        *config = lo->config;
+        return 1;
+    }
+
+    const TuneEntry *near;
+    if (lo && hi) {
+        near = log((double)n / lo->n) <= log((double)hi->n / n) ? lo : hi;
+    } else {
+        near = lo ? lo : hi;
+        if (!near || fabs(log((double)n / near->n)) > log(TUNE_EXTRAPOLATE)) return 0;
+    }
+    *config = near->config;
+    config->time = near->config.time * pow((double)n / near->n, TUNE_TIME_EXPONENT);
+
+    // Both neighbours made the same choice: interpolate threads and time in log n
+    const TuneConfig *a = lo ? &lo->config : NULL, *b = hi ? &hi->config : NULL;
+    if (a && b && a->solver == b->solver && a->precond == b->precond && a->format == b->format) {
+        double w = log((double)n / lo->n) / log((double)hi->n / lo->n);
+        int threads = (int)lround(exp((1.0 - w) * log(a->threads) + w * log(b->threads)));
+        config->threads = threads < 1 ? 1 : threads;
+        config->time = exp((1.0 - w) * log(a->time) + w * log(b->time));
+    }
+    if (config->threads > max_threads) config->threads = max_threads;
+    return 1;
+}
+
+// ============================================================================
+// Trial solves
+// ============================================================================
+
+// Runs config with the given preconditioner and operator from x = 0
+static int run_config(FEMSystem *sys, const TuneConfig *config, const SolverOptions *opts,
+                      Preconditioner *pc, LinearOperator *op, SolverStats *stats, double *time) {
+    SolverOptions o = *opts;
+    o.num_threads = config->threads;
+    o.precond = pc;
+    o.op = op;
+    o.pool = NULL;
+    o.workspace = NULL;
+    memset(sys->x, 0, sys->n * sizeof(double));
+    return solver_fns[config->solver](sys, &o, stats, time);
+}
+
+static Preconditioner* create_precond(TunePrecond precond, CSRMatrix *A) {
+    switch (precond) {
+    case TUNE_PC_JACOBI: return precond_create_jacobi(A);
+    case TUNE_PC_ILU0:   return precond_create_ilu0(A);
+    default:             return NULL;
+    }
+}
+
+// Interleaved runs unpreconditioned CSR solves only (it falls back to the
+// parallel solver otherwise); serial is single-threaded
+static int config_valid(const TuneConfig *c) {
+    if (c->solver == TUNE_SERIAL && c->threads != 1) return 0;
+    if (c->solver == TUNE_INTERLEAVED &&
+        (c->precond != TUNE_PC_NONE || c->format != TUNE_FORMAT_CSR)) return 0;
+    return 1;
+}
+
+// Best estimated time to solution at opts->tol over TUNE_TRIALS trial solves
+// (-1 if the trial did not converge)
+static double trial(FEMSystem *sys, const TuneConfig *config, const SolverOptions *opts,
+                    const TuneSetup *setup, int *iters) {
+    SolverOptions o = *opts;
+    o.tol = fmax(opts->tol, TUNE_TRIAL_TOL);
+    o.verbose = 0;
+    Preconditioner *pc = setup->pc[config->precond];
+    LinearOperator *op = config->format == TUNE_FORMAT_INSPECTED ? spmv_handle_op(setup->handle) : NULL;
+
+    double best = -1.0;
+    for (int rep = 0; rep < TUNE_TRIALS; rep++) {
+        SolverStats stats;
+        double time;
+        int it = run_config(sys, config, &o, pc, op, &stats, &time);
+        if (it < 0) return -1.0;
+        *iters = it;
+
+        // Linear convergence: the remaining digits take proportionally longer
+        double res = stats.recursive_residual;
+        if (opts->tol < o.tol && res > 0.0 && res < 1.0) time *= log(opts->tol) / log(res);
+        if (best < 0.0 || time < best) best = time;
+    }
+    best += setup->pc_time[config->precond];
+    if (config->format == TUNE_FORMAT_INSPECTED) best += setup->inspect_time;
+    return best;
+}
+
+static void search(FEMSystem *sys, const SolverOptions *opts, int max_threads, int verbose,
+                   TuneConfig *best) {
+    TuneSetup setup;
+    memset(&setup, 0, sizeof(setup));
+    for (int p = 0; p < TUNE_NUM_PRECONDS; p++) {
+        double start = wall_time();
+        setup.pc[p] = create_precond((TunePrecond)p, &sys->A);
+        setup.pc_time[p] = wall_time() - start;
+    }
+    double start = wall_time();
+    setup.handle = spmv_inspect(&sys->A, opts->tol, 1);
+    setup.inspect_time = wall_time() - start;
+
+    // Thread counts: powers of two up to max_threads, and max_threads itself
+    int thread_counts[32], num_counts = 0;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts[num_counts++] = t;
+    thread_counts[num_counts++] = max_threads;
+
+    best->time = -1.0;
+    for (int s = 0; s < TUNE_NUM_SOLVERS; s++) {
+        for (int p = 0; p < TUNE_NUM_PRECONDS; p++) {
+            for (int f = 0; f < TUNE_NUM_FORMATS; f++) {
+                for (int k = 0; k < num_counts; k++) {
+                    TuneConfig c = { (TuneSolver)s, (TunePrecond)p, (TuneFormat)f, thread_counts[k], 0.0 };
+                    if (!config_valid(&c)) continue;
+                    int iters = 0;
+                    c.time = trial(sys, &c, opts, &setup, &iters);
+                    if (verbose) {
+                        if (c.time < 0.0) {
+                            printf("  %-11s %-6s %-9s %3d threads   did not converge\n",
+                                   solver_names[s], precond_names[p], format_names[f], c.threads);
+                        } else {
+                            printf("  %-11s %-6s %-9s %3d threads   %9.4f s  (trial %d iters)\n",
+                                   solver_names[s], precond_names[p], format_names[f],
+                                   c.threads, c.time, iters);
+                        }
+                    }
+                    if (c.time >= 0.0 && (best->time < 0.0 || c.time < best->time)) *best = c;
+                }
+            }
+        }
+    }
+
+    for (int p = 0; p < TUNE_NUM_PRECONDS; p++) {
+        if (setup.pc[p]) precond_free(setup.pc[p]);
+    }
+    spmv_handle_free(setup.handle);
+
+    // Nothing converged in the trials: plain parallel solve
+    if (best->time < 0.0) {
+        TuneConfig fallback = { TUNE_PARALLEL, TUNE_PC_NONE, TUNE_FORMAT_CSR, max_threads, 0.0 };
+        *best = fallback;
+    }
+}
+
+// ============================================================================
+// Public interface
+// ============================================================================
+
+TuneSource tune_select(FEMSystem *sys, const char *problem_class, const SolverOptions *opts,
+                       const TuneOptions *topts, TuneConfig *config) {
+    TuneOptions defaults;
+    if (!topts) {
+        tune_default_options(&defaults);
+        topts = &defaults;
+    }
+    const char *path = topts->path ? topts->path : TUNE_DEFAULT_FILE;
+    int max_threads = topts->max_threads > 0 ? topts->max_threads : omp_get_num_procs();
+
+    TuneMachine m;
+    tune_machine(&m);
+    char tol[32];
+    format_tol(opts->tol, tol, sizeof(tol));
+
+    TuneEntry *entries;
+    int machine_seen;
+    int count = load_entries(path, &m, problem_class, tol, &entries, &machine_seen);
+    if (!topts->force_search && interpolate(entries, count, sys->n, max_threads, config)) {
+        int exact = 0;
+        for (int k = 0; k < count; k++) exact |= entries[k].n == sys->n;
+        free(entries);
+        return exact ? TUNE_FROM_CACHE : TUNE_INTERPOLATED;
+    }
+    free(entries);
+
+    // Trials overwrite x; the caller's initial guess is put back afterwards
+    double *x0 = (double*)malloc(sys->n * sizeof(double));
+    memcpy(x0, sys->x, sys->n * sizeof(double));
+    search(sys, opts, max_threads, topts->verbose, config);
+    memcpy(sys->x, x0, sys->n * sizeof(double));
+    free(x0);
+
+    store_entry(path, &m, machine_seen, problem_class, sys->n, tol, config);
+    return TUNE_SEARCHED;
+}
+
+int tune_solve(FEMSystem *sys, const TuneConfig *config, const SolverOptions *opts,
+               SolverStats *stats, double *time) {
+    double start = wall_time();
+    Preconditioner *pc = create_precond(config->precond, &sys->A);
+    SpmvHandle *h = config->format == TUNE_FORMAT_INSPECTED ? spmv_inspect(&sys->A, opts->tol, 1) : NULL;
+    double setup = wall_time() - start;
+
+    SolverOptions o = *opts;
+    o.num_threads = config->threads;
+    o.precond = pc;
+    o.op = h ? spmv_handle_op(h) : NULL;
+    o.pool = NULL;
+    int iters = solver_fns[config->solver](sys, &o, stats, time);
+    *time += setup;
+
+    if (h) spmv_handle_free(h);
+    if (pc) precond_free(pc);
+    return iters;
+}
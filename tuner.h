@@ -0,0 +1,103 @@
+// tuner.h
+// Solver auto-tuning with a persistent per-machine tuning file
+//
+// tune_select() picks solver, preconditioner, SpMV format and thread count
+// for a problem class and size. It first looks in the tuning file for
+// decisions made on this machine (same fingerprint) for the same class and
+// tolerance:
+//   same n              the stored decision is used as is
+//   n between two sizes the decision of the nearer size (log n), with the
+//                       thread count interpolated if both sizes agree on
+//                       the rest
+//   n within TUNE_EXTRAPOLATE of one size  that size's decision
+// Otherwise every configuration is run as a short trial solve (tolerance
+// TUNE_TRIAL_TOL), its time to solution at tol is estimated from the
+// residual it reached, and the fastest one is appended to the file.
+// Estimated times include preconditioner setup and the SpMV inspection,
+// since both are paid once per solve of a new matrix.
+//
+// File lines (later lines win, '#' starts a comment):
+//   fingerprint class n tol solver precond format threads seconds
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include "fem_matrix.h"
+#include "bicgstab.h"
+
+#define TUNE_DEFAULT_FILE "bicgstab_tuning.txt"
+#define TUNE_TRIAL_TOL 1e-3         // Trial solves stop here (or at tol if looser)
+#define TUNE_TRIALS 2               // Trial solves per configuration (best counts)
+#define TUNE_EXTRAPOLATE 2.0        // Size ratio a single cached size still covers
+#define TUNE_TIME_EXPONENT 1.5      // Time ~ n^1.5 when rescaling a cached estimate
+
+typedef enum {
+    TUNE_SERIAL = 0,
+    TUNE_PARALLEL,
+    TUNE_POOL,
+    TUNE_TASKS,
+    TUNE_INTERLEAVED,
+    TUNE_NUM_SOLVERS
+} TuneSolver;
+
+typedef enum {
+    TUNE_PC_NONE = 0,
+    TUNE_PC_JACOBI,
+    TUNE_PC_ILU0,
+    TUNE_NUM_PRECONDS
+} TunePrecond;
+
+typedef enum {
+    TUNE_FORMAT_CSR = 0,        // sys->A with the solver's own CSR kernel
+    TUNE_FORMAT_INSPECTED,      // Operator chosen by spmv_inspect (inspector.h)
+    TUNE_NUM_FORMATS
+} TuneFormat;
+
+typedef struct {
+    TuneSolver solver;
+    TunePrecond precond;
+    TuneFormat format;
+    int threads;
+    double time;                // Estimated time to solution (s)
+} TuneConfig;
+
+typedef enum {
+    TUNE_FROM_CACHE = 0,        // Stored decision for this size
+    TUNE_INTERPOLATED,          // Derived from stored decisions for other sizes
+    TUNE_SEARCHED               // Trial solves run, decision stored
+} TuneSource;
+
+typedef struct {
+    const char *path;           // Tuning file (NULL = TUNE_DEFAULT_FILE)
+    int max_threads;            // Largest thread count tried (0 = all processors)
+    int force_search;           // 1 = ignore the file (the result is still stored)
+    int verbose;                // 1 = print every trial
+} TuneOptions;
+
+// Identifies the machine decisions are valid for
+typedef struct {
+    char id[17];                // Hex hash of the fields below
+    char desc[192];             // CPU model, processor count, L3 size, BLAS-1 ISA
+} TuneMachine;
+
+void tune_default_options(TuneOptions *topts);
+void tune_machine(TuneMachine *m);
+
+// Decision for solving sys (of the given class, e.g. "laplace") to opts->tol;
+// opts supplies the remaining settings of the trial solves
+TuneSource tune_select(FEMSystem *sys, const char *problem_class, const SolverOptions *opts,
+                       const TuneOptions *topts, TuneConfig *config);
+
+// Solves sys with config (building and freeing its preconditioner and SpMV
+// operator) on top of opts. *time includes that setup.
+// Returns iterations, or -1 if failed
+int tune_solve(FEMSystem *sys, const TuneConfig *config, const SolverOptions *opts,
+               SolverStats *stats, double *time);
+
+// Names for printing and for the tuning file
+const char* tune_solver_name(TuneSolver solver);
+const char* tune_precond_name(TunePrecond precond);
+const char* tune_format_name(TuneFormat format);
+const char* tune_source_name(TuneSource source);
+
+#endif // TUNER_H